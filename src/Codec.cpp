@@ -0,0 +1,554 @@
+/*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+** Copyright (c) 2010, Monash University
+** All rights reserved.
+** Redistribution and use in source and binary forms, with or without modification,
+** are permitted provided that the following conditions are met:
+**
+**       * Redistributions of source code must retain the above copyright notice,
+**          this list of conditions and the following disclaimer.
+**       * Redistributions in binary form must reproduce the above copyright
+**         notice, this list of conditions and the following disclaimer in the
+**         documentation and/or other materials provided with the distribution.
+**       * Neither the name of the Monash University nor the names of its contributors
+**         may be used to endorse or promote products derived from this software
+**         without specific prior written permission.
+**
+** THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+** "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+** THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+** PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+** BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+** CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+** SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+** HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+** LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+** OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**
+**
+** Contact:
+*%  Owen Kaluza - Owen.Kaluza(at)monash.edu
+*%
+*% Development Team :
+*%  http://www.underworldproject.org/aboutus.html
+**
+**~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+
+#include "Codec.h"
+
+static const char* compressors[] = {"none", "deflate", "lz"};
+static const char* filters[] = {"", "shuffle-", "bitshuffle-"};
+
+int Codec::lookup(const std::string& name)
+{
+  //Codec id from name, eg: "deflate", "shuffle-lz", "bitshuffle-deflate"
+  for (int f=2; f>=0; f--)
+  {
+    std::string prefix = filters[f];
+    if (name.compare(0, prefix.length(), prefix) != 0) continue;
+    for (int c=0; c<3; c++)
+      if (name.substr(prefix.length()) == compressors[c])
+        return c == lucCompressNone ? lucCompressNone : CODEC_ID(f, c);
+  }
+  return -1;
+}
+
+std::string Codec::name(int codec)
+{
+  if (CODEC_COMPRESSOR(codec) > lucCompressLZ || CODEC_FILTER(codec) > lucFilterBitShuffle || CODEC_DELTA(codec) > lucDeltaDiff) return "unknown";
+  std::string name = std::string(filters[CODEC_FILTER(codec)]) + compressors[CODEC_COMPRESSOR(codec)];
+  if (CODEC_DELTA(codec) == lucDeltaXOR) name += " (xor delta)";
+  if (CODEC_DELTA(codec) == lucDeltaDiff) name += " (diff delta)";
+  return name;
+}
+
+int Codec::encode(int codec, const unsigned char* src, unsigned long len, std::vector<unsigned char>& dst, unsigned int typesize, int level)
+{
+  int filter = CODEC_FILTER(codec);
+  int compressor = CODEC_COMPRESSOR(codec);
+  if (compressor == lucCompressNone || len == 0) return lucCompressNone;
+
+  //Prefilter into temporary buffer (multi byte elements only)
+  std::vector<unsigned char> filtered;
+  const unsigned char* input = src;
+  if (typesize <= 1) filter = lucFilterNone;
+  if (filter != lucFilterNone)
+  {
+    filtered.resize(len);
+    if (filter == lucFilterShuffle)
+      shuffle(src, &filtered[0], len, typesize);
+    else
+      bitshuffle(src, &filtered[0], len, typesize);
+    input = &filtered[0];
+  }
+
+  unsigned long dstlen = 0;
+  if (compressor == lucCompressDeflate)
+  {
+    dstlen = compressBound(len);
+    dst.resize(dstlen);
+    if (compress2(&dst[0], &dstlen, input, len, level) != Z_OK)
+      dstlen = 0;
+  }
+  else if (compressor == lucCompressLZ)
+  {
+    dst.resize(len);
+    dstlen = lzCompress(input, len, &dst[0], len);
+  }
+
+  //Keep only if smaller
+  if (dstlen == 0 || dstlen >= len)
+  {
+    dst.clear();
+    return lucCompressNone;
+  }
+  dst.resize(dstlen);
+  return CODEC_ID(filter, compressor);
+}
+
+bool Codec::decode(int codec, const unsigned char* src, unsigned long len, unsigned char* dst, unsigned long dstlen, unsigned int typesize)
+{
+  int filter = CODEC_FILTER(codec);
+  int compressor = CODEC_COMPRESSOR(codec);
+
+  //Prefiltered data decompressed to temporary buffer first
+  std::vector<unsigned char> filtered;
+  unsigned char* output = dst;
+  if (filter != lucFilterNone)
+  {
+    filtered.resize(dstlen);
+    output = &filtered[0];
+  }
+
+  bool ok = false;
+  if (compressor == lucCompressNone)
+  {
+    ok = len == dstlen;
+    if (ok) memcpy(output, src, len);
+  }
+  else if (compressor == lucCompressDeflate)
+  {
+    unsigned long outlen = dstlen;
+#ifdef USE_ZLIB
+    ok = uncompress(output, &outlen, src, len) == Z_OK && outlen == dstlen;
+#else
+    ok = tinfl_decompress_mem_to_mem(output, outlen, src, len, TINFL_FLAG_PARSE_ZLIB_HEADER) == dstlen;
+#endif
+  }
+  else if (compressor == lucCompressLZ)
+    ok = lzDecompress(src, len, output, dstlen);
+
+  if (ok && filter == lucFilterShuffle)
+    unshuffle(output, dst, dstlen, typesize);
+  else if (ok && filter == lucFilterBitShuffle)
+    bitunshuffle(output, dst, dstlen, typesize);
+  else if (filter != lucFilterNone)
+    ok = false;
+  return ok;
+}
+
+void Codec::shuffle(const unsigned char* src, unsigned char* dst, unsigned long len, unsigned int typesize)
+{
+  //Byte n of each element grouped together, trailing partial element copied
+  unsigned long n = len / typesize;
+  for (unsigned int b=0; b<typesize; b++)
+    for (unsigned long i=0; i<n; i++)
+      dst[b*n + i] = src[i*typesize + b];
+  memcpy(dst + n*typesize, src + n*typesize, len - n*typesize);
+}
+
+void Codec::unshuffle(const unsigned char* src, unsigned char* dst, unsigned long len, unsigned int typesize)
+{
+  unsigned long n = len / typesize;
+  for (unsigned int b=0; b<typesize; b++)
+    for (unsigned long i=0; i<n; i++)
+      dst[i*typesize + b] = src[b*n + i];
+  memcpy(dst + n*typesize, src + n*typesize, len - n*typesize);
+}
+
+void Codec::bitshuffle(const unsigned char* src, unsigned char* dst, unsigned long len, unsigned int typesize)
+{
+  //Byte shuffle, then transpose bits within each byte plane in groups of 8 elements,
+  //so bit k of every element is grouped together (elements past last group of 8 copied)
+  std::vector<unsigned char> planes(len);
+  shuffle(src, &planes[0], len, typesize);
+  unsigned long n = len / typesize;
+  unsigned long groups = n / 8;
+  for (unsigned int b=0; b<typesize; b++)
+  {
+    const unsigned char* in = &planes[b*n];
+    unsigned char* out = dst + b*n;
+    for (unsigned long g=0; g<groups; g++)
+    {
+      for (int k=0; k<8; k++)
+      {
+        unsigned char v = 0;
+        for (int m=0; m<8; m++)
+          v |= ((in[g*8 + m] >> k) & 1) << m;
+        out[k*groups + g] = v;
+      }
+    }
+    memcpy(out + groups*8, in + groups*8, n - groups*8);
+  }
+  memcpy(dst + n*typesize, &planes[n*typesize], len - n*typesize);
+}
+
+void Codec::bitunshuffle(const unsigned char* src, unsigned char* dst, unsigned long len, unsigned int typesize)
+{
+  std::vector<unsigned char> planes(len);
+  unsigned long n = len / typesize;
+  unsigned long groups = n / 8;
+  for (unsigned int b=0; b<typesize; b++)
+  {
+    const unsigned char* in = src + b*n;
+    unsigned char* out = &planes[b*n];
+    for (unsigned long g=0; g<groups; g++)
+    {
+      for (int m=0; m<8; m++)
+      {
+        unsigned char v = 0;
+        for (int k=0; k<8; k++)
+          v |= ((in[k*groups + g] >> m) & 1) << k;
+        out[g*8 + m] = v;
+      }
+    }
+    memcpy(out + groups*8, in + groups*8, n - groups*8);
+  }
+  memcpy(&planes[n*typesize], src + n*typesize, len - n*typesize);
+  unshuffle(&planes[0], dst, len, typesize);
+}
+
+void Codec::delta(int mode, const unsigned char* src, const unsigned char* base, unsigned char* dst, unsigned long len)
+{
+  //Bytes past last whole word copied unchanged
+  unsigned long n = len / 4;
+  const uint32_t* in = (const uint32_t*)src;
+  const uint32_t* ref = (const uint32_t*)base;
+  uint32_t* out = (uint32_t*)dst;
+  if (mode == lucDeltaXOR)
+    for (unsigned long i=0; i<n; i++)
+      out[i] = in[i] ^ ref[i];
+  else
+    for (unsigned long i=0; i<n; i++)
+      out[i] = in[i] - ref[i];
+  memcpy(dst + n*4, src + n*4, len - n*4);
+}
+
+void Codec::undelta(int mode, unsigned char* data, const unsigned char* base, unsigned long len)
+{
+  unsigned long n = len / 4;
+  uint32_t* out = (uint32_t*)data;
+  const uint32_t* ref = (const uint32_t*)base;
+  if (mode == lucDeltaXOR)
+    for (unsigned long i=0; i<n; i++)
+      out[i] ^= ref[i];
+  else
+    for (unsigned long i=0; i<n; i++)
+      out[i] += ref[i];
+}
+
+static inline uint64_t rotl64(uint64_t x, int r)
+{
+  return (x << r) | (x >> (64 - r));
+}
+
+static inline uint64_t avalanche64(uint64_t h)
+{
+  h ^= h >> 33;
+  h *= 0xff51afd7ed558ccdULL;
+  h ^= h >> 33;
+  h *= 0xc4ceb9fe1a85ec53ULL;
+  h ^= h >> 33;
+  return h;
+}
+
+void Codec::hash(const unsigned char* src, unsigned long len, uint64_t digest[2])
+{
+  //Two independent 64 bit lanes over 8 byte words, tail bytes zero padded
+  const uint64_t P1 = 0x9e3779b185ebca87ULL, P2 = 0xc2b2ae3d27d4eb4fULL;
+  uint64_t a = P1 ^ len, b = P2 + len;
+  unsigned long n = len / 8;
+  uint64_t w;
+  for (unsigned long i=0; i<=n; i++)
+  {
+    if (i == n)
+    {
+      if (len % 8 == 0) break;
+      w = 0;
+      memcpy(&w, src + i*8, len % 8);
+    }
+    else
+      memcpy(&w, src + i*8, 8);
+    a = rotl64(a + w * P2, 31) * P1;
+    b = rotl64(b ^ (w * P1), 27) * P2 + 0x165667b19e3779f9ULL;
+  }
+  digest[0] = avalanche64(a);
+  digest[1] = avalanche64(b ^ a);
+}
+
+static inline uint32_t read32(const unsigned char* p)
+{
+  uint32_t v;
+  memcpy(&v, p, 4);
+  return v;
+}
+
+static inline bool writeLength(unsigned char* dst, unsigned long& op, unsigned long dstlen, unsigned long length)
+{
+  //Length extension bytes, 255 continues
+  while (length >= 255)
+  {
+    if (op >= dstlen) return false;
+    dst[op++] = 255;
+    length -= 255;
+  }
+  if (op >= dstlen) return false;
+  dst[op++] = length;
+  return true;
+}
+
+static inline bool readLength(const unsigned char* src, unsigned long& ip, unsigned long len, unsigned long& length)
+{
+  unsigned char b;
+  do
+  {
+    if (ip >= len) return false;
+    b = src[ip++];
+    length += b;
+  }
+  while (b == 255);
+  return true;
+}
+
+unsigned long Codec::lzCompress(const unsigned char* src, unsigned long len, unsigned char* dst, unsigned long dstlen)
+{
+  //Sequences of: token (literal count << 4 | match length - 4), literals, 16 bit match offset
+  //Matches found by hashing 4 byte sequences, last sequence is literals only
+  const int HASH_BITS = 14;
+  std::vector<unsigned int> table(1 << HASH_BITS, 0);
+  unsigned long ip = 0, anchor = 0, op = 0;
+  unsigned long matchlimit = len > 5 ? len - 5 : 0;   //Trailing bytes always literals
+  unsigned long searchlimit = len > 12 ? len - 12 : 0;
+  unsigned int misses = 0;
+  while (ip < searchlimit)
+  {
+    uint32_t seq = read32(src + ip);
+    unsigned int h = (seq * 2654435761u) >> (32 - HASH_BITS);
+    unsigned long ref = table[h];
+    table[h] = ip;
+    if (ref >= ip || ip - ref > 65535 || read32(src + ref) != seq)
+    {
+      //Skip faster through incompressible data
+      ip += 1 + (misses++ >> 6);
+      continue;
+    }
+    misses = 0;
+
+    unsigned long mlen = 4;
+    while (ip + mlen < matchlimit && src[ref + mlen] == src[ip + mlen])
+      mlen++;
+
+    unsigned long lit = ip - anchor;
+    if (op + 1 + lit > dstlen) return 0;
+    unsigned char* token = dst + op++;
+    *token = (lit >= 15 ? 15 : lit) << 4;
+    if (lit >= 15 && !writeLength(dst, op, dstlen, lit - 15)) return 0;
+    if (op + lit + 2 > dstlen) return 0;
+    memcpy(dst + op, src + anchor, lit);
+    op += lit;
+    dst[op++] = (ip - ref) & 0xff;
+    dst[op++] = (ip - ref) >> 8;
+    unsigned long m = mlen - 4;
+    *token |= m >= 15 ? 15 : m;
+    if (m >= 15 && !writeLength(dst, op, dstlen, m - 15)) return 0;
+
+    ip += mlen;
+    anchor = ip;
+  }
+
+  //Final literals
+  unsigned long lit = len - anchor;
+  if (op + 1 > dstlen) return 0;
+  dst[op++] = (lit >= 15 ? 15 : lit) << 4;
+  if (lit >= 15 && !writeLength(dst, op, dstlen, lit - 15)) return 0;
+  if (op + lit > dstlen) return 0;
+  memcpy(dst + op, src + anchor, lit);
+  return op + lit;
+}
+
+bool Codec::lzDecompress(const unsigned char* src, unsigned long len, unsigned char* dst, unsigned long dstlen)
+{
+  unsigned long ip = 0, op = 0;
+  while (ip < len)
+  {
+    unsigned char token = src[ip++];
+    unsigned long lit = token >> 4;
+    if (lit == 15 && !readLength(src, ip, len, lit)) return false;
+    if (ip + lit > len || op + lit > dstlen) return false;
+    memcpy(dst + op, src + ip, lit);
+    ip += lit;
+    op += lit;
+    if (ip >= len) break;
+
+    if (ip + 2 > len) return false;
+    unsigned long offset = src[ip] | (src[ip+1] << 8);
+    ip += 2;
+    unsigned long mlen = token & 15;
+    if (mlen == 15 && !readLength(src, ip, len, mlen)) return false;
+    mlen += 4;
+    if (offset == 0 || offset > op || op + mlen > dstlen) return false;
+    //Byte copy, match may overlap output
+    unsigned char* out = dst + op;
+    const unsigned char* match = out - offset;
+    for (unsigned long i=0; i<mlen; i++)
+      out[i] = match[i];
+    op += mlen;
+  }
+  return op == dstlen;
+}
+
+void Codec::benchmark(std::ostream& os, const std::string& label, const unsigned char* src, unsigned long len, unsigned int typesize, int level)
+{
+  //Ratio and encode/decode throughput of each codec, repeated for at least 0.1 seconds
+  os << label << " (" << len << " bytes)" << std::endl;
+  os << std::setw(20) << "codec" << std::setw(10) << "ratio" << std::setw(14) << "encode mb/s" << std::setw(14) << "decode mb/s" << std::endl;
+  std::vector<unsigned char> encoded;
+  std::vector<unsigned char> decoded(len);
+  for (int f=lucFilterNone; f<=lucFilterBitShuffle; f++)
+  {
+    for (int c=lucCompressDeflate; c<=lucCompressLZ; c++)
+    {
+      int codec = CODEC_ID(f, c);
+      int reps = 0;
+      int applied = 0;
+      auto t0 = std::chrono::steady_clock::now();
+      double enc, dec;
+      do
+      {
+        applied = encode(codec, src, len, encoded, typesize, level);
+        reps++;
+        enc = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+      }
+      while (enc < 0.1);
+      enc = len * reps / enc / 1000000.0;
+
+      bool ok = true;
+      reps = 0;
+      t0 = std::chrono::steady_clock::now();
+      do
+      {
+        if (applied)
+          ok = decode(applied, &encoded[0], encoded.size(), &decoded[0], len, typesize);
+        else
+          memcpy(&decoded[0], src, len);
+        reps++;
+        dec = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+      }
+      while (dec < 0.1 && ok);
+      dec = len * reps / dec / 1000000.0;
+      ok = ok && memcmp(&decoded[0], src, len) == 0;
+
+      double ratio = applied ? len / (double)encoded.size() : 1.0;
+      os << std::setw(20) << name(codec) << std::setw(10) << std::setprecision(3) << ratio
+         << std::setw(14) << std::setprecision(5) << enc << std::setw(14) << dec << (ok ? "" : " FAILED") << std::endl;
+    }
+  }
+}
+
+//Pseudo random bytes (xorshift), incompressible test data
+static void noise(std::vector<unsigned char>& data, uint32_t seed)
+{
+  for (unsigned long i=0; i<data.size(); i++)
+  {
+    seed ^= seed << 13;
+    seed ^= seed >> 17;
+    seed ^= seed << 5;
+    data[i] = seed & 0xff;
+  }
+}
+
+int Codec::verify(std::ostream& os, const std::string& label, const unsigned char* src, unsigned long len, unsigned int typesize, int level)
+{
+  std::vector<unsigned char> random((len < 4096 ? 4096 : len) | 1);
+  noise(random, 0x9e3779b9);
+  struct {const char* name; const unsigned char* data; unsigned long len;} cases[] =
+  {
+    {"data", src, len},
+    {"odd length", src, len ? (len / 2) | 1 : 0},
+    {"zero length", random.data(), 0},
+    {"incompressible", random.data(), random.size()}
+  };
+
+  int failures = 0;
+  int checks = 0;
+  for (auto& test : cases)
+  {
+    const unsigned char* data = test.data ? test.data : random.data();
+    unsigned long n = test.len;
+    //(extra byte so buffers are never empty)
+    std::vector<unsigned char> encoded, decoded(n + 1), base(n + 1), deltas(n + 1);
+    noise(base, 0x85ebca6b + n);
+    std::vector<std::string> failed;
+
+    //Every compressor with every prefilter
+    for (int f=lucFilterNone; f<=lucFilterBitShuffle; f++)
+    {
+      for (int c=lucCompressNone; c<=lucCompressLZ; c++)
+      {
+        int codec = CODEC_ID(f, c);
+        int applied = encode(codec, data, n, encoded, typesize, level);
+        const unsigned char* input = applied ? encoded.data() : data;
+        unsigned long inlen = applied ? encoded.size() : n;
+        if (!decode(applied, input, inlen, decoded.data(), n, typesize) || memcmp(decoded.data(), data, n) != 0)
+          failed.push_back(name(codec));
+        checks++;
+      }
+    }
+
+    //LZ block codec directly, including data it can't compress
+    encoded.resize(n + n / 255 + 16);
+    unsigned long size = lzCompress(data, n, encoded.data(), encoded.size());
+    if (!size || !lzDecompress(encoded.data(), size, decoded.data(), n) || memcmp(decoded.data(), data, n) != 0)
+      failed.push_back("lz block");
+    checks++;
+
+    //Temporal delta modes against another block
+    for (int d=lucDeltaXOR; d<=lucDeltaDiff; d++)
+    {
+      delta(d, data, base.data(), deltas.data(), n);
+      undelta(d, deltas.data(), base.data(), n);
+      if (memcmp(deltas.data(), data, n) != 0)
+        failed.push_back(name(CODEC_WITH_DELTA(lucCompressNone, d)));
+      checks++;
+    }
+
+    //Hash, same for a copy of the data, different once a byte changes
+    uint64_t digest[2], copied[2];
+    memcpy(decoded.data(), data, n);
+    hash(data, n, digest);
+    hash(decoded.data(), n, copied);
+    bool same = digest[0] == copied[0] && digest[1] == copied[1];
+    if (n)
+    {
+      decoded[n-1] ^= 1;
+      hash(decoded.data(), n, copied);
+      same = same && (digest[0] != copied[0] || digest[1] != copied[1]);
+    }
+    if (!same) failed.push_back("hash");
+    checks++;
+
+    failures += failed.size();
+    os << label << ", " << test.name << " (" << n << " bytes): ";
+    if (failed.empty())
+      os << "ok" << std::endl;
+    else
+    {
+      os << "FAILED";
+      for (auto& f : failed)
+        os << " [" << f << "]";
+      os << std::endl;
+    }
+  }
+  os << label << ": " << checks << " round trips checked, " << failures << " failed" << std::endl;
+  return failures;
+}
@@ -0,0 +1,110 @@
+/*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+** Copyright (c) 2010, Monash University
+** All rights reserved.
+** Redistribution and use in source and binary forms, with or without modification,
+** are permitted provided that the following conditions are met:
+**
+**       * Redistributions of source code must retain the above copyright notice,
+**          this list of conditions and the following disclaimer.
+**       * Redistributions in binary form must reproduce the above copyright
+**         notice, this list of conditions and the following disclaimer in the
+**         documentation and/or other materials provided with the distribution.
+**       * Neither the name of the Monash University nor the names of its contributors
+**         may be used to endorse or promote products derived from this software
+**         without specific prior written permission.
+**
+** THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+** "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+** THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+** PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+** BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+** CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+** SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+** HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+** LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+** OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**
+**
+** Contact:
+*%  Owen Kaluza - Owen.Kaluza(at)monash.edu
+*%
+*% Development Team :
+*%  http://www.underworldproject.org/aboutus.html
+**
+**~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+
+#ifndef Codec__
+#define Codec__
+
+#include "Include.h"
+
+//Geometry record codecs, id stored per record in the database:
+//compressor in low 4 bits, prefilter in next 4 bits
+typedef enum
+{
+  lucCompressNone = 0,
+  lucCompressDeflate = 1,
+  lucCompressLZ = 2
+} lucCompressor;
+
+typedef enum
+{
+  lucFilterNone = 0,
+  lucFilterShuffle = 1,
+  lucFilterBitShuffle = 2
+} lucFilter;
+
+//Temporal delta against a record of the previous timestep, in bits 8-11,
+//records that are the first of a delta series flagged as keyframes
+typedef enum
+{
+  lucDeltaNone = 0,
+  lucDeltaXOR = 1,
+  lucDeltaDiff = 2
+} lucDelta;
+
+#define CODEC_ID(filter, compressor) ((filter) << 4 | (compressor))
+#define CODEC_COMPRESSOR(id) ((id) & 0xf)
+#define CODEC_FILTER(id) (((id) >> 4) & 0xf)
+#define CODEC_DELTA(id) (((id) >> 8) & 0xf)
+#define CODEC_WITH_DELTA(id, delta) ((id) | (delta) << 8)
+#define CODEC_KEYFRAME 0x1000
+
+class Codec
+{
+public:
+  static int lookup(const std::string& name);
+  static std::string name(int codec);
+
+  //Compress len bytes of src into dst with given codec, returns codec id applied,
+  //lucCompressNone if not smaller (typesize is element size for prefilter, level is deflate level)
+  static int encode(int codec, const unsigned char* src, unsigned long len, std::vector<unsigned char>& dst, unsigned int typesize=4, int level=6);
+  //Decompress to exactly dstlen bytes in dst
+  static bool decode(int codec, const unsigned char* src, unsigned long len, unsigned char* dst, unsigned long dstlen, unsigned int typesize=4);
+
+  //Prefilters, transpose bytes/bits of each element so similar bytes are adjacent
+  static void shuffle(const unsigned char* src, unsigned char* dst, unsigned long len, unsigned int typesize);
+  static void unshuffle(const unsigned char* src, unsigned char* dst, unsigned long len, unsigned int typesize);
+  static void bitshuffle(const unsigned char* src, unsigned char* dst, unsigned long len, unsigned int typesize);
+  static void bitunshuffle(const unsigned char* src, unsigned char* dst, unsigned long len, unsigned int typesize);
+
+  //Temporal delta of 32 bit words (xor or wrapping difference of bit patterns, both lossless)
+  static void delta(int mode, const unsigned char* src, const unsigned char* base, unsigned char* dst, unsigned long len);
+  static void undelta(int mode, unsigned char* data, const unsigned char* base, unsigned long len);
+
+  //128 bit content hash for detecting identical data blocks
+  static void hash(const unsigned char* src, unsigned long len, uint64_t digest[2]);
+
+  //Fast LZ77 block codec (lz4 style sequences), returns compressed size, 0 if no space
+  static unsigned long lzCompress(const unsigned char* src, unsigned long len, unsigned char* dst, unsigned long dstlen);
+  static bool lzDecompress(const unsigned char* src, unsigned long len, unsigned char* dst, unsigned long dstlen);
+
+  //Compare ratio and throughput of all codecs on a data block
+  static void benchmark(std::ostream& os, const std::string& label, const unsigned char* src, unsigned long len, unsigned int typesize, int level=6);
+  //Check byte exact round trips of every codec, prefilter, delta mode and the hash on a data block,
+  //part of it with odd length, zero length and incompressible data, reports and returns failures
+  static int verify(std::ostream& os, const std::string& label, const unsigned char* src, unsigned long len, unsigned int typesize, int level=6);
+};
+
+#endif //Codec__
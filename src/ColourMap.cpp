@@ -34,13 +34,13 @@
 **~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
 
 #include "ColourMap.h"
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
 //Safe log function for scaling
 #define LOG10(val) (val > FLT_MIN ? log10(val) : log10(FLT_MIN))
 
-//This can stay global as never actually modified, if it needs to be then move to State
-int ColourMap::samples = 4096;
-
 std::ostream & operator<<(std::ostream &os, const ColourVal& cv)
 {
   return os << cv.value << " --> " << cv.position << "=" << cv.colour;
@@ -51,8 +51,16 @@ ColourMap::ColourMap(DrawState& drawstate, std::string name, std::string props)
     minimum(0), maximum(1), name(name), texture(NULL),
     calibrated(false), noValues(false)
 {
+  samples = 4096;
   precalc = new Colour[samples];
+  Colour none;
+  none.value = 0;
+  std::fill(precalc, precalc + samples, none);
+  lutlog = interpolate = lutdiscrete = false;
+  lutmin = lutscale = lutbias = 0.0;
+  lutversion = 0;
   background.value = 0xff000000;
+  snap.version = 0;
 
   properties.parseSet(props);
 
@@ -64,6 +72,16 @@ ColourMap::ColourMap(DrawState& drawstate, std::string name, std::string props)
   }
 }
 
+void ColourMap::takeSnapshot()
+{
+  snap.logscale = properties["logscale"];
+  snap.locked = properties["locked"];
+  snap.discrete = properties["discrete"];
+  snap.samples = properties["lutsamples"];
+  snap.interpolate = properties["lutinterpolate"];
+  snap.version = properties.current();
+}
+
 void ColourMap::parse(std::string colourMapString)
 {
   noValues = false;
@@ -155,30 +173,63 @@ void ColourMap::add(float *components, float pvalue)
 void ColourMap::calc()
 {
   if (!colours.size()) return;
-  //Precalculate colours
-  if (properties["logscale"])
-    for (int cv=0; cv<samples; cv++)
-      precalc[cv] = get(pow(10, log10(minimum) + range * (float)cv/(samples-1)));
-  else
+  //Table only depends on the colours, their positions and sample count, when calibrated
+  //to a new range with these unchanged (eg: map shared by data with different ranges)
+  //only the transform is updated, so the version is not bumped
+  int count = lutCount();
+  bool rebuild = lutversion == 0 || count != samples || snap.discrete != lutdiscrete || colours.size() != lutcolours.size();
+  for (unsigned int i=0; !rebuild && i<colours.size(); i++)
+    rebuild = colours[i].colour.value != lutcolours[i].colour.value || colours[i].position != lutcolours[i].position;
+
+  if (rebuild)
+  {
+    //Resize lookup table if sample count changed
+    if (count != samples)
+    {
+      delete[] precalc;
+      samples = count;
+      precalc = new Colour[samples];
+    }
+
+    //Precalculate colours at even steps of the scaled value, in log space for log scales,
+    //so a lookup is the same transform as scaleValue() with no sampling distortion
     for (int cv=0; cv<samples; cv++)
-      precalc[cv] = get(minimum + range * (float)cv/(samples-1));
+      precalc[cv] = getFromScaled(cv / (float)(samples-1));
+    lutcolours = colours;
+    lutdiscrete = snap.discrete;
+    lutversion++;
+  }
+
+  //Transform from value (log10 of value for log scales) to table position
+  lutlog = snap.logscale;
+  interpolate = snap.interpolate && !snap.discrete;
+  lutmin = lutlog ? LOG10(minimum) : minimum;
+  float lutmax = lutlog ? LOG10(maximum) : maximum;
+  lutscale = lutmax != lutmin ? (samples-1) / (lutmax - lutmin) : 0.0;
+  //No range maps to the centre as in scaleValue()
+  lutbias = lutmax != lutmin ? 0.0 : 0.5 * (samples-1);
+  //Round to nearest entry when not interpolating
+  if (!interpolate) lutbias += 0.5;
 }
 
 void ColourMap::calibrate(float min, float max)
 {
-  //Skip calibration if min/max unchanged
-  if (!noValues && calibrated && min == minimum && max == maximum) return;
   //No colours?
   if (colours.size() == 0) return;
-  //Skip calibration when locked
-  if (properties["locked"]) return;
+  //Skip calibration if min/max unchanged or when locked,
+  //the lookup table of a calibrated map is still rebuilt if its sample count changed
+  if (snapshot().locked || (!noValues && calibrated && min == minimum && max == maximum))
+  {
+    if (calibrated && lutCount() != samples) calc();
+    return;
+  }
 
   if (min == HUGE_VAL) min = max;
   if (max == HUGE_VAL) max = min;
 
   minimum = min;
   maximum = max;
-  if (properties["logscale"])
+  if (snapshot().logscale)
     range = LOG10(maximum) - LOG10(minimum);
   else
     range = maximum - minimum;
@@ -259,18 +310,58 @@ void ColourMap::calibrate(FloatValues* dataValues)
 
 Colour ColourMap::getfast(float value)
 {
-  //NOTE: value caching DOES NOT WORK for log scales!
-  //If this is causing slow downs in future, need a better method
-  int c = 0;
-  if (properties["logscale"])
-    c = (int)((samples-1) * ((LOG10(value) - LOG10(minimum)) / range));
-  else
-    c = (int)((samples-1) * ((value - minimum) / range));
-  if (c > samples - 1) c = samples - 1;
-  if (c < 0) c = 0;
-  //std::cerr << value << " range : " << range << " : min " << minimum << ", max " << maximum << ", pos " << c << ", Colour " << precalc[c] << " uncached " << get(value) << std::endl;
-  //std::cerr << LOG10(value) << " range : " << range << " : Lmin " << LOG10(minimum) << ", max " << LOG10(maximum) << ", pos " << c << ", Colour " << precalc[c] << " uncached " << get(value) << std::endl;
-  return precalc[c];
+  return lookup(lutValue(value));
+}
+
+void ColourMap::lutTransform(float* range, float* flags)
+{
+  //Table parameters as used by lookup(): min, scale, bias, last entry and log, interpolate flags
+  range[0] = lutmin;
+  range[1] = lutscale;
+  range[2] = lutbias;
+  range[3] = samples - 1;
+  flags[0] = lutlog ? 1.0 : 0.0;
+  flags[1] = interpolate ? 1.0 : 0.0;
+}
+
+void ColourMap::mapBatch(const float* values, Colour* out, size_t n)
+{
+  //Same lookup as getfast() over an array, values of HUGE_VAL (no data) map to transparent
+  size_t i = 0;
+#ifdef __SSE2__
+  if (!interpolate)
+  {
+    __m128 vmin = _mm_set1_ps(lutmin);
+    __m128 vscale = _mm_set1_ps(lutscale);
+    __m128 vbias = _mm_set1_ps(lutbias);
+    __m128 vlast = _mm_set1_ps(samples - 1);
+    __m128 vzero = _mm_setzero_ps();
+    __m128 vnodata = _mm_set1_ps(HUGE_VALF);
+    for (; i + 4 <= n; i += 4)
+    {
+      __m128 v = _mm_loadu_ps(values + i);
+      __m128 x = v;
+      if (lutlog)
+        x = _mm_set_ps(lutValue(values[i+3]), lutValue(values[i+2]), lutValue(values[i+1]), lutValue(values[i]));
+      //Clamp to table, max first so NaN positions go to zero
+      __m128 f = _mm_add_ps(_mm_mul_ps(_mm_sub_ps(x, vmin), vscale), vbias);
+      f = _mm_min_ps(_mm_max_ps(f, vzero), vlast);
+      int idx[4];
+      _mm_storeu_si128((__m128i*)idx, _mm_cvttps_epi32(f));
+      __m128i col = _mm_set_epi32(precalc[idx[3]].value, precalc[idx[2]].value,
+                                  precalc[idx[1]].value, precalc[idx[0]].value);
+      __m128i nodata = _mm_castps_si128(_mm_cmpeq_ps(v, vnodata));
+      _mm_storeu_si128((__m128i*)(out + i), _mm_andnot_si128(nodata, col));
+    }
+  }
+#endif
+  for (; i < n; i++)
+  {
+    if (values[i] == HUGE_VALF)
+      out[i].value = 0;
+    else
+      out[i] = lookup(lutValue(values[i]));
+  }
 }
 
 Colour ColourMap::get(float value)
@@ -285,7 +376,7 @@ float ColourMap::scaleValue(float value)
   if (value <= min) return 0.0;
   if (value >= max) return 1.0;
 
-  if (properties["logscale"])
+  if (snapshot().logscale)
   {
     value = LOG10(value);
     min = LOG10(minimum);
@@ -321,7 +412,7 @@ Colour ColourMap::getFromScaled(float scaledValue)
     float interpolate = (scaledValue - colours[i-1].position) / (colours[i].position - colours[i-1].position);
 
     //printf(" interpolate %f above %f below %f\n", interpolate, colours[i].position, colours[i-1].position);
-    if (properties["discrete"])
+    if (snapshot().discrete)
     {
       //No interpolation
       if (interpolate < 0.5)
@@ -579,7 +670,7 @@ void ColourMap::loadTexture(bool repeat)
 {
   if (!texture) texture = new TextureData();
   calibrate(0, 1);
-  unsigned char paletteData[4*samples];
+  std::vector<unsigned char> paletteData(4*samples);
   Colour col;
   for (int i=0; i<samples; i++)
   {
@@ -593,7 +684,7 @@ void ColourMap::loadTexture(bool repeat)
 
   glActiveTexture(GL_TEXTURE0);
   glBindTexture(GL_TEXTURE_2D, texture->id);
-  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, samples, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, paletteData);
+  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, samples, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, paletteData.data());
   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
   //glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
@@ -57,11 +57,51 @@ public:
   ColourVal(Colour& colour) : colour(colour), value(HUGE_VAL), position(0) {}
 };
 
+//Typed copy of properties read per value, valid while version matches properties.current()
+struct ColourMapSnapshot
+{
+  unsigned int version;
+  bool logscale;
+  bool locked;
+  bool discrete;
+  int samples;
+  bool interpolate;
+};
+
 //ColourMap class
 class ColourMap
 {
-  static int samples;
+  //Lookup table sampled uniformly over the scaled [0,1] range (linear or log)
+  int samples;
   Colour* precalc;
+  bool lutlog;       //Table built for log scale
+  bool interpolate;  //Blend adjacent entries instead of taking the nearest
+  float lutmin, lutscale, lutbias; //Scaled value to table position
+  std::vector<ColourVal> lutcolours; //Colours and positions the table was built from
+  bool lutdiscrete;
+  ColourMapSnapshot snap;
+
+  //Value in the table's scaled units
+  inline float lutValue(float value)
+  {
+    return lutlog ? log10f(value > FLT_MIN ? value : FLT_MIN) : value;
+  }
+
+  //Table entry at scaled value x, positions outside the range are clamped
+  inline Colour lookup(float x)
+  {
+    float last = samples - 1;
+    float f = (x - lutmin) * lutscale + lutbias;
+    f = f > 0.0f ? f : 0.0f;
+    f = f < last ? f : last;
+    int c = (int)f;
+    if (!interpolate || c == samples - 1) return precalc[c];
+    float t = f - c;
+    Colour colour = precalc[c];
+    for (int i=0; i<4; i++)
+      colour.rgba[i] += (precalc[c+1].rgba[i] - colour.rgba[i]) * t;
+    return colour;
+  }
 
 public:
   std::vector<ColourVal> colours;
@@ -74,6 +114,7 @@ public:
   bool calibrated;
   bool noValues; //Use position data only
   TextureData* texture;
+  unsigned int lutversion; //Incremented whenever the lookup table is rebuilt
 
   ColourMap(DrawState& drawstate, std::string name="", std::string props="");
   ~ColourMap()
@@ -94,6 +135,12 @@ public:
   void calibrate(float min, float max);
   void calibrate(FloatValues* dataValues=NULL);
   Colour getfast(float value);
+  void mapBatch(const float* values, Colour* out, size_t n);
+  //Lookup table for shader side mapping
+  int lutSamples() {return samples;}
+  int lutCount() {int count = snapshot().samples; return count < 2 ? 2 : count;} //Samples set, applied by calc()
+  const Colour* lutTable() {return precalc;}
+  void lutTransform(float* range, float* flags);
   Colour get(float value);
   float scaleValue(float value);
   Colour getFromScaled(float scaledValue);
@@ -102,6 +149,12 @@ public:
   void loadTexture(bool repeat=false);
   void loadPalette(std::string data);
   void print();
+  const ColourMapSnapshot& snapshot()
+  {
+    if (snap.version != properties.current()) takeSnapshot();
+    return snap;
+  }
+  void takeSnapshot();
 };
 
 #endif //ColourMap__
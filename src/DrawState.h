@@ -12,6 +12,7 @@ public:
   //Properties
   json globals;
   json defaults;
+  PropertyCache globalcache; //Resolved globals by key id (main thread only)
 
   bool automate;
 
@@ -58,6 +59,7 @@ public:
   {
     defaults = json::object();
     globals = json::object();
+    Properties::changed();
 
     automate = false;
 
@@ -174,6 +176,8 @@ public:
     defaults["colourby"] = 0;
     // | object | integer [0,n] | Index of data set to apply transparency to object by (requires opacity map)
     defaults["opacityby"] = 1;
+    // | object | boolean | Compact in-memory storage of loaded data: values as 16-bit floats scaled to their range (error < range/4096), point positions as 16-bit integers quantised against the bounding box (error < size/131070), decoded when rendered
+    defaults["compact"] = false;
 
     // | object(line) | real | Line length limit, can be used to skip drawing line segments that cross periodic boundary
     defaults["limit"] = 0;
@@ -299,6 +303,10 @@ public:
     defaults["range"] = {0.0, 0.0};
     // | colourmap | boolean | Set to true to lock colourmap ranges to current values
     defaults["locked"] = false;
+    // | colourmap | integer | Number of entries in the colour lookup table, sampled evenly over the linear or log scale
+    defaults["lutsamples"] = 4096;
+    // | colourmap | boolean | Blend between adjacent lookup table entries instead of using the nearest (ignored when discrete)
+    defaults["lutinterpolate"] = false;
 
     // | view | string | Title to display at top centre of view
     defaults["title"] = "";
@@ -363,6 +371,32 @@ public:
     defaults["background"] = {0, 0, 0, 255};
     // | global | boolean | Disables initial loading of object data from database, only object names loaded, use the "load" command to subsequently load selected object data
     defaults["noload"] = false;
+    // | global | boolean | Load geometry data records from database directly into pre-sized data stores using incremental blob i/o, disable to read via intermediate buffers
+    defaults["directload"] = true;
+    // | global | integer | Threads used to decompress geometry records with direct load, 0 = number of cores, 1 = no threading
+    defaults["loadthreads"] = 0;
+    // | global | boolean | Create index on geometry table (timestep, object_id) when missing from database files being loaded, requires write access
+    defaults["dbindex"] = false;
+    // | global | integer | Maximum timestep database files kept attached for re-use when data is split into a file per step, limited by SQLite (usually 10)
+    defaults["attachpool"] = 8;
+    // | global | integer | Number of following timestep database files to attach in advance when data is split into a file per step
+    defaults["attachahead"] = 0;
+    // | global | real[6] | Load only geometry records with bounds intersecting this box [minX,minY,minZ,maxX,maxY,maxZ], requires database with spatial index, empty = load all
+    defaults["region"] = json::array();
+    // | global | integer | Threads used to compress geometry records when exporting a database, 0 = number of cores, 1 = no threading
+    defaults["writethreads"] = 0;
+    // | global | integer | Split exported point, shape, vector and unindexed triangle data into records of at most this many vertices, each with its own bounds, 0 = no splitting
+    defaults["chunksize"] = 0;
+    // | global | string | Compression codec for exported geometry records: deflate, lz or none, prefixed with shuffle- or bitshuffle- to apply a byte/bit shuffle filter to float data first (eg: shuffle-deflate)
+    defaults["codec"] = "deflate";
+    // | global | integer | Compression level (1-9) when exporting geometry records with a deflate codec
+    defaults["compresslevel"] = 6;
+    // | global | string | Temporal delta encoding of exported vertex and value data against the previous timestep: xor or diff, empty = disabled
+    defaults["delta"] = "";
+    // | global | integer | Timesteps between keyframes (full data records) when exporting with delta encoding
+    defaults["deltakeyframe"] = 10;
+    // | global | boolean | Store exported geometry records with data identical to an earlier record (eg: fixed mesh connectivity in every timestep) as a reference to it, loaded data shared between timesteps
+    defaults["dedup"] = false;
     // | global | boolean | Enable rendering points as proper 3d spherical meshes
     defaults["pointspheres"] = false;
     // | global | boolean | Enable transparent png output
@@ -397,10 +431,20 @@ public:
     defaults["pointattribs"] = true;
     // | global | boolean | Point distance size attenuation (points shrink when further from viewer ie: perspective)
     defaults["pointattenuate"] = true;
+    // | global | boolean | Map colour values through colourmaps in the point, line and surface shaders, colourmap edits then skip the vertex buffer reload (requires more GPU ram)
+    defaults["gpucolour"] = false;
+    // | global | boolean | Apply data filters to points in the shaders, filter range changes then only update the shader parameters (up to 3 filters on each of the first 16 point objects, others filtered on CPU)
+    defaults["gpufilter"] = false;
+    // | global | boolean | Bake data filters into exported point data, filtered points are left out (evaluated on CPU, including when filtering in the shaders)
+    defaults["bakefilters"] = false;
     // | global | integer | Automatic depth sorting, -1=on, 0=disabled, >0=timer
     defaults["sort"] = -1;
     // | global | boolean | Cache timestep varying data in ram
     defaults["cache"] = false;
+    // | global | integer | Memory limit in mb for cached timestep data, least recently used steps are freed when exceeded, 0 = no limit
+    defaults["cachesize"] = 0;
+    // | global | integer | Number of following timesteps to load in the background while current step is displayed, 0 = disabled
+    defaults["prefetch"] = 0;
     // | global | boolean | Cache timestep varying data on gpu as well as ram (will only work for small models)
     defaults["gpucache"] = false;
 
@@ -410,6 +454,10 @@ public:
 #ifdef DEBUG
     //std::cerr << std::setw(2) << defaults << std::endl;
 #endif
+
+    //Intern all documented property keys
+    for (json::iterator it = defaults.begin(); it != defaults.end(); ++it)
+      PropertyKeys::id(it.key());
   }
 
   json& global(const std::string& key)
@@ -418,6 +466,20 @@ public:
     return defaults[key];
   }
 
+  void setGlobal(const std::string& key, const json& value)
+  {
+    if (globals.count(key) > 0 && globals[key] == value) return;
+    globals[key] = value;
+    Properties::changed();
+  }
+
+  const json& global(unsigned int id)
+  {
+    const json* value = globalcache.get(id, Properties::globalversion);
+    if (value) return *value;
+    return globalcache.set(id, global(PropertyKeys::name(id)));
+  }
+
   // Calculates a set of points on a unit circle for a given number of segments
   // Used to optimised rendering circular objects when segment count isn't changed
   void cacheCircleCoords(int segment_count)
@@ -42,7 +42,7 @@ DrawingObject::DrawingObject(DrawState& drawstate, std::string name, std::string
   texture = NULL;
   skip = drawstate.global("noload");
   //Name set in properties overrides that passed from database
-  properties.data["name"] = name;
+  properties.set("name", name);
 
   //Fix any names with spaces
   std::replace(name.begin(), name.end(), ' ', '_');
@@ -50,12 +50,13 @@ DrawingObject::DrawingObject(DrawState& drawstate, std::string name, std::string
   properties.parseSet(props);
 
   //All props now lowercase, fix a couple of legacy camelcase values
-  if (properties.has("pointSize")) {properties.data["pointsize"] = properties["pointSize"]; properties.data.erase("pointSize");}
+  if (properties.has("pointSize")) {properties.set("pointsize", properties["pointSize"]); properties.erase("pointSize");}
 
-  properties.data["visible"] = true;
+  properties.set("visible", true);
   colourIdx = 0; //Default colouring data is first value block
   opacityIdx = 1;
   colourMap = opacityMap = NULL;
+  snap.version = 0;
   setup();
 }
 
@@ -65,6 +66,15 @@ DrawingObject::~DrawingObject()
     delete texture;
 }
 
+void DrawingObject::takeSnapshot()
+{
+  snap.visible = properties["visible"];
+  snap.scaling = properties["scaling"];
+  snap.scaleshapes = properties["scaleshapes"];
+  snap.scalevectors = properties["scalevectors"];
+  snap.version = properties.current();
+}
+
 void DrawingObject::setup()
 {
   //Cache values for faster lookups during draw calls
@@ -104,7 +114,7 @@ TextureData* DrawingObject::useTexture(ImageLoader* tex)
       {
         if (texfn.length() > 0) debug_print("Texture File: %s not found!\n", texfn.c_str());
         //If load failed, skip from now on
-        properties.data["texturefile"] = "";
+        properties.set("texturefile", "");
       }
     }
   }
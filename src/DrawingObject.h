@@ -43,6 +43,16 @@
 
 class ColourMap;
 
+//Typed copy of properties read in inner loops, valid while version matches properties.current()
+struct ObjectSnapshot
+{
+  unsigned int version;
+  bool visible;
+  float scaling;
+  float scaleshapes;
+  float scalevectors;
+};
+
 //Holds parameters for a drawing object
 class DrawingObject
 {
@@ -57,6 +67,7 @@ public:
   unsigned int opacityIdx;
   ColourMap* colourMap; //Cached references
   ColourMap* opacityMap;
+  ObjectSnapshot snap;
 
   //Object properties data...
   Properties properties;
@@ -67,6 +78,12 @@ public:
   ~DrawingObject();
 
   void setup();
+  const ObjectSnapshot& snapshot()
+  {
+    if (snap.version != properties.current()) takeSnapshot();
+    return snap;
+  }
+  void takeSnapshot();
   TextureData* useTexture(ImageLoader* tex=NULL);
   std::string name() {return properties["name"];}
 };
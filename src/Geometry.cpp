@@ -38,6 +38,11 @@
 //Init static, names list
 std::string GeomData::names[lucMaxType] = {"labels", "points", "quads", "triangles", "vectors", "tracers", "lines", "shapes", "volume"};
 
+//Interned id of the shader colour mapping switch
+static const unsigned int gpucolourKey = PropertyKeys::id("gpucolour");
+static const unsigned int gpufilterKey = PropertyKeys::id("gpufilter");
+static const unsigned int bakefiltersKey = PropertyKeys::id("bakefilters");
+
 //Track min/max coords
 void GeomData::checkPointMinMax(float *coord)
 {
@@ -48,8 +53,12 @@ void GeomData::checkPointMinMax(float *coord)
 void GeomData::calcBounds()
 {
   //Loop through vertices and calculate bounds automatically for all elements
+  float vertex[3];
   for (unsigned int j=0; j < count; j++)
-    checkPointMinMax(vertices[j]);
+  {
+    vertices.get(j, vertex);
+    checkPointMinMax(vertex);
+  }
 }
 
 void GeomData::label(std::string& labeltext)
@@ -175,6 +184,91 @@ void GeomData::getColour(Colour& colour, unsigned int idx)
     colour.a *= draw->opacity;
 }
 
+//Batched getColour(), fills out[0,n) with the colours of vertex indices [start,start+n)
+void GeomData::fillColours(Colour* out, unsigned int start, unsigned int n)
+{
+  if (n == 0) return;
+  //Indices past the end of the colour source use its last entry, as in getColour()
+  unsigned int size = 0;
+  const float* mapped = NULL; //Values mapped through colourmap, HUGE_VAL entries stay transparent
+  std::vector<float> buffer;
+  ColourMap* cmap = draw->colourMap;
+  FloatValues* vals = colourData();
+  if (cmap && vals)
+  {
+    size = vals->size();
+    buffer.resize(n);
+    fillValues(buffer.data(), start, n);
+    mapped = buffer.data();
+    cmap->mapBatch(mapped, out, n);
+  }
+  else if (colours.size() > 0)
+  {
+    size = colours.size();
+    for (unsigned int j=0; j<n; j++)
+      out[j].value = colours[min(start + j, size - 1)];
+  }
+  else if (luminance.size() > 0)
+  {
+    size = luminance.size();
+    for (unsigned int j=0; j<n; j++)
+    {
+      out[j].r = out[j].g = out[j].b = luminance[min(start + j, size - 1)];
+      out[j].a = 255;
+    }
+  }
+  else
+  {
+    std::fill(out, out + n, draw->colour);
+  }
+
+  //Set opacity using own value map...
+  ColourMap* omap = draw->opacityMap;
+  FloatValues* ovals = valueData(draw->opacityIdx);
+  if (omap && ovals && ovals->size() > draw->opacityIdx)
+  {
+    unsigned int osize = ovals->size();
+    std::vector<float> obuffer(n);
+    for (unsigned int j=0; j<n; j++)
+    {
+      unsigned int idx = start + j;
+      if (size && idx >= size) idx = size - 1;
+      if (idx >= osize) idx = osize - 1;
+      obuffer[j] = (*ovals)[idx];
+    }
+    std::vector<Colour> ocolours(n);
+    omap->mapBatch(obuffer.data(), ocolours.data(), n);
+    for (unsigned int j=0; j<n; j++)
+    {
+      if (mapped && mapped[j] == HUGE_VALF) continue;
+      //Opacity values are not treated as missing data, use the plain lookup
+      out[j].a = obuffer[j] == HUGE_VALF ? omap->getfast(obuffer[j]).a : ocolours[j].a;
+    }
+  }
+
+  //Apply opacity from drawing object override level if set
+  if (draw->opacity > 0.0 && draw->opacity < 1.0)
+  {
+    for (unsigned int j=0; j<n; j++)
+      if (!mapped || mapped[j] != HUGE_VALF)
+        out[j].a *= draw->opacity;
+  }
+}
+
+void GeomData::fillValues(float* out, unsigned int start, unsigned int n)
+{
+  //Raw colour values, indices past the end use the last value as in fillColours()
+  FloatValues* vals = colourData();
+  unsigned int size = vals ? vals->size() : 0;
+  if (size == 0)
+    std::fill(out, out + n, 0.0f);
+  else if (start + n <= size)
+    vals->decode(start, n, out);
+  else
+    for (unsigned int j=0; j<n; j++)
+      out[j] = (*vals)[min(start + j, size - 1)];
+}
+
 unsigned int GeomData::valuesLookup(const json& by)
 {
   //Gets a valid value index by property, either actual index or string label
@@ -183,15 +277,11 @@ unsigned int GeomData::valuesLookup(const json& by)
   {
     //Lookup index from label
     std::string label = by;
-    for (unsigned int j=0; j < values.size(); j++)
-    {
-      if (values[j]->label == label)
-      {
-        valueIdx = j;
-        break;
-      }
-    }
-    debug_print("Label: %s not found!\n", label.c_str());
+    int j = valuesIndex(label);
+    if (j >= 0)
+      valueIdx = j;
+    else
+      debug_print("Label: %s not found!\n", label.c_str());
   }
   else if (by.is_number())
     valueIdx = by;
@@ -202,107 +292,237 @@ unsigned int GeomData::valuesLookup(const json& by)
   return valueIdx;
 }
 
-//Returns true if vertex/voxel is to be filtered (don't display)
-bool GeomData::filter(unsigned int idx)
+int GeomData::valuesIndex(const std::string& label)
 {
-  //On the first index, cache the filter data
-  if (idx == 0)
+  //Index of first value data with label, -1 if none
+  //(cached index is checked as values may be replaced or relabelled directly)
+  auto it = valueindex.find(label);
+  if (it != valueindex.end() && it->second < values.size() && values[it->second]->label == label)
+    return it->second;
+  for (unsigned int j=0; j < values.size(); j++)
   {
+    if (values[j]->label == label)
+    {
+      valueindex[label] = j;
+      return j;
+    }
+  }
+  return -1;
+}
+
+void GeomData::filterSetup()
+{
+  //Read the filters and the current inputs of each,
+  //previous evaluations are kept with the filter in the same position
+  json filters = draw->properties["filters"];
+  std::vector<Filter> cache;
+  for (unsigned int i=0; i < filters.size(); i++)
+  {
+    float min = filters[i]["minimum"];
+    float max = filters[i]["maximum"];
+    if (min == max) continue; //Skip
+
     //The cache stores filter values so we can avoid 
     //hitting the json store for every vertex (very slow)
-    filterCache.clear();
-    json filters = draw->properties["filters"];
-    for (unsigned int i=0; i < filters.size(); i++)
+    Filter f;
+    f.dataIdx = valuesLookup(filters[i]["by"]);
+    f.map = filters[i]["map"];
+    f.out = filters[i]["out"];
+    f.inclusive = filters[i]["inclusive"];
+    if (min > max)
+    {
+      //Swap and change to an out filter
+      f.minimum = max;
+      f.maximum = min;
+      f.out = !f.out;
+      //Also flip the inclusive flag
+      f.inclusive = !f.inclusive;
+    }
+    else
     {
-      float min = filters[i]["minimum"];
-      float max = filters[i]["maximum"];
-      if (min == max) continue; //Skip
-
-      int j = filterCache.size();
-      filterCache.push_back(Filter());
-      filterCache[j].dataIdx = valuesLookup(filters[i]["by"]);
-      filterCache[j].map = filters[i]["map"];
-      filterCache[j].out = filters[i]["out"];
-      filterCache[j].inclusive = filters[i]["inclusive"];
-      if (min > max)
+      f.minimum = min;
+      f.maximum = max;
+    }
+
+    unsigned int j = cache.size();
+    if (j < filterCache.size())
+    {
+      f.mask.swap(filterCache[j].mask);
+      f.evaluated = filterCache[j].evaluated;
+    }
+
+    FilterState& state = f.state;
+    if (f.dataIdx < MAX_DATA_ARRAYS && values.size() > f.dataIdx && values[f.dataIdx] && values[f.dataIdx]->size() > 0)
+    {
+      state.source = values[f.dataIdx];
+      state.revision = state.source->revision;
+    }
+
+    //Range to compare values against
+    state.lower = f.minimum;
+    state.upper = f.maximum;
+    state.out = f.out;
+    state.inclusive = f.inclusive;
+    if (state.source && f.map)
+    {
+      //Range type filters map over available values on [0,1] => [min,max]
+      //If a colourmap is provided, that is used to get the values (allows log maps)
+      //Otherwise they come directly from the data 
+      state.cmap = draw->colourMap;
+      if (state.cmap)
       {
-        //Swap and change to an out filter
-        filterCache[j].minimum = max;
-        filterCache[j].maximum = min;
-        filterCache[j].out = !filterCache[j].out;
-        //Also flip the inclusive flag
-        filterCache[j].inclusive = !filterCache[j].inclusive;
+        state.cmin = state.cmap->minimum;
+        state.cmax = state.cmap->maximum;
+        state.clog = state.cmap->snapshot().logscale;
       }
       else
       {
-        filterCache[j].minimum = min;
-        filterCache[j].maximum = max;
+        float range = state.source->maximum - state.source->minimum;
+        state.lower = state.source->minimum + f.minimum * range;
+        state.upper = state.source->minimum + f.maximum * range;
       }
     }
+    cache.push_back(f);
+  }
+  filterCache.swap(cache);
+}
+
+bool GeomData::filterMask()
+{
+  //Bring the filter mask up to date, returns false if no filters apply
+  //Each filter's mask is only re-evaluated when its range, source data or colour mapping
+  //has changed, so editing one filter doesn't repeat the work for the others
+  unsigned int filters = filterCache.size();
+  filterSetup();
+  if (filterCache.size() == 0 && filters == 0)
+  {
+    filterCount = 0;
+    return false;
+  }
+
+  //Iterate all the filters, re-evaluate any that are out of date
+  bool rebuild = filterCache.size() != filters;
+  for (unsigned int i=0; i < filterCache.size(); i++)
+  {
+    Filter& f = filterCache[i];
+    if (f.state == f.evaluated) continue;
+    f.evaluated = f.state;
+    filterEvaluate(f);
+    rebuild = true;
   }
 
-  //Iterate all the filters,
-  // - if a value matches a filter condition return true (filtered)
-  // - if no filters hit, returns false
-  float value, min, max;
-  int size, range;
-  unsigned int ridx;
+  if (!rebuild && filterCount == count)
+    return filterCount > 0;
+
+  //Combine into a mask over all indices,
+  //values not enough for per-vertex are spread over range (eg: per triangle)
+  filterCount = filterCache.size() ? count : 0;
+  filterBits.assign((filterCount + 31) / 32, 0);
   for (unsigned int i=0; i < filterCache.size(); i++)
   {
-    if (values.size() <= filterCache[i].dataIdx || !values[filterCache[i].dataIdx]) continue;
-    size = values[filterCache[i].dataIdx]->size();
-    if (filterCache[i].dataIdx < MAX_DATA_ARRAYS && size > 0)
+    Filter& f = filterCache[i];
+    if (!f.evaluated.source) continue;
+    unsigned int size = f.evaluated.source->size();
+    unsigned int range = count / size;
+    if (range <= 1)
+    {
+      unsigned int words = min(filterBits.size(), f.mask.size());
+      for (unsigned int w=0; w < words; w++)
+        filterBits[w] |= f.mask[w];
+    }
+    else
     {
-      //Have values but not enough for per-vertex? spread over range (eg: per triangle)
-      range = count / size;
-      ridx = idx;
-      if (range > 1) ridx = idx / range;
-
-      //std::cout << "Filtering on index: " << filter.dataIdx << " " << size << " values" << std::endl;
-      min = filterCache[i].minimum;
-      max = filterCache[i].maximum;
-      if (filterCache[i].map)
+      for (unsigned int idx=0; idx < count; idx++)
       {
-        //Range type filters map over available values on [0,1] => [min,max]
-        //If a colourmap is provided, that is used to get the values (allows log maps)
-        //Otherwise they come directly from the data 
-        ColourMap* cmap = draw->colourMap;
-        if (cmap)
-          value = cmap->scaleValue(values[filterCache[i].dataIdx]->value[ridx]);
-        else
-        {
-          value = values[filterCache[i].dataIdx]->maximum - values[filterCache[i].dataIdx]->minimum;
-          min = values[filterCache[i].dataIdx]->minimum + min * value;
-          max = values[filterCache[i].dataIdx]->minimum + max * value;
-          value = values[filterCache[i].dataIdx]->value[ridx];
-        }
+        unsigned int ridx = idx / range;
+        if (ridx < size && (f.mask[ridx >> 5] >> (ridx & 31)) & 1)
+          filterBits[idx >> 5] |= 1u << (idx & 31);
       }
-      else
-        value = values[filterCache[i].dataIdx]->value[ridx];
+    }
+  }
+  return filterCount > 0;
+}
 
-      //if (idx%10000==0) std::cout << min << " < " << value << " < " << max << std::endl;
-      
-      //"out" flag indicates values between the filter range are skipped - exclude
-      if (filterCache[i].out)
-      {
-        //Filter out values between specified ranges (allows filtering separate sections)
-        if (filterCache[i].inclusive && value >= min && value <= max) 
-          return true;
-        if (value > min && value < max) 
-          return true;
-      }
-      //Default is to filter values NOT in the filter range - include those that are
-      else
-      {
-        //Filter out values unless between specified ranges (allows combining filters)
-        if (filterCache[i].inclusive && (value <= min || value >= max))
-          return true;
-        if (value < min || value > max)
-          return true;
-      }
+//Sets hit for each value matching the filter condition
+// - "out" filters hit values between the filter range (allows filtering separate sections)
+// - default is to hit values NOT in the filter range (allows combining filters)
+template <bool out, bool inclusive>
+static inline void filterKernel(const float* values, unsigned int n, float min, float max, unsigned char* hit)
+{
+  //Branch free so the compiler can vectorise
+  for (unsigned int j=0; j<n; j++)
+  {
+    float value = values[j];
+    if (out)
+      hit[j] = inclusive ? (value >= min) & (value <= max) : (value > min) & (value < max);
+    else
+      hit[j] = inclusive ? (value <= min) | (value >= max) : (value < min) | (value > max);
+  }
+}
+
+void GeomData::filterEvaluate(Filter& f)
+{
+  //Evaluate the filter over all values in blocks
+  FilterState& state = f.evaluated;
+  f.mask.clear();
+  if (!state.source) return;
+  unsigned int size = state.source->size();
+  f.mask.assign((size + 31) / 32, 0);
+  const unsigned int block = 1024;
+  float buffer[block];
+  unsigned char hit[block];
+  for (unsigned int i=0; i < size; i += block)
+  {
+    unsigned int n = min(block, size - i);
+    //(decoded if compact)
+    state.source->decode(i, n, buffer);
+    if (state.cmap)
+    {
+      for (unsigned int j=0; j<n; j++)
+        buffer[j] = state.cmap->scaleValue(buffer[j]);
+    }
+
+    if (state.out && state.inclusive)
+      filterKernel<true, true>(buffer, n, state.lower, state.upper, hit);
+    else if (state.out)
+      filterKernel<true, false>(buffer, n, state.lower, state.upper, hit);
+    else if (state.inclusive)
+      filterKernel<false, true>(buffer, n, state.lower, state.upper, hit);
+    else
+      filterKernel<false, false>(buffer, n, state.lower, state.upper, hit);
+
+    //Pack into mask (blocks start on a word boundary)
+    for (unsigned int j=0; j<n; j+=32)
+    {
+      uint32_t bits = 0;
+      unsigned int m = min(32u, n - j);
+      for (unsigned int b=0; b<m; b++)
+        bits |= (uint32_t)hit[j+b] << b;
+      f.mask[(i + j) >> 5] = bits;
     }
   }
-  return false;
+}
+
+bool GeomData::filterValues(Filter& f, float* out)
+{
+  //Values compared by the filter for each index, as scaled for comparison,
+  //(for filtering in the shaders) false if not all indices have a value
+  FilterState& state = f.state;
+  if (!state.source || count == 0) return false;
+  unsigned int size = state.source->size();
+  unsigned int range = count / size;
+  if (range < 1) range = 1;
+  if ((count - 1) / range >= size) return false;
+  std::vector<float> buffer(size);
+  state.source->decode(0, size, buffer.data());
+  if (state.cmap)
+  {
+    for (unsigned int j=0; j<size; j++)
+      buffer[j] = state.cmap->scaleValue(buffer[j]);
+  }
+  for (unsigned int idx=0; idx < count; idx++)
+    out[idx] = buffer[idx / range];
+  return true;
 }
 
 FloatValues* GeomData::colourData() 
@@ -314,7 +534,7 @@ float GeomData::colourData(unsigned int idx)
 {
   if (values.size() == 0 || values.size() <= draw->colourIdx) return HUGE_VALF;
   FloatValues* fv = values[draw->colourIdx];
-  return fv->value[idx];
+  return (*fv)[idx];
 }
 
 FloatValues* GeomData::valueData(unsigned int vidx)
@@ -326,7 +546,7 @@ FloatValues* GeomData::valueData(unsigned int vidx)
 float GeomData::valueData(unsigned int vidx, unsigned int idx)
 {
   FloatValues* fv = valueData(vidx);
-  return fv ? fv->value[idx] : HUGE_VALF;
+  return fv ? (*fv)[idx] : HUGE_VALF;
 }
 
 Geometry::Geometry(DrawState& drawstate) : drawstate(drawstate), 
@@ -334,6 +554,8 @@ Geometry::Geometry(DrawState& drawstate) : drawstate(drawstate),
                        allhidden(false), internal(false), unscale(false),
                        type(lucMinType), total(0), redraw(true), reload(true)
 {
+  colourtables = NULL;
+  filterversion = 0;
 }
 
 Geometry::~Geometry()
@@ -345,6 +567,9 @@ Geometry::~Geometry()
 //Virtuals to implement
 void Geometry::close() //Called on quit or gl context destroy
 {
+  if (colourtables) delete colourtables;
+  colourtables = NULL;
+  tablerows.clear();
   reload = true;
 }
 
@@ -361,6 +586,7 @@ void Geometry::clear(bool all)
     if (all || !geom[i]->draw->properties["static"])
     {
       //std::cout << " deleting geom: " << i << " : " << geom[i]->draw->name() << std::endl;
+      latest.erase(geom[idx]->draw);
       delete geom[idx];
       if (!all) 
       {
@@ -376,11 +602,16 @@ void Geometry::clear(bool all)
   }
   if (all) geom.clear();
   //if (all) std::cout << " deleting all geometry " << std::endl;
+
+  //Restore index of static data kept
+  for (unsigned int i=0; i<geom.size(); i++)
+    latest[geom[i]->draw] = geom[i];
 }
 
 void Geometry::remove(DrawingObject* draw)
 {
   reload = true;
+  latest.erase(draw);
   for (int i = geom.size()-1; i>=0; i--)
   {
     if (draw == geom[i]->draw)
@@ -431,7 +662,9 @@ void Geometry::dump(std::ostream& csv, DrawingObject* draw)
         //Only supports dump of vertex, vector and scalar colour value
         for (unsigned int v=0; v < geom[i]->count; v++)
         {
-          csv << geom[i]->vertices[v][0] << ',' <<  geom[i]->vertices[v][1] << ',' << geom[i]->vertices[v][2];
+          float vertex[3];
+          geom[i]->vertices.get(v, vertex);
+          csv << vertex[0] << ',' <<  vertex[1] << ',' << vertex[2];
 
           if (geom[i]->colourData() && geom[i]->colourData()->size() == geom[i]->count)
             csv << ',' << geom[i]->colourData(v);
@@ -479,6 +712,12 @@ void Geometry::jsonExportAll(DrawingObject* draw, json& obj, bool encode)
     {
       std::cerr << "Collecting data for " << draw->name() << ", " << geom[index]->count << " vertices (" << index << ")" << std::endl;
       json data;
+      //Points removed by filters are left out if baking filters into the export
+      //(evaluated on CPU, including those filtered in the shaders)
+      std::vector<unsigned int> keep;
+      bool bake = type == lucPointType && drawstate.global(bakefiltersKey) && geom[index]->filterMask();
+      for (unsigned int v=0; bake && v < geom[index]->count; v++)
+        if (!geom[index]->filter(v)) keep.push_back(v);
       for (int data_type=lucMinDataType; data_type<=lucMaxDataType; data_type++)
       {
         DataContainer* dat = geom[index]->data[data_type];
@@ -501,23 +740,50 @@ void Geometry::jsonExportAll(DrawingObject* draw, json& obj, bool encode)
 
         unsigned int length = dat->size() * sizeof(float);
 
+        //Compact data decoded to a copy, the store is left as is
+        std::vector<float> decoded;
+        FloatValues* fvals = dynamic_cast<FloatValues*>(dat);
+        if (fvals && fvals->compacted())
+        {
+          decoded.resize(dat->size());
+          fvals->decode(0, dat->size(), decoded.data());
+        }
+        const unsigned int* raw = decoded.size() ? (unsigned int*)decoded.data() : (unsigned int*)(dat->size() ? dat->ref(0) : NULL);
+
+        //Copy of per vertex data without the filtered vertices
+        std::vector<unsigned int> baked;
+        if (bake && dat->count() == geom[index]->count)
+        {
+          unsigned int unit = dat->unitsize();
+          baked.reserve(keep.size() * unit);
+          for (unsigned int v : keep)
+            for (unsigned int c=0; c<unit; c++)
+              baked.push_back(raw[v * unit + c]);
+          length = baked.size() * sizeof(float);
+        }
+
         if (length > 0)
         {
+          unsigned int count = length / sizeof(float);
           el["size"] = dsizes[data_type];
-          el["count"] = (int)dat->size();
+          el["count"] = (int)count;
           if (encode)
-            el["data"] = base64_encode(reinterpret_cast<const unsigned char*>(dat->ref(0)), length);
+          {
+            const void* src = bake && baked.size() ? baked.data() : raw;
+            el["data"] = base64_encode(reinterpret_cast<const unsigned char*>(src), length);
+          }
           else
           {
             //TODO: Support export of custom value data (not with pre-defined label)
             //      include minimum/maximum/label fields
             json values;
-            for (unsigned int j=0; j<dat->size(); j++)
+            for (unsigned int j=0; j<count; j++)
             {
+              const unsigned int* src = bake && baked.size() ? &baked[j] : &raw[j];
               if (data_type == lucIndexData || data_type == lucRGBAData)
-                values.push_back((int)*reinterpret_cast<unsigned int*>(dat->ref(j)));
+                values.push_back((int)*src);
               else
-                values.push_back((float)*reinterpret_cast<float*>(dat->ref(j)));
+                values.push_back(*reinterpret_cast<const float*>(src));
             }
             el["data"] = values;
           }
@@ -580,7 +846,7 @@ void Geometry::showObj(DrawingObject* draw, bool state)
     if (!draw || geom[i]->draw == draw)
     {
       if (draw) hidden[i] = !state;
-      geom[i]->draw->properties.data["visible"] = state;
+      geom[i]->draw->properties.set("visible", state);
     }
   }
   redraw = true;
@@ -620,6 +886,34 @@ void Geometry::redrawObject(DrawingObject* draw)
   }
 }
 
+void Geometry::recolourObject(DrawingObject* draw)
+{
+  //Colour map change, only reload if any data of this object has colours mapped on CPU
+  draw->setup();
+  for (unsigned int i = 0; i < geom.size(); i++)
+  {
+    if (geom[i]->draw == draw && (i >= colourslots.size() || colourslots[i] < 0 || !shaderColours(i)))
+    {
+      redrawObject(draw);
+      return;
+    }
+  }
+}
+
+void Geometry::refilterObject(DrawingObject* draw)
+{
+  //Filter change, only reload if any data of this object is filtered on CPU
+  //or the values compared in the shaders have changed (otherwise only the ranges)
+  for (unsigned int i = 0; i < geom.size(); i++)
+  {
+    if (geom[i]->draw == draw && !filtersLoaded(i))
+    {
+      redrawObject(draw);
+      return;
+    }
+  }
+}
+
 void Geometry::init() //Called on GL init
 {
   reload = true;
@@ -686,7 +980,7 @@ void Geometry::setState(unsigned int i, Shader* prog)
     glEnable(GL_LIGHTING);
 
   //Textured?
-  TextureData* texture = draw->useTexture(geom[i]->texture);
+  TextureData* texture = draw->useTexture(geom[i]->texture.get());
   GL_Error_Check;
   if (texture)
   {
@@ -794,6 +1088,251 @@ void Geometry::draw()  //Display saved geometry
   GL_Error_Check;
 }
 
+bool Geometry::loadColourSlots()
+{
+  //Called before filling the vertex buffer, true if raw values are to be included for shader colour mapping
+  colourslots.clear();
+  if (!drawstate.global(gpucolourKey)) return false;
+  colourslots.resize(geom.size(), -1);
+  return true;
+}
+
+bool Geometry::shaderColours(unsigned int i)
+{
+  //Colours of geom[i] can be mapped in the shaders, opacity maps are only applied on CPU
+  //Requires cached colourmaps from DrawingObject::setup()
+  DrawingObject* draw = geom[i]->draw;
+  return i < MAX_COLOURMAP_SLOTS && draw->colourMap && geom[i]->colourData() && !draw->opacityMap;
+}
+
+int Geometry::colourSlot(unsigned int i)
+{
+  //Records the slot used to map colours of geom[i] in the shaders, -1 when mapped on CPU
+  if (i >= colourslots.size()) return -1;
+  colourslots[i] = shaderColours(i) ? i : -1;
+  return colourslots[i];
+}
+
+GLint Geometry::useColourMaps(Shader* prog, int stride, size_t offset)
+{
+  //Sets up the value attribute, returns its location if enabled
+  if (!prog || !prog->program || !prog->attribs.count("aColourValue")) return -1;
+  GLint attrib = prog->attribs["aColourValue"];
+  if (attrib < 0) return -1;
+  if (colourslots.empty())
+  {
+    //Constant slot of -1, use the vertex colours
+    glVertexAttrib2f(attrib, 0.0, -1.0);
+    return -1;
+  }
+
+  //Table width to fit the largest lookup table (sample count applied when calibrated)
+  int width = 2;
+  for (unsigned int i=0; i<colourslots.size(); i++)
+  {
+    if (colourslots[i] >= 0 && geom[i]->draw->colourMap)
+    {
+      ColourMap* cmap = geom[i]->draw->colourMap;
+      width = max(width, max(cmap->lutCount(), cmap->lutSamples()));
+    }
+  }
+
+  if (!colourtables)
+  {
+    colourtables = new TextureData();
+    //Own unit, 2d textures use 0 and volume textures 1
+    colourtables->unit = 2;
+  }
+  glActiveTexture(GL_TEXTURE0 + colourtables->unit);
+  glBindTexture(GL_TEXTURE_2D, colourtables->id);
+  if ((int)colourtables->width < width)
+  {
+    //Resize to fit the largest table, all rows reloaded
+    colourtables->width = width;
+    colourtables->height = MAX_COLOURMAP_SLOTS;
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, MAX_COLOURMAP_SLOTS, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    tablerows.clear();
+  }
+  tablerows.resize(MAX_COLOURMAP_SLOTS);
+
+  //Calibrate to each slot's data then take its table transform, flags and row in the same pass,
+  //so slots sharing a colourmap keep their own range, only changed tables are uploaded
+  float range[4*MAX_COLOURMAP_SLOTS] = {0};
+  float flags[4*MAX_COLOURMAP_SLOTS] = {0};
+  for (unsigned int i=0; i<colourslots.size(); i++)
+  {
+    int slot = colourslots[i];
+    if (slot < 0) continue;
+    geom[i]->colourCalibrate();
+    //Colourmap removed or opacity map added since loaded, map on CPU from next frame
+    if (!shaderColours(i)) reload = true;
+    ColourMap* cmap = geom[i]->draw->colourMap;
+    if (!cmap) continue;
+    if (tablerows[slot].first != cmap || tablerows[slot].second != cmap->lutversion)
+    {
+      glTexSubImage2D(GL_TEXTURE_2D, 0, 0, slot, cmap->lutSamples(), 1, GL_RGBA, GL_UNSIGNED_BYTE, cmap->lutTable());
+      tablerows[slot] = std::make_pair(cmap, cmap->lutversion);
+    }
+    cmap->lutTransform(&range[slot*4], &flags[slot*4]);
+    float opacity = geom[i]->draw->opacity;
+    flags[slot*4+2] = opacity > 0.0 && opacity < 1.0 ? opacity : 1.0;
+    flags[slot*4+3] = (slot + 0.5) / MAX_COLOURMAP_SLOTS;
+  }
+  glActiveTexture(GL_TEXTURE0);
+  GL_Error_Check;
+
+  prog->use();
+  prog->setUniformi("uColourMap", colourtables->unit);
+  prog->setUniformf("uColourMapTexel", 1.0 / colourtables->width);
+  prog->setUniform4fv("uColourRange", MAX_COLOURMAP_SLOTS, range);
+  prog->setUniform4fv("uColourFlags", MAX_COLOURMAP_SLOTS, flags);
+
+  glEnableVertexAttribArray(attrib);
+  glVertexAttribPointer(attrib, 2, GL_FLOAT, GL_FALSE, stride, (GLvoid*)offset);
+  GL_Error_Check;
+  return attrib;
+}
+
+void Geometry::releaseColourMaps(GLint attrib)
+{
+  if (attrib < 0) return;
+  glDisableVertexAttribArray(attrib);
+  glActiveTexture(GL_TEXTURE0 + colourtables->unit);
+  glBindTexture(GL_TEXTURE_2D, 0);
+  glActiveTexture(GL_TEXTURE0);
+}
+
+bool Geometry::loadFilterSlots()
+{
+  //Called before filling the vertex buffer, true if filter values are to be included for filtering in the shaders
+  filterslots.clear();
+  filterfields.clear();
+  filterversion = 0;
+  if (!drawstate.global(gpufilterKey)) return false;
+  filterslots.resize(geom.size(), -1);
+  filterfields.resize(geom.size());
+  return true;
+}
+
+bool Geometry::shaderFilters(unsigned int i)
+{
+  //Filters of geom[i] can be applied in the shaders, requires filters read by GeomData::filterSetup()
+  unsigned int filters = geom[i]->filterCache.size();
+  return i < MAX_FILTER_SLOTS && filters > 0 && filters <= MAX_SHADER_FILTERS;
+}
+
+int Geometry::filterSlot(unsigned int i, std::vector<float>& fields)
+{
+  //Records the slot used to filter geom[i] in the shaders, -1 when filtered on CPU,
+  //loads values compared by each filter into fields (MAX_SHADER_FILTERS per vertex)
+  if (i >= filterslots.size()) return -1;
+  GeomData* g = geom[i];
+  filterslots[i] = -1;
+  filterfields[i].clear();
+  g->filterSetup();
+  if (!shaderFilters(i)) return -1;
+
+  fields.assign(g->count * MAX_SHADER_FILTERS, 0.0);
+  std::vector<float> values(g->count);
+  for (unsigned int k=0; k < g->filterCache.size(); k++)
+  {
+    Filter& f = g->filterCache[k];
+    filterfields[i].push_back(f.state);
+    //(filters without values have no effect)
+    if (!f.state.source) continue;
+    if (!g->filterValues(f, values.data()))
+    {
+      filterfields[i].clear();
+      return -1;
+    }
+    for (unsigned int idx=0; idx < g->count; idx++)
+      fields[idx * MAX_SHADER_FILTERS + k] = values[idx];
+  }
+  filterslots[i] = i;
+  return i;
+}
+
+bool Geometry::filtersLoaded(unsigned int i)
+{
+  //True if geom[i] is filtered in the shaders and the filters still compare the values loaded
+  if (i >= filterslots.size() || filterslots[i] < 0) return false;
+  GeomData* g = geom[i];
+  g->filterSetup();
+  if (!shaderFilters(i) || g->filterCache.size() != filterfields[i].size()) return false;
+  for (unsigned int k=0; k < g->filterCache.size(); k++)
+  {
+    if (!g->filterCache[k].state.sameValues(filterfields[i][k]))
+      return false;
+  }
+  return true;
+}
+
+GLint Geometry::useFilters(Shader* prog, int stride, size_t offset)
+{
+  //Sets up the filter value attribute and ranges, returns its location if enabled
+  if (!prog || !prog->program || !prog->attribs.count("aFilterValue")) return -1;
+  GLint attrib = prog->attribs["aFilterValue"];
+  if (attrib < 0) return -1;
+  if (filterslots.empty())
+  {
+    //Constant slot of -1, nothing filtered in the shaders
+    glVertexAttrib4f(attrib, 0.0, 0.0, 0.0, -1.0);
+    return -1;
+  }
+
+  //Per slot filter ranges and modes: 0 = none, 1 = outside range, 3 = inside range, +1 for inclusive of limits
+  //only read from the filter properties again once properties have changed
+  const int len = 4*MAX_FILTER_SLOTS;
+  if (filterversion != Properties::version || filterranges.size() != 3*len)
+  {
+    filterversion = Properties::version;
+    filterranges.assign(3*len, 0.0);
+    float* lower = &filterranges[0];
+    float* upper = &filterranges[len];
+    float* modes = &filterranges[2*len];
+    for (unsigned int i=0; i<filterslots.size(); i++)
+    {
+      int slot = filterslots[i];
+      if (slot < 0) continue;
+      //Filters changed since loaded other than in range, reload (not filtered until then)
+      if (!filtersLoaded(i))
+      {
+        reload = true;
+        filterversion = 0;
+        continue;
+      }
+      for (unsigned int k=0; k < geom[i]->filterCache.size(); k++)
+      {
+        FilterState& state = geom[i]->filterCache[k].state;
+        if (!state.source) continue;
+        lower[slot*4+k] = state.lower;
+        upper[slot*4+k] = state.upper;
+        modes[slot*4+k] = (state.out ? 3 : 1) + (state.inclusive ? 1 : 0);
+      }
+    }
+  }
+
+  prog->use();
+  prog->setUniform4fv("uFilterMin", MAX_FILTER_SLOTS, &filterranges[0]);
+  prog->setUniform4fv("uFilterMax", MAX_FILTER_SLOTS, &filterranges[len]);
+  prog->setUniform4fv("uFilterMode", MAX_FILTER_SLOTS, &filterranges[2*len]);
+
+  glEnableVertexAttribArray(attrib);
+  glVertexAttribPointer(attrib, 4, GL_FLOAT, GL_FALSE, stride, (GLvoid*)offset);
+  GL_Error_Check;
+  return attrib;
+}
+
+void Geometry::releaseFilters(GLint attrib)
+{
+  if (attrib < 0) return;
+  glDisableVertexAttribArray(attrib);
+}
+
 void Geometry::labels()
 {
   //Print labels
@@ -804,7 +1343,7 @@ void Geometry::labels()
   {
     std::string font = geom[i]->draw->properties["font"];
     if (view->scale2d != 1.0 && font != "vector")
-      geom[i]->draw->properties.data["font"] = "vector"; //Force vector if downsampling
+      geom[i]->draw->properties.set("font", "vector"); //Force vector if downsampling
     //Default to object colour (if fontcolour provided will replace)
     Colour colour = Colour(geom[i]->draw->properties["colour"]);
     glColor3ubv(colour.rgba);
@@ -813,7 +1352,8 @@ void Geometry::labels()
     {
       for (unsigned int j=0; j < geom[i]->labels.size(); j++)
       {
-        float* p = geom[i]->vertices[j];
+        float p[3];
+        geom[i]->vertices.get(j, p);
         //debug_print("Labels for %d - %d : %s\n", i, j, geom[i]->labels[j].c_str());
         std::string labstr = geom[i]->labels[j];
         if (labstr.length() == 0) continue;
@@ -843,9 +1383,8 @@ void Geometry::labels()
 //ie: has data, in range, not hidden and in viewport object list
 bool Geometry::drawable(unsigned int idx)
 {
-  if (!geom[idx]->draw->properties["visible"]) return false;
   //Within bounds and not hidden
-  if (idx < geom.size() && geom[idx]->count > 0 && !hidden[idx])
+  if (idx < geom.size() && geom[idx]->draw->snapshot().visible && geom[idx]->count > 0 && !hidden[idx])
   {
     //Not filtered by viewport?
     if (!view->filtered) return true;
@@ -871,15 +1410,15 @@ std::vector<GeomData*> Geometry::getAllObjects(DrawingObject* draw)
 GeomData* Geometry::getObjectStore(DrawingObject* draw)
 {
   //Get passed object's most recently added data store
-  for (int i=geom.size()-1; i>=0; i--)
-    if (geom[i]->draw == draw) return geom[i];
-  return NULL;
+  auto it = latest.find(draw);
+  return it != latest.end() ? it->second : NULL;
 }
 
 GeomData* Geometry::add(DrawingObject* draw)
 {
-  GeomData* geomdata = new GeomData(draw);
+  GeomData* geomdata = new GeomData(draw, arena);
   geom.push_back(geomdata);
+  latest[draw] = geomdata;
   if (hidden.size() < geom.size()) hidden.push_back(allhidden);
   //if (allhidden) draw->properties.data["visible"] = false;
   //debug_print("NEW DATA STORE CREATED FOR %s size %d ptr %p hidden %d\n", draw->name().c_str(), geom.size(), geomdata, allhidden);
@@ -928,7 +1467,7 @@ void Geometry::objectBounds(DrawingObject* draw, float* min, float* max)
   }
 }
 
-GeomData* Geometry::read(DrawingObject* draw, unsigned int n, lucGeometryDataType dtype, const void* data, int width, int height, int depth)
+GeomData* Geometry::dataStore(DrawingObject* draw, lucGeometryDataType dtype, int& width, int& height, int& depth)
 {
   draw->skip = false;  //Enable object (has geometry now)
   GeomData* geomdata;
@@ -959,6 +1498,34 @@ GeomData* Geometry::read(DrawingObject* draw, unsigned int n, lucGeometryDataTyp
   if (!geomdata || loaded)
     geomdata = add(draw);
 
+  return geomdata;
+}
+
+FloatValues* Geometry::valueStore(GeomData* geomdata, const std::string& label)
+{
+  //Find labelled value store
+  FloatValues* store = NULL;
+  int idx = geomdata->valuesIndex(label);
+  if (idx >= 0) store = geomdata->values[idx];
+
+  //Create value store if required
+  if (!store)
+  {
+    store = new FloatValues();
+    store->setArena(geomdata->arena);
+    geomdata->values.push_back(store);
+    store->label = label;
+    //debug_print(" -- NEW VALUE STORE CREATED FOR %s label %s count %d ptr %p\n", geomdata->draw->name().c_str(), label.c_str(), geomdata->values.size(), store);
+  }
+
+  return store;
+}
+
+GeomData* Geometry::read(DrawingObject* draw, unsigned int n, lucGeometryDataType dtype, const void* data, int width, int height, int depth)
+{
+  //Get or create data store
+  GeomData* geomdata = dataStore(draw, dtype, width, height, depth);
+
   //Now ready to load geometry data into store
   read(geomdata, n, dtype, data, width, height, depth);
 
@@ -975,27 +1542,119 @@ GeomData* Geometry::read(DrawingObject* draw, unsigned int n, const void* data,
   if (!geomdata)
     geomdata = add(draw);
 
-  //Find labelled value store
-  FloatValues* store = NULL;
-  for (auto vals : geomdata->values)
+  //Read the data
+  FloatValues* store = valueStore(geomdata, label);
+  if (n > 0) store->read(n, data);
+
+  return geomdata; //Return data store pointer
+}
+
+void* Geometry::reserve(DrawingObject* draw, unsigned int n, lucGeometryDataType dtype, GeomData*& geomdata, int width, int height, int depth)
+{
+  //As read() but returns destination for n entries to be filled by caller
+  //(NOTE: bounds not updated for single vertex reads, caller must apply)
+  return reserveStore(draw, n, dtype, geomdata, width, height, depth)->append(n);
+}
+
+void* Geometry::reserve(DrawingObject* draw, unsigned int n, const std::string& label, GeomData*& geomdata)
+{
+  //As read() into given label but returns destination for n values to be filled by caller
+  return reserveStore(draw, label, geomdata)->append(n);
+}
+
+DataContainer* Geometry::reserveStore(DrawingObject* draw, unsigned int n, lucGeometryDataType dtype, GeomData*& geomdata, int width, int height, int depth)
+{
+  //First step of reserve(), returns the data store the caller must append n entries to
+  //(allows checking if appending will move the data first)
+  geomdata = dataStore(draw, dtype, width, height, depth);
+  read(geomdata, 0, dtype, NULL, width, height, depth);
+
+  if (dtype == lucVertexData)
   {
-    if (vals->label == label)
-      store = vals;
+    geomdata->count += n;
+    total += n;
   }
 
-  //Create value store if required
-  if (!store)
+  return geomdata->data[dtype];
+}
+
+DataContainer* Geometry::reserveStore(DrawingObject* draw, const std::string& label, GeomData*& geomdata)
+{
+  //First step of reserve() into given label, returns the value store to append to
+  geomdata = getObjectStore(draw);
+  if (!geomdata)
+    geomdata = add(draw);
+
+  return valueStore(geomdata, label);
+}
+
+//Write vector to a span entry and advance to the next
+static inline void spanWrite(float*& dest, Vec3d& vec)
+{
+  memcpy(dest, vec.ref(), sizeof(float) * 3);
+  dest += 3;
+}
+
+GeomSpan Geometry::append(DrawingObject* draw, unsigned int n, unsigned int nindices, bool normals, bool texCoords)
+{
+  //Reserve n vertices with normals / texcoords if requested and nindices indices in one step,
+  //for generators to write directly instead of a read() call per vertex / attribute
+  GeomSpan span;
+  span.vertices = (float*)reserve(draw, n, lucVertexData, span.geom);
+  span.count = n;
+  span.offset = span.geom->count - n;
+  span.normals = normals ? (float*)span.geom->normals.append(n) : NULL;
+  span.texCoords = texCoords ? (float*)span.geom->texCoords.append(n) : NULL;
+  span.indices = (unsigned int*)span.geom->indices.append(nindices);
+  return span;
+}
+
+void Geometry::commit(GeomSpan& span)
+{
+  //Apply bounds of the vertices written to a span in a single pass (as for single vertex reads)
+  if (type == lucLabelType) return;
+  float* arr = span.vertices;
+  for (unsigned int i=0; i<span.count; i++, arr += 3)
   {
-    store = new FloatValues();
-    geomdata->values.push_back(store);
-    store->label = label;
-    //debug_print(" -- NEW VALUE STORE CREATED FOR %s label %s count %d ptr %p\n", geomdata->draw->name().c_str(), label.c_str(), geomdata->values.size(), store);
+    if (unscale)
+    {
+      //Pre-scaled internal geometry, undo scaling before applying to bounding box (see read())
+      std::array<float,3> unscaled = {arr[0]*iscale[0], arr[1]*iscale[1], arr[2]*iscale[2]};
+      span.geom->checkPointMinMax(unscaled.data());
+    }
+    else
+      span.geom->checkPointMinMax(arr);
   }
+}
 
-  //Read the data
-  if (n > 0) store->read(n, data);
+GeomData* Geometry::share(DrawingObject* draw, DataContainer* src, lucGeometryDataType dtype, int width, int height, int depth)
+{
+  //As read() but shares the data of an existing store, copied only when modified
+  //(or when appending to a store already containing data)
+  GeomData* geomdata = dataStore(draw, dtype, width, height, depth);
+  read(geomdata, 0, dtype, NULL, width, height, depth);
 
-  return geomdata; //Return data store pointer
+  unsigned int before = geomdata->data[dtype]->count();
+  geomdata->data[dtype]->share(src);
+  if (dtype == lucVertexData)
+  {
+    unsigned int n = geomdata->data[dtype]->count() - before;
+    geomdata->count += n;
+    total += n;
+  }
+
+  return geomdata;
+}
+
+GeomData* Geometry::share(DrawingObject* draw, DataContainer* src, const std::string& label)
+{
+  //As read() into given label but shares the data of an existing store
+  GeomData* geomdata = getObjectStore(draw);
+  if (!geomdata)
+    geomdata = add(draw);
+
+  valueStore(geomdata, label)->share(src);
+  return geomdata;
 }
 
 void Geometry::read(GeomData* geomdata, unsigned int n, lucGeometryDataType dtype, const void* data, int width, int height, int depth)
@@ -1007,7 +1666,7 @@ void Geometry::read(GeomData* geomdata, unsigned int n, lucGeometryDataType dtyp
 
   //Update the default type property on first read
   if (geomdata->count == 0 && !geomdata->draw->properties.has("geometry"))
-    geomdata->draw->properties.data["geometry"] = GeomData::names[type];
+    geomdata->draw->properties.set("geometry", GeomData::names[type]);
 
   //Read the data
   if (n > 0) geomdata->data[dtype]->read(n, data);
@@ -1125,6 +1784,20 @@ void Geometry::setup(DrawingObject* draw)
   }
 }
 
+void Geometry::compact()
+{
+  //Switch loaded data to compact storage where enabled
+  for (unsigned int i=0; i<geom.size(); i++)
+  {
+    if (!geom[i]->draw->properties["compact"]) continue;
+    for (unsigned int d=0; d<geom[i]->values.size(); d++)
+      geom[i]->values[d]->compact(COMPACT_HALF);
+    //Positions of points only, other types process their vertices at full precision (normals, sorting)
+    if (type == lucPointType)
+      geom[i]->vertices.compact(COMPACT_QUANTISE);
+  }
+}
+
 void Geometry::insertFixed(Geometry* fixed)
 {
   if (geom.size() > 0) return; //Not permitted to load fixed data if any existing data loaded already
@@ -1134,7 +1807,7 @@ void Geometry::insertFixed(Geometry* fixed)
     GeomData* varying = NULL;
     if (geom.size() == i)
       add(fixed->geom[i]->draw); //Insert new if not enough records
-    //Create a shallow copy of member content
+    //Copy member content, data stores shared with the fixed data (no copy unless modified)
     *geom[i] = *fixed->geom[i];
     //Set offset where fixed data ends (so we can avoid clearing it)
     geom[i]->fixedOffset = geom[i]->values.size();
@@ -1248,7 +1921,7 @@ void Geometry::toImage(unsigned int idx)
 void Geometry::setTexture(DrawingObject* draw, ImageLoader* tex)
 {
   GeomData* geomdata = getObjectStore(draw);
-  geomdata->texture = tex;
+  geomdata->texture.reset(tex);
   //std::cout << "SET TEXTURE: " << idx << " ON " << draw->name() << std::endl;
   //Must be opaque to draw with own texture
   geomdata->opaque = true;
@@ -1314,7 +1987,6 @@ void radix_sort_byte(int byte, long N, unsigned char *source, unsigned char *des
 #define RADIUS_DEFAULT_RATIO 0.02   // Default radius as a ratio of length
 void Geometry::drawVector(DrawingObject *draw, float pos[3], float vector[3], float scale, float radius0, float radius1, float head_scale, int segment_count)
 {
-  std::vector<unsigned int> indices;
   Vec3d vec(vector);
   Vec3d translate(pos);
 
@@ -1369,72 +2041,95 @@ void Geometry::drawVector(DrawingObject *draw, float pos[3], float vector[3], fl
   if (segment_count < 4)
   {
     // Draw Line
+    GeomSpan span = append(draw, 2, 0, false);
+    float* vp = span.vertices;
     Vec3d vertex0 = Vec3d(0,0,-halflength);
     Vec3d vertex = translate + rot * vertex0;
-    read(draw, 1, lucVertexData, vertex.ref());
+    spanWrite(vp, vertex);
     vertex0.z = halflength;
     vertex = translate + rot * vertex0;
-    read(draw, 1, lucVertexData, vertex.ref());
+    spanWrite(vp, vertex);
+    commit(span);
     return;
   }
-  else if (length > headD)
+
+  bool shaft = length > headD;
+  if (!shaft)
+  {
+    headD = length; //Limit max arrow head diameter
+    head_radius = length * 0.5;
+  }
+  // Don't bother drawing head very low quality settings
+  bool head = segment_count >= 3 && head_scale > 0 && head_radius > 1.0e-7;
+
+  //Reserve all vertices, normals and triangle indices for the arrow
+  //shaft: triangle strip, head: cone and base triangle fans
+  unsigned int n = 0, nidx = 0;
+  if (shaft)
+  {
+    n += 2 * (segment_count + 1);
+    nidx += 6 * segment_count;
+  }
+  if (head)
+  {
+    n += 2 * (segment_count + 1) + 1 + segment_count + 1;
+    nidx += 3 * segment_count + 3 * (segment_count + 1);
+  }
+  if (n == 0) return;
+  GeomSpan span = append(draw, n, nidx, true);
+  float* vp = span.vertices;
+  float* np = span.normals;
+  unsigned int* ip = span.indices;
+  unsigned int vertex_index = span.offset;
+
+  if (shaft)
   {
     int v;
-    for (v=0; v <= segment_count; v++)
+    for (v=0; v <= segment_count; v++, vertex_index += 2)
     {
-      int vertex_index = getVertexIdx(draw);
-
       // Base of shaft
       Vec3d vertex0 = Vec3d(radius0 * drawstate.x_coords[v], radius0 * drawstate.y_coords[v], -halflength); // z = Shaft length to base of head
       Vec3d vertex = translate + rot * vertex0;
 
-      //Read triangle vertex, normal
-      read(draw, 1, lucVertexData, vertex.ref());
+      //Triangle vertex, normal
+      spanWrite(vp, vertex);
       Vec3d normal = rot * Vec3d(drawstate.x_coords[v], drawstate.y_coords[v], 0);
       //normal.normalise();
-      read(draw, 1, lucNormalData, normal.ref());
+      spanWrite(np, normal);
 
       // Top of shaft
       Vec3d vertex1 = Vec3d(radius1 * drawstate.x_coords[v], radius1 * drawstate.y_coords[v], -headD+halflength);
       vertex = translate + rot * vertex1;
 
-      //Read triangle vertex, normal
-      read(draw, 1, lucVertexData, vertex.ref());
-      read(draw, 1, lucNormalData, normal.ref());
+      //Triangle vertex, normal
+      spanWrite(vp, vertex);
+      spanWrite(np, normal);
 
       //Triangle strip indices
       if (v > 0)
       {
         //First tri
-        indices.push_back(vertex_index-2);
-        indices.push_back(vertex_index-1);
-        indices.push_back(vertex_index);
+        *ip++ = vertex_index-2;
+        *ip++ = vertex_index-1;
+        *ip++ = vertex_index;
         //Second tri
-        indices.push_back(vertex_index-1);
-        indices.push_back(vertex_index+1);
-        indices.push_back(vertex_index);
+        *ip++ = vertex_index-1;
+        *ip++ = vertex_index+1;
+        *ip++ = vertex_index;
       }
     }
   }
-  else
-  {
-    headD = length; //Limit max arrow head diameter
-    head_radius = length * 0.5;
-  }
 
   // Render the arrowhead cone and base with two triangle fans
-  // Don't bother drawing head very low quality settings
-  if (segment_count >= 3 && head_scale > 0 && head_radius > 1.0e-7 )
+  if (head)
   {
     int v;
     // Pinnacle vertex is at point of arrow
-    int pt = getVertexIdx(draw);
     Vec3d pinnacle = translate + rot * Vec3d(0, 0, halflength);
 
     // First pair of vertices on circle define a triangle when combined with pinnacle
     // First normal is between first and last triangle normals 1/|\seg-1
 
-    //Read triangle vertex, normal
     //Vec3d vertex = translate + pinnacle;;
     Vec3d vertex = pinnacle;;
 
@@ -1442,10 +2137,8 @@ void Geometry::drawVector(DrawingObject *draw, float pos[3], float vector[3], fl
     normal.normalise();
 
     // Subsequent vertices describe outer edges of cone base
-    for (v=segment_count; v >= 0; v--)
+    for (v=segment_count; v >= 0; v--, vertex_index += 2)
     {
-      int vertex_index = getVertexIdx(draw);
-
       // Calc next vertex from unit circle coords
       Vec3d vertex1 = translate + rot * Vec3d(head_radius * drawstate.x_coords[v], head_radius * drawstate.y_coords[v], -headD+halflength);
 
@@ -1454,57 +2147,55 @@ void Geometry::drawVector(DrawingObject *draw, float pos[3], float vector[3], fl
       normal1.normalise();
 
       //Duplicate pinnacle vertex as each facet needs a different normal
-      read(draw, 1, lucVertexData, vertex.ref());
+      spanWrite(vp, vertex);
       //Balance between smoothness (normal) and highlighting angle of cone (normal1)
       Vec3d avgnorm = normal * 0.4 + normal1 * 0.6;
       avgnorm.normalise();
-      read(draw, 1, lucNormalData, avgnorm.ref());
+      spanWrite(np, avgnorm);
 
-      //Read triangle vertex, normal
-      read(draw, 1, lucVertexData, vertex1.ref());
-      read(draw, 1, lucNormalData, avgnorm.ref());
+      //Triangle vertex, normal
+      spanWrite(vp, vertex1);
+      spanWrite(np, avgnorm);
 
       //Triangle fan indices
       if (v < segment_count)
       {
-        indices.push_back(vertex_index);    //Pinnacle vertex
-        indices.push_back(vertex_index-1);  //Previous vertex
-        indices.push_back(vertex_index+1);  //Current vertex
+        *ip++ = vertex_index;    //Pinnacle vertex
+        *ip++ = vertex_index-1;  //Previous vertex
+        *ip++ = vertex_index+1;  //Current vertex
       }
     }
 
     // Flatten cone for circle base -> set common point to share z-coord
     // Centre of base circle, normal facing back along arrow
-    pt = getVertexIdx(draw);
+    unsigned int pt = vertex_index++;
     pinnacle = rot * Vec3d(0,0,-headD+halflength);
     vertex = translate + pinnacle;
     normal = rot * Vec3d(0.0f, 0.0f, -1.0f);
-    //Read triangle vertex, normal
-    read(draw, 1, lucVertexData, vertex.ref());
-    read(draw, 1, lucNormalData, normal.ref());
+    //Triangle vertex, normal
+    spanWrite(vp, vertex);
+    spanWrite(np, normal);
 
     // Repeat vertices for outer edges of cone base
-    for (v=0; v<=segment_count; v++)
+    for (v=0; v<=segment_count; v++, vertex_index++)
     {
-      int vertex_index = getVertexIdx(draw);
       // Calc next vertex from unit circle coords
       Vec3d vertex1 = rot * Vec3d(head_radius * drawstate.x_coords[v], head_radius * drawstate.y_coords[v], -headD+halflength);
 
       vertex1 = translate + vertex1;
 
-      //Read triangle vertex, normal
-      read(draw, 1, lucVertexData, vertex1.ref());
-      read(draw, 1, lucNormalData, normal.ref());
+      //Triangle vertex, normal
+      spanWrite(vp, vertex1);
+      spanWrite(np, normal);
 
       //Triangle fan indices
-      indices.push_back(pt);
-      indices.push_back(vertex_index-1);
-      indices.push_back(vertex_index);
+      *ip++ = pt;
+      *ip++ = vertex_index-1;
+      *ip++ = vertex_index;
     }
   }
 
-  //Read the triangle indices
-  read(draw, indices.size(), lucIndexData, &indices[0]);
+  commit(span);
 }
 
 // Draws a trajectory vector between two coordinates,
@@ -1655,19 +2346,23 @@ void Geometry::drawCuboidAt(DrawingObject *draw, Vec3d& pos, Vec3d& dims, Quater
   else
   {
     //Triangle indices
-    unsigned vertex_index = (unsigned)getVertexIdx(draw);
-    unsigned int indices[36] =
+    static const unsigned int indices[36] =
     {
-      0+vertex_index, 1+vertex_index, 2+vertex_index, 2+vertex_index, 3+vertex_index, 0+vertex_index,
-      3+vertex_index, 2+vertex_index, 6+vertex_index, 6+vertex_index, 7+vertex_index, 3+vertex_index,
-      7+vertex_index, 6+vertex_index, 5+vertex_index, 5+vertex_index, 4+vertex_index, 7+vertex_index,
-      4+vertex_index, 0+vertex_index, 3+vertex_index, 3+vertex_index, 7+vertex_index, 4+vertex_index,
-      0+vertex_index, 1+vertex_index, 5+vertex_index, 5+vertex_index, 4+vertex_index, 0+vertex_index,
-      1+vertex_index, 5+vertex_index, 6+vertex_index, 6+vertex_index, 2+vertex_index, 1+vertex_index
+      0, 1, 2, 2, 3, 0,
+      3, 2, 6, 6, 7, 3,
+      7, 6, 5, 5, 4, 7,
+      4, 0, 3, 3, 7, 4,
+      0, 1, 5, 5, 4, 0,
+      1, 5, 6, 6, 2, 1
     };
 
-    read(draw, 8, lucVertexData, verts[0].ref());
-    read(draw, 36, lucIndexData, indices);
+    //(Corner bounds not applied, as for a multiple vertex read())
+    GeomSpan span = append(draw, 8, 36, false);
+    float* vp = span.vertices;
+    for (int i=0; i<8; i++)
+      spanWrite(vp, verts[i]);
+    for (int i=0; i<36; i++)
+      span.indices[i] = span.offset + indices[i];
   }
 }
 
@@ -1687,7 +2382,6 @@ void Geometry::drawEllipsoid(DrawingObject *draw, Vec3d& centre, Vec3d& radii, Q
 {
   int i,j;
   Vec3d edge, pos, normal;
-  float tex[2];
 
   if (radii.x < 0) radii.x = -radii.x;
   if (radii.y < 0) radii.y = -radii.y;
@@ -1695,57 +2389,58 @@ void Geometry::drawEllipsoid(DrawingObject *draw, Vec3d& centre, Vec3d& radii, Q
   if (segment_count < 0) segment_count = -segment_count;
   drawstate.cacheCircleCoords(segment_count);
 
-  std::vector<unsigned int> indices;
+  //Reserve triangle strip vertices, normals, texcoords and indices for all segments
+  unsigned int strips = segment_count/2;
+  GeomSpan span = append(draw, strips * 2 * (segment_count + 1), strips * 6 * segment_count, true, true);
+  float* vp = span.vertices;
+  float* np = span.normals;
+  float* tp = span.texCoords;
+  unsigned int* ip = span.indices;
+  unsigned int vertex_index = span.offset;
   for (j=0; j<segment_count/2; j++)
   {
     //Triangle strip vertices
-    for (i=0; i<=segment_count; i++)
+    for (i=0; i<=segment_count; i++, vertex_index += 2)
     {
-      int vertex_index = getVertexIdx(draw);
       // Get index from pre-calculated coords which is back 1/4 circle from j+1 (same as forward 3/4circle)
       int circ_index = ((int)(1 + j + 0.75 * segment_count) % segment_count);
       edge = Vec3d(drawstate.y_coords[circ_index] * drawstate.y_coords[i], drawstate.x_coords[circ_index], drawstate.y_coords[circ_index] * drawstate.x_coords[i]);
       pos = centre + rot * (radii * edge);
 
-      tex[0] = i/(float)segment_count;
-      tex[1] = 2*(j+1)/(float)segment_count;
-
-      //Read triangle vertex, normal, texcoord
-      read(draw, 1, lucVertexData, pos.ref());
+      //Triangle vertex, normal, texcoord
+      spanWrite(vp, pos);
       normal = rot * -edge;
-      read(draw, 1, lucNormalData, normal.ref());
-      read(draw, 1, lucTexCoordData, tex);
+      spanWrite(np, normal);
+      *tp++ = i/(float)segment_count;
+      *tp++ = 2*(j+1)/(float)segment_count;
 
       // Get index from pre-calculated coords which is back 1/4 circle from j (same as forward 3/4circle)
       circ_index = ((int)(j + 0.75 * segment_count) % segment_count);
       edge = Vec3d(drawstate.y_coords[circ_index] * drawstate.y_coords[i], drawstate.x_coords[circ_index], drawstate.y_coords[circ_index] * drawstate.x_coords[i]);
       pos = centre + rot * (radii * edge);
 
-      tex[0] = i/(float)segment_count;
-      tex[1] = 2*j/(float)segment_count;
-
-      //Read triangle vertex, normal, texcoord
-      read(draw, 1, lucVertexData, pos.ref());
+      //Triangle vertex, normal, texcoord
+      spanWrite(vp, pos);
       normal = rot * -edge;
-      read(draw, 1, lucNormalData, normal.ref());
-      read(draw, 1, lucTexCoordData, tex);
+      spanWrite(np, normal);
+      *tp++ = i/(float)segment_count;
+      *tp++ = 2*j/(float)segment_count;
 
       //Triangle strip indices
       if (i > 0)
       {
         //First tri
-        indices.push_back(vertex_index-2);
-        indices.push_back(vertex_index-1);
-        indices.push_back(vertex_index);
+        *ip++ = vertex_index-2;
+        *ip++ = vertex_index-1;
+        *ip++ = vertex_index;
         //Second tri
-        indices.push_back(vertex_index-1);
-        indices.push_back(vertex_index+1);
-        indices.push_back(vertex_index);
+        *ip++ = vertex_index-1;
+        *ip++ = vertex_index+1;
+        *ip++ = vertex_index;
       }
     }
   }
 
-  //Read the triangle indices
-  read(draw, indices.size(), lucIndexData, &indices[0]);
+  commit(span);
 }
 
@@ -49,6 +49,36 @@
 
 #define SORT_DIST_MAX 65535
 
+//Inputs a filter result depends on
+struct FilterState
+{
+  FloatValues* source;   //Values compared, NULL if none
+  unsigned int revision; //Revision of the source data
+  ColourMap* cmap;       //Values scaled by colourmap before comparison if set
+  float cmin;
+  float cmax;
+  bool clog;
+  float lower;           //Range compared against
+  float upper;
+  bool out;
+  bool inclusive;
+
+  FilterState() : source(NULL), revision(0), cmap(NULL), cmin(0), cmax(0), clog(false), lower(0), upper(0), out(false), inclusive(false) {}
+
+  //Same values are compared (range may differ)
+  bool sameValues(const FilterState& other) const
+  {
+    return source == other.source && revision == other.revision && cmap == other.cmap &&
+           (!cmap || (cmin == other.cmin && cmax == other.cmax && clog == other.clog));
+  }
+
+  bool operator==(const FilterState& other) const
+  {
+    return sameValues(other) && lower == other.lower && upper == other.upper &&
+           out == other.out && inclusive == other.inclusive;
+  }
+};
+
 typedef struct
 {
   unsigned int dataIdx;
@@ -57,6 +87,11 @@ typedef struct
   bool map;
   bool out;
   bool inclusive;
+  FilterState state;     //Current inputs, from GeomData::filterSetup()
+  //Evaluated result, one bit per value (set if filtered),
+  //only re-evaluated when the inputs differ from those it was evaluated with
+  std::vector<uint32_t> mask;
+  FilterState evaluated;
 } Filter;
 
 //Types based on triangle renderer
@@ -79,6 +114,7 @@ typedef struct
 
 //Geometry object data store
 #define MAX_DATA_ARRAYS 64
+#define MAX_SHADER_FILTERS 3
 class GeomData
 {
 public:
@@ -91,8 +127,10 @@ public:
   char* labelptr;
   bool opaque;   //Flag for opaque geometry, render first, don't depth sort
   unsigned int fixedOffset; //Offset to end of fixed value data
-  ImageLoader* texture; //Texture
+  std::shared_ptr<ImageLoader> texture; //Texture (shared with copies)
   std::vector<Filter> filterCache;
+  std::vector<uint32_t> filterBits; //Combined filter mask, one bit per vertex/element
+  unsigned int filterCount;         //Indices covered by mask, 0 if no filters applied
 
   float distance;
 
@@ -114,6 +152,8 @@ public:
 
   std::vector<DataContainer*> data;
   std::vector<FloatValues*> values;
+  std::unordered_map<std::string, unsigned int> valueindex; //Label to values index cache (checked on use)
+  std::shared_ptr<DataArena> arena; //Allocator for data stores
 
   static unsigned int byteSize(lucGeometryDataType type)
   {
@@ -124,7 +164,7 @@ public:
     return sizeof(float);
   }
 
-  GeomData(DrawingObject* draw) : draw(draw), count(0), width(0), height(0), depth(0), labelptr(NULL), opaque(false)
+  GeomData(DrawingObject* draw, const std::shared_ptr<DataArena>& arena=NULL) : draw(draw), count(0), width(0), height(0), depth(0), labelptr(NULL), opaque(false), filterCount(0), arena(arena)
   {
     //opaque = false; //true; //Always true for now (need to check colourmap, opacity and global opacity)
     data.resize(MAX_DATA_ARRAYS); //Maximum increased to allow predefined data plus generic value data arrays
@@ -136,6 +176,8 @@ public:
     data[lucTexCoordData] = &texCoords;
     data[lucLuminanceData] = &luminance;
     data[lucRGBData] = &rgb;
+    for (auto store : data)
+      if (store) store->setArena(arena);
 
     texture = NULL;
 
@@ -148,6 +190,39 @@ public:
     fixedOffset = 0;
   }
 
+  GeomData& operator=(const GeomData& other)
+  {
+    //Copy, data stores are shared with other until either is modified
+    //(data pointers refer to own stores, values refer to other's, texture shared, labels buffer not copied,
+    // new data still allocated from own arena)
+    draw = other.draw;
+    count = other.count;
+    width = other.width;
+    height = other.height;
+    depth = other.depth;
+    opaque = other.opaque;
+    fixedOffset = other.fixedOffset;
+    texture = other.texture;
+    filterCache = other.filterCache;
+    filterBits = other.filterBits;
+    filterCount = other.filterCount;
+    distance = other.distance;
+    memcpy(min, other.min, sizeof(min));
+    memcpy(max, other.max, sizeof(max));
+    labels = other.labels;
+    vertices = other.vertices;
+    vectors = other.vectors;
+    normals = other.normals;
+    indices = other.indices;
+    colours = other.colours;
+    texCoords = other.texCoords;
+    luminance = other.luminance;
+    rgb = other.rgb;
+    values = other.values;
+    valueindex = other.valueindex;
+    return *this;
+  }
+
   ~GeomData()
   {
     if (labelptr) free(labelptr);
@@ -156,9 +231,6 @@ public:
     //Delete value data containers (exclude fixed additions)
     for (unsigned int i=fixedOffset; i<values.size(); i++)
       delete values[i];
-
-    if (texture)
-      delete texture;
   }
 
   void checkPointMinMax(float *coord);
@@ -170,8 +242,20 @@ public:
   void mapToColour(Colour& colour, float value);
   int colourCount();
   void getColour(Colour& colour, unsigned int idx);
+  void fillColours(Colour* out, unsigned int start, unsigned int n);
+  void fillValues(float* out, unsigned int start, unsigned int n);
   unsigned int valuesLookup(const json& by);
-  bool filter(unsigned int idx);
+  int valuesIndex(const std::string& label);
+  void filterSetup();
+  bool filterMask();
+  void filterEvaluate(Filter& f);
+  bool filterValues(Filter& f, float* out);
+  //Returns true if vertex/voxel is to be filtered (don't display)
+  //(checks the mask, call filterMask() first to bring it up to date)
+  bool filter(unsigned int idx)
+  {
+    return idx < filterCount && (filterBits[idx >> 5] >> (idx & 31)) & 1;
+  }
   FloatValues* colourData();
   float colourData(unsigned int idx);
   FloatValues* valueData(unsigned int vidx);
@@ -179,6 +263,20 @@ public:
   float valueData(unsigned int vidx, unsigned int idx);
 };
 
+//Destination for a block of vertices and their attributes reserved in a data store
+//(see Geometry::append), filled by caller then passed to Geometry::commit
+//NOTE: only valid until more data is added to the same data store
+struct GeomSpan
+{
+  GeomData* geom;
+  unsigned int offset;   //Index of first vertex, for element indices
+  unsigned int count;    //Vertices reserved
+  float* vertices;
+  float* normals;        //NULL if not requested
+  float* texCoords;      //NULL if not requested
+  unsigned int* indices; //NULL if none requested
+};
+
 
 class Distance
 {
@@ -234,10 +332,32 @@ class Geometry
 protected:
   View* view;
   std::vector<GeomData*> geom;
+  std::unordered_map<DrawingObject*, GeomData*> latest; //Most recently added data store of each object
   std::vector<bool> hidden;
   int elements;
   int drawcount;
   bool flat2d; //Flag for flat surfaces in 2d
+  std::vector<int> colourslots; //Shader colour mapping slot of each data store at last load, empty if all mapped on CPU
+  TextureData* colourtables;    //Colourmap lookup tables, one row per slot
+  std::vector<std::pair<ColourMap*, unsigned int> > tablerows; //Map and table version loaded in each row
+  std::vector<int> filterslots; //Shader filtering slot of each data store at last load, empty if all filtered on CPU
+  std::vector<std::vector<FilterState> > filterfields; //Inputs of the filter values loaded for each data store
+  unsigned int filterversion; //Properties::version when the filter ranges were last checked, 0 to check again
+  std::vector<float> filterranges; //Filter range and mode uniforms from the last check
+
+  GeomData* dataStore(DrawingObject* draw, lucGeometryDataType dtype, int& width, int& height, int& depth);
+  FloatValues* valueStore(GeomData* geomdata, const std::string& label);
+  bool loadColourSlots();
+  bool shaderColours(unsigned int i);
+  int colourSlot(unsigned int i);
+  GLint useColourMaps(Shader* prog, int stride, size_t offset);
+  void releaseColourMaps(GLint attrib);
+  bool loadFilterSlots();
+  bool shaderFilters(unsigned int i);
+  int filterSlot(unsigned int i, std::vector<float>& fields);
+  bool filtersLoaded(unsigned int i);
+  GLint useFilters(Shader* prog, int stride, size_t offset);
+  void releaseFilters(GLint attrib);
 
 public:
   DrawState& drawstate;
@@ -246,6 +366,7 @@ public:
   Vec3d iscale; //Factors for un-scaling
   lucGeometryType type;   //Holds the object type
   unsigned int total;     //Total entries of all objects in container
+  std::shared_ptr<DataArena> arena; //Allocator for data stores of this step
   bool redraw;    //Redraw flag
   bool reload;    //Reload and redraw flag
 
@@ -265,6 +386,8 @@ public:
   bool show(unsigned int idx);
   void showObj(DrawingObject* draw, bool state);
   void redrawObject(DrawingObject* draw);
+  void recolourObject(DrawingObject* draw);
+  void refilterObject(DrawingObject* draw);
   void setValueRange(DrawingObject* draw);
   bool drawable(unsigned int idx);
   virtual void init(); //Called on GL init
@@ -278,8 +401,17 @@ public:
   GeomData* read(DrawingObject* draw, unsigned int n, lucGeometryDataType dtype, const void* data, int width=0, int height=0, int depth=0);
   GeomData* read(DrawingObject* draw, unsigned int n, const void* data, std::string label);
   void read(GeomData* geomdata, unsigned int n, lucGeometryDataType dtype, const void* data, int width=0, int height=0, int depth=0);
+  void* reserve(DrawingObject* draw, unsigned int n, lucGeometryDataType dtype, GeomData*& geomdata, int width=0, int height=0, int depth=0);
+  void* reserve(DrawingObject* draw, unsigned int n, const std::string& label, GeomData*& geomdata);
+  DataContainer* reserveStore(DrawingObject* draw, unsigned int n, lucGeometryDataType dtype, GeomData*& geomdata, int width=0, int height=0, int depth=0);
+  DataContainer* reserveStore(DrawingObject* draw, const std::string& label, GeomData*& geomdata);
+  GeomData* share(DrawingObject* draw, DataContainer* src, lucGeometryDataType dtype, int width=0, int height=0, int depth=0);
+  GeomData* share(DrawingObject* draw, DataContainer* src, const std::string& label);
+  GeomSpan append(DrawingObject* draw, unsigned int n, unsigned int nindices, bool normals, bool texCoords=false);
+  void commit(GeomSpan& span);
   void addTriangle(DrawingObject* obj, float* a, float* b, float* c, int level, bool swapY=false);
   void setup(DrawingObject* draw);
+  void compact();
   void insertFixed(Geometry* fixed);
   void label(DrawingObject* draw, const char* labels);
   void label(DrawingObject* draw, std::vector<std::string> labels);
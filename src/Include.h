@@ -19,12 +19,18 @@
 #include <set>
 #include <algorithm>
 #include <map>
+#include <unordered_map>
 #include <deque>
 #include <iomanip>
 #include <climits>
 #include <typeinfo>
 #include <thread>
 #include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <chrono>
+#include <tuple>
+#include <memory>
 
 //C headers
 #include <assert.h>
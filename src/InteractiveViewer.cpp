@@ -851,7 +851,7 @@ bool LavaVu::parseCommand(std::string cmd, bool gethelp)
       opacity = fval / 255.0;
     else
       opacity = fval;
-    drawstate.globals["opacity"] = opacity;
+    drawstate.setGlobal("opacity", opacity);
     printMessage("Set global opacity to %.2f", opacity);
     if (amodel)
       amodel->redraw(true); //Colour prop change requires full reload
@@ -892,7 +892,7 @@ bool LavaVu::parseCommand(std::string cmd, bool gethelp)
     float w = 0, h = 0;
     if (parsed.has(w, "resize", 0) && parsed.has(h, "resize", 1))
     {
-      aview->properties.data["resolution"] = json::array({w, h});
+      aview->properties.set("resolution", json::array({w, h}));
       viewset = 2; //Force check for resize and autozoom
     }
   }
@@ -1216,7 +1216,7 @@ bool LavaVu::parseCommand(std::string cmd, bool gethelp)
       return false;
     }
 
-    aview->properties.data["near"] = fval;
+    aview->properties.set("near", fval);
   }
   else if (parsed.has(fval, "farclip"))
   {
@@ -1228,7 +1228,7 @@ bool LavaVu::parseCommand(std::string cmd, bool gethelp)
       return false;
     }
 
-    aview->properties.data["far"] = fval;
+    aview->properties.set("far", fval);
   }
   else if (parsed.exists("timestep"))  //Absolute
   {
@@ -1462,7 +1462,7 @@ bool LavaVu::parseCommand(std::string cmd, bool gethelp)
           bool vis = (action == "show");
           for (unsigned int i=0; i < amodel->geometry.size(); i++)
             amodel->geometry[i]->showObj(list[c], vis);
-          list[c]->properties.data["visible"] = vis; //This allows hiding of objects without geometry (colourbars)
+          list[c]->properties.set("visible", vis); //This allows hiding of objects without geometry (colourbars)
           printMessage("%s object %s", action.c_str(), list[c]->name().c_str());
           amodel->redraw();
         }
@@ -1532,6 +1532,77 @@ bool LavaVu::parseCommand(std::string cmd, bool gethelp)
     if (loop)
       viewer->commands.push_back(std::string("next"));
   }
+  else if (parsed.exists("follow"))
+  {
+    if (gethelp)
+    {
+      help += "> Follow a database still being written, regularly checking for new timesteps\n\n"
+              "> **Usage:** follow [interval/latest/off]\n\n"
+              "> interval (integer) : milliseconds between checks, default 1000  \n"
+              "> latest : switch to the newest timestep whenever new steps are found  \n"
+              "> off : stop following  \n"
+              "> Existing timesteps and cached data are kept when new steps are added  \n";
+      return false;
+    }
+
+    std::string action = parsed["follow"];
+    if (action == "off")
+    {
+      follow = 0;
+      followlatest = false;
+      if (!loop) viewer->idleTimer(0); //Stop idle timer, unless playing
+      printMessage("Follow mode disabled");
+    }
+    else
+    {
+      if (action == "latest")
+        followlatest = true;
+      if (parsed.has(ival, "follow"))
+        follow = ival;
+      if (follow <= 0) follow = 1000;
+      if (!loop) viewer->idleTimer(follow); //Check for new steps on idle timer
+      printMessage("Following timesteps, checking every %d ms%s", follow, followlatest ? ", switching to latest" : "");
+    }
+    return false;
+  }
+  else if (parsed.exists("region"))
+  {
+    if (gethelp)
+    {
+      help += "> Load only geometry records within a region of interest\n"
+              "> (requires database exported with spatial index)\n\n"
+              "> **Usage:** region minX minY minZ maxX maxY maxZ\n\n"
+              "> minX-maxZ (number) : bounding box, records with bounds intersecting are loaded  \n"
+              "> region view : use bounds of the current view frustum  \n"
+              "> region off : load all records  \n";
+      return false;
+    }
+
+    json region = json::array();
+    std::string action = parsed["region"];
+    if (action == "view")
+    {
+      float min[3], max[3];
+      if (!aview->frustumBounds(min, max)) return false;
+      region = {min[0], min[1], min[2], max[0], max[1], max[2]};
+    }
+    else if (action != "off")
+    {
+      for (int i=0; i<6; i++)
+      {
+        float val;
+        if (!parsed.has(val, "region", i)) return false;
+        region.push_back(val);
+      }
+    }
+
+    drawstate.setGlobal("region", region);
+    amodel->reloadStep();
+    if (region.size())
+      printMessage("Loading region %s", region.dump().c_str());
+    else
+      printMessage("Loading all records");
+  }
   else if (parsed.exists("stop"))
   {
     if (gethelp)
@@ -1540,7 +1611,7 @@ bool LavaVu::parseCommand(std::string cmd, bool gethelp)
       return false;
     }
 
-    viewer->idleTimer(0); //Stop idle redisplay timer
+    viewer->idleTimer(follow); //Stop idle redisplay timer (unless following)
     loop = false;
   }
   else if (parsed.exists("images"))
@@ -1642,11 +1713,11 @@ bool LavaVu::parseCommand(std::string cmd, bool gethelp)
 
     std::string axis = parsed["axis"];
     if (parsed["axis"] == "on")
-      aview->properties.data["axis"] = true;
+      aview->properties.set("axis", true);
     else if (parsed["axis"] == "off")
-      aview->properties.data["axis"] = false;
+      aview->properties.set("axis", false);
     else
-      aview->properties.data["axis"] = !aview->properties["axis"];
+      aview->properties.set("axis", !aview->properties["axis"]);
     printMessage("Axis %s", aview->properties["axis"] ? "ON" : "OFF");
   }
   else if (parsed.exists("toggle"))
@@ -1664,13 +1735,13 @@ bool LavaVu::parseCommand(std::string cmd, bool gethelp)
     if (aobject && aobject->properties.has(what) && aobject->properties[what].is_boolean())
     {
       bool current = aobject->properties[what];
-      aobject->properties.data[what] = !current;
+      aobject->properties.set(what, !current);
       printMessage("Property '%s' set to %s", what.c_str(), !current ? "ON" : "OFF");
     }
     else if (aview->properties.has(what) && aview->properties[what].is_boolean())
     {
       bool current = aview->properties[what];
-      aview->properties.data[what] = !current;
+      aview->properties.set(what, !current);
       printMessage("Property '%s' set to %s", what.c_str(), !current ? "ON" : "OFF");
     }
     else if (drawstate.defaults.count(what) > 0 && drawstate.global(what).is_boolean())
@@ -1763,7 +1834,7 @@ bool LavaVu::parseCommand(std::string cmd, bool gethelp)
       return false;
     }
 
-    aview->properties.data["title"] = parsed.getall("title", 0);
+    aview->properties.set("title", parsed.getall("title", 0));
   }
   else if (parsed.exists("rulers"))
   {
@@ -1774,7 +1845,7 @@ bool LavaVu::parseCommand(std::string cmd, bool gethelp)
     }
 
     //Show/hide rulers
-    aview->properties.data["rulers"] = !aview->properties["rulers"];
+    aview->properties.set("rulers", !aview->properties["rulers"]);
     printMessage("Rulers %s", aview->properties["rulers"] ? "ON" : "OFF");
   }
   else if (parsed.exists("help"))
@@ -1813,7 +1884,7 @@ bool LavaVu::parseCommand(std::string cmd, bool gethelp)
       return false;
     }
 
-    aview->properties.data["antialias"] = !aview->properties["antialias"];
+    aview->properties.set("antialias", !aview->properties["antialias"]);
     printMessage("Anti-aliasing %s", aview->properties["antialias"] ? "ON":"OFF");
   }
   else if (parsed.exists("valuerange"))
@@ -1965,15 +2036,16 @@ bool LavaVu::parseCommand(std::string cmd, bool gethelp)
     }
 
     //Remove any existing fixed bounds
-    aview->properties.data.erase("min");
-    aview->properties.data.erase("max");
+    aview->properties.erase("min");
+    aview->properties.erase("max");
     drawstate.globals.erase("min");
     drawstate.globals.erase("max");
+    Properties::changed();
     //Update the viewports and recalc bounding box
     resetViews();
     //Update fixed bounds
-    aview->properties.data["min"] = {aview->min[0], aview->min[1], aview->min[2]};
-    aview->properties.data["max"] = {aview->max[0], aview->max[1], aview->max[2]};
+    aview->properties.set("min", {aview->min[0], aview->min[1], aview->min[2]});
+    aview->properties.set("max", {aview->max[0], aview->max[1], aview->max[2]});
     printMessage("View bounds update");
   }
   else if (parsed.exists("clear"))
@@ -2054,12 +2126,12 @@ bool LavaVu::parseCommand(std::string cmd, bool gethelp)
       //Only able to set the value colourmap now
       if (cmap >= 0)
       {
-        obj->properties.data["colourmap"] = cmap;
+        obj->properties.set("colourmap", cmap);
         printMessage("%s colourmap set to %s (%d)", obj->name().c_str(), amodel->colourMaps[cmap]->name.c_str(), cmap);
       }
       else if (ival < 0 || what.length() == 0)
       {
-        obj->properties.data["colourmap"] = -1;
+        obj->properties.set("colourmap", -1);
         printMessage("%s colourmap set to none", obj->name().c_str());
       }
       else
@@ -2069,7 +2141,7 @@ bool LavaVu::parseCommand(std::string cmd, bool gethelp)
         if (what == "add")
         {
           cmap = amodel->addColourMap();
-          obj->properties.data["colourmap"] = cmap;
+          obj->properties.set("colourmap", cmap);
           if (what == "add")
             what = parsed.getall("colourmap", next+1);
           else
@@ -2088,13 +2160,13 @@ bool LavaVu::parseCommand(std::string cmd, bool gethelp)
             cmap = amodel->addColourMap();
           amodel->colourMaps[cmap]->loadPalette(what);
           //amodel->colourMaps[cmap]->print();
-          obj->properties.data["colourmap"] = cmap;
+          obj->properties.set("colourmap", cmap);
           //amodel->colourMaps[cmap]->calibrate(); //Recalibrate
         }
       }
-      //Full object reload if colours updated
+      //Full object reload if colours updated, unless mapped in shaders ("gpucolour")
       //NOTE: This will not reload other objects using the same colourmap
-      amodel->reload(obj);
+      amodel->recolour(obj);
     }
   }
   else if (parsed.exists("colourbar"))
@@ -2112,7 +2184,7 @@ bool LavaVu::parseCommand(std::string cmd, bool gethelp)
       DrawingObject* cbar = colourBar(aobject);
       std::string align = parsed["colourbar"];
       if (align.length())
-        cbar->properties.data["align"] = align;
+        cbar->properties.set("align", align);
     }
   }
   else if (parsed.exists("colour"))
@@ -2341,9 +2413,9 @@ bool LavaVu::parseCommand(std::string cmd, bool gethelp)
       if (drawstate.globals.count("pointtype") > 0)
         pt = drawstate.globals["pointtype"];
       if (parsed.has(ival, "pointtype", 1))
-        drawstate.globals["pointtype"] = ival % 5;
+        drawstate.setGlobal("pointtype", ival % 5);
       else
-        drawstate.globals["pointtype"] = (pt+1) % 5;
+        drawstate.setGlobal("pointtype", (pt+1) % 5);
       printMessage("Point type %d", (int)drawstate.globals["pointtype"]);
     }
     else
@@ -2360,11 +2432,11 @@ bool LavaVu::parseCommand(std::string cmd, bool gethelp)
       {
         int pt = obj->properties["pointtype"];
         if (parsed.has(ival, "pointtype", next))
-          obj->properties.data["pointtype"] = ival;
+          obj->properties.set("pointtype", ival);
         else if (parsed.get("pointtype", next) == "up")
-          obj->properties.data["pointtype"] = (pt-1) % 5;
+          obj->properties.set("pointtype", (pt-1) % 5);
         else if (parsed.get("pointtype", next) == "down")
-          obj->properties.data["pointtype"] = (pt+1) % 5;
+          obj->properties.set("pointtype", (pt+1) % 5);
         printMessage("%s point type set to %d", obj->name().c_str(), (int)obj->properties["pointtype"]);
         //Full object reload as data changed
         amodel->reload(obj);
@@ -2384,12 +2456,12 @@ bool LavaVu::parseCommand(std::string cmd, bool gethelp)
     }
 
     if (parsed.has(ival, "pointsample"))
-      drawstate.globals["pointsubsample"] = ival;
+      drawstate.setGlobal("pointsubsample", ival);
     else if (parsed["pointsample"] == "up")
-      drawstate.globals["pointsubsample"] = (int)drawstate.global("pointsubsample") / 2;
+      drawstate.setGlobal("pointsubsample", (int)drawstate.global("pointsubsample") / 2);
     else if (parsed["pointsample"] == "down")
-      drawstate.globals["pointsubsample"] = (int)drawstate.global("pointsubsample") * 2;
-    if ((int)drawstate.global("pointsubsample") < 1) drawstate.globals["pointsubsample"] = 1;
+      drawstate.setGlobal("pointsubsample", (int)drawstate.global("pointsubsample") * 2);
+    if ((int)drawstate.global("pointsubsample") < 1) drawstate.setGlobal("pointsubsample", 1);
     amodel->points->redraw = true;
     printMessage("Point sampling %d", (int)drawstate.global("pointsubsample"));
   }
@@ -2488,7 +2560,7 @@ bool LavaVu::parseCommand(std::string cmd, bool gethelp)
       else
         viewer->background.value = 0xff000000;
     }
-    aview->properties.data["background"] = viewer->background.toString();
+    aview->properties.set("background", viewer->background.toString());
     viewer->setBackground();
     printMessage("Background colour set");
   }
@@ -2506,22 +2578,22 @@ bool LavaVu::parseCommand(std::string cmd, bool gethelp)
     }
 
     //Frame off/on/filled
-    aview->properties.data["fillborder"] = false;
+    aview->properties.set("fillborder", false);
     if (parsed["border"] == "on")
-      aview->properties.data["border"] = 1;
+      aview->properties.set("border", 1);
     else if (parsed["border"] == "off")
-      aview->properties.data["border"] = 0;
+      aview->properties.set("border", 0);
     else if (parsed["border"] == "filled")
     {
-      aview->properties.data["fillborder"] = true;
-      aview->properties.data["border"] = 1;
+      aview->properties.set("fillborder", true);
+      aview->properties.set("border", 1);
     }
     else
     {
       if (parsed.has(ival, "border"))
-        aview->properties.data["border"] = ival;
+        aview->properties.set("border", ival);
       else
-        aview->properties.data["border"] = !aview->properties["border"];
+        aview->properties.set("border", !aview->properties["border"]);
     }
     printMessage("Frame set to %s, filled=%d", (bool)aview->properties["border"] ? "ON" : "OFF", (bool)aview->properties["fillborder"]);
   }
@@ -2587,11 +2659,11 @@ bool LavaVu::parseCommand(std::string cmd, bool gethelp)
       float scale = 1.0;
       if (drawstate.globals.count(key) > 0) scale = drawstate.globals[key];
       if (parsed.has(fval, "scale", 1))
-        drawstate.globals[key] = fval > 0.0 ? fval : 1.0;
+        drawstate.setGlobal(key, fval > 0.0 ? fval : 1.0);
       else if (parsed.get("scale", 1) == "up")
-        drawstate.globals[key] = scale * 1.5;
+        drawstate.setGlobal(key, scale * 1.5);
       else if (parsed.get("scale", 1) == "down")
-        drawstate.globals[key] = scale / 1.5;
+        drawstate.setGlobal(key, scale / 1.5);
       active->redraw = true;
       printMessage("%s scaling set to %f", what.c_str(), (float)drawstate.globals[key]);
     }
@@ -2643,11 +2715,11 @@ bool LavaVu::parseCommand(std::string cmd, bool gethelp)
           float sc = obj->properties["scaling"];
           if (sc <= 0.0) sc = 1.0;
           if (parsed.has(fval, "scale", next))
-            obj->properties.data["scaling"] = fval > 0.0 ? fval : 1.0;
+            obj->properties.set("scaling", fval > 0.0 ? fval : 1.0);
           else if (parsed.get("scale", next) == "up")
-            obj->properties.data["scaling"] = sc * 1.5;
+            obj->properties.set("scaling", sc * 1.5);
           else if (parsed.get("scale", next) == "down")
-            obj->properties.data["scaling"] = sc / 1.5;
+            obj->properties.set("scaling", sc / 1.5);
           printMessage("%s scaling set to %f", obj->name().c_str(), (float)obj->properties["scaling"]);
           for (int type=lucMinType; type<lucMaxType; type++)
             amodel->geometry[type]->redraw = true;
@@ -2723,6 +2795,8 @@ bool LavaVu::parseCommand(std::string cmd, bool gethelp)
 
     //Delete drawing object by name/ID match
     std::vector<DrawingObject*> list = lookupObjects(parsed, "delete");
+    //Background loading may reference the deleted objects
+    if (list.size()) amodel->prefetchStop();
     for (unsigned int c=0; c<list.size(); c++)
     {
       printMessage("%s deleted", list[c]->name().c_str());
@@ -2735,6 +2809,7 @@ bool LavaVu::parseCommand(std::string cmd, bool gethelp)
         if (list[c] == amodel->objects[i])
         {
           amodel->objects.erase(amodel->objects.begin()+i);
+          amodel->objectsChanged();
           break;
         }
       }
@@ -2825,14 +2900,14 @@ bool LavaVu::parseCommand(std::string cmd, bool gethelp)
     if (parsed["sort"] == "off")
     {
       //Disables all sorting
-      drawstate.globals["sort"] = 0;
+      drawstate.setGlobal("sort", 0);
       printMessage("Geometry sorting has been disabled");
     }
     else if (parsed["sort"] == "timer")
     {
       //Enables sort on timer
       //Disables sort on rotate mode
-      drawstate.globals["sort"] = TIMER_IDLE;
+      drawstate.setGlobal("sort", TIMER_IDLE);
       viewer->idleTimer(TIMER_IDLE); //Start idle redisplay timer (default 1.5 seconds)
       printMessage("Sort geometry on timer instead of rotation enabled");
     }
@@ -2840,8 +2915,8 @@ bool LavaVu::parseCommand(std::string cmd, bool gethelp)
     {
       //Enables sort on rotate mode
       //Disables sort on timer
-      drawstate.globals["sort"] = -1;
-      viewer->idleTimer(0); //Stop/disable idle redisplay timer
+      drawstate.setGlobal("sort", -1);
+      viewer->idleTimer(follow); //Stop/disable idle redisplay timer (unless following)
       printMessage("Sort geometry on rotation enabled");
     }
     else
@@ -2872,10 +2947,21 @@ bool LavaVu::parseCommand(std::string cmd, bool gethelp)
       repeat--;
       if (repeat == 0)
       {
-        viewer->idleTimer(0); //Disable idle redisplay timer
+        viewer->idleTimer(follow); //Disable idle redisplay timer (unless following)
         replay.clear();
       }
     }
+
+    //Follow mode, check for new timesteps
+    if (follow > 0 && amodel && amodel->followTimeSteps() > 0)
+    {
+      if (followlatest)
+      {
+        amodel->setTimeStep(amodel->timesteps.size()-1);
+        resetViews(); //Update the viewports
+      }
+      printMessage("Timesteps: %d, last step %d", amodel->timesteps.size(), amodel->lastStep());
+    }
     return true; //Skip record
   }
   //Special commands for passing keyboard/mouse actions directly (web server mode)
@@ -2967,7 +3053,7 @@ bool LavaVu::parseCommand(std::string cmd, bool gethelp)
     if (aobject)
     {
       std::string type = parsed.get("add", 1);
-      if (type.length() > 0) aobject->properties.data["geometry"] = type;
+      if (type.length() > 0) aobject->properties.set("geometry", type);
       printMessage("Added object: %s", aobject->name().c_str());
     }
   }
@@ -3086,7 +3172,7 @@ bool LavaVu::parseCommand(std::string cmd, bool gethelp)
       std::string name = parsed.get("name", next);
       if (name.length() > 0)
       {
-        obj->properties.data["name"] = name;
+        obj->properties.set("name", name);
         printMessage("Renamed object: %s", obj->name().c_str());
       }
     }
@@ -3171,9 +3257,10 @@ bool LavaVu::parseCommand(std::string cmd, bool gethelp)
         filter["minimum"] = val;
       else
         filter["maximum"] = val;
+      aobject->properties.modified();
       printMessage("Filter %d set from %f to %f", idx, (float)filter["minimum"], (float)filter["maximum"]);
-      //Full data reload
-      amodel->reload(aobject);
+      //Full data reload, unless only ranges changed for data filtered in the shaders
+      amodel->refilter(aobject);
     }
   }
 
@@ -3189,7 +3276,7 @@ bool LavaVu::parseCommand(std::string cmd, bool gethelp)
     if (aobject)
     {
       printMessage("Filters cleared on object %s", aobject->name().c_str());
-      aobject->properties.data.erase("filters");
+      aobject->properties.erase("filters");
       //Full data reload
       amodel->reload(aobject);
     }
@@ -3205,6 +3292,255 @@ bool LavaVu::parseCommand(std::string cmd, bool gethelp)
 
     amodel->freeze();
   }
+  else if (parsed.exists("stats"))
+  {
+    if (gethelp)
+    {
+      help += "> Print data loading and memory statistics for the active model\n";
+      return false;
+    }
+
+    std::cout << "Geometry records loaded: " << amodel->loadrecords
+              << ", copies: " << amodel->loadcopies << ", shared: " << amodel->loadshared << std::endl;
+    std::cout << "Geometry bytes loaded: " << amodel->loadbytes
+              << ", read from database: " << amodel->readbytes << std::endl;
+    std::cout << "Geometry load time, query: " << amodel->querytime
+              << " seconds, decode: " << amodel->decodetime << " seconds" << std::endl;
+    std::cout << "Geometry memory usage: " << DataArena::used/1000000.0f << " mb, peak: " << DataArena::peak/1000000.0f
+              << " mb, reserved: " << DataArena::reserved/1000000.0f << " mb, fragmentation: " << 100.0*DataArena::fragmentation() << "%" << std::endl;
+    return false;
+  }
+  else if (parsed.exists("codecs"))
+  {
+    if (gethelp)
+    {
+      help += "> Benchmark geometry record compression codecs on the loaded data\n\n"
+              "> Prints compression ratio, encode and decode throughput of each codec\n"
+              "> for the largest vertex and value data blocks of the active model  \n"
+              "> (deflate codecs use the \"compresslevel\" property)  \n"
+              "> then checks every codec, prefilter and delta mode restores these blocks,  \n"
+              "> odd length, zero length and incompressible data exactly, reporting any failures  \n";
+      return false;
+    }
+
+    FloatValues* vertices = NULL;
+    FloatValues* values = NULL;
+    for (auto g : amodel->geometry)
+    {
+      for (auto obj : amodel->objects)
+      {
+        for (auto geom : g->getAllObjects(obj))
+        {
+          if (!vertices || geom->vertices.bytes() > vertices->bytes()) vertices = &geom->vertices;
+          for (auto vals : geom->values)
+            if (!values || vals->bytes() > values->bytes()) values = vals;
+        }
+      }
+    }
+    int level = drawstate.global("compresslevel");
+    //(compact data benchmarked decoded)
+    std::vector<float> buffer;
+    int failures = 0;
+    bool checked = false;
+    if (vertices && vertices->size())
+    {
+      buffer.resize(vertices->size());
+      vertices->decode(0, buffer.size(), buffer.data());
+      Codec::benchmark(std::cout, "Vertex data", (unsigned char*)buffer.data(), buffer.size() * sizeof(float), sizeof(float), level);
+      failures += Codec::verify(std::cout, "Vertex data", (unsigned char*)buffer.data(), buffer.size() * sizeof(float), sizeof(float), level);
+      checked = true;
+    }
+    if (values && values->size())
+    {
+      buffer.resize(values->size());
+      values->decode(0, buffer.size(), buffer.data());
+      Codec::benchmark(std::cout, "Value data: " + values->label, (unsigned char*)buffer.data(), buffer.size() * sizeof(float), sizeof(float), level);
+      failures += Codec::verify(std::cout, "Value data: " + values->label, (unsigned char*)buffer.data(), buffer.size() * sizeof(float), sizeof(float), level);
+      checked = true;
+    }
+    if (!checked)
+    {
+      //No data loaded, check with a generated smooth field
+      buffer.resize(100000);
+      for (unsigned int i=0; i<buffer.size(); i++)
+        buffer[i] = sin(i * 0.001) * 100.0;
+      failures += Codec::verify(std::cout, "Generated data", (unsigned char*)buffer.data(), buffer.size() * sizeof(float), sizeof(float), level);
+    }
+    if (failures)
+      printMessage("Codec round trip FAILED: %d checks", failures);
+    else
+      printMessage("Codec round trips verified");
+    return false;
+  }
+  else if (parsed.exists("glyphbench"))
+  {
+    if (gethelp)
+    {
+      help += "> Benchmark glyph generation throughput\n\n"
+              "> **Usage:** glyphbench [count]\n\n"
+              "> count (integer) : number of arrows and of spheres to build, default 10000  \n"
+              "> (built at the quality set by the \"glyphs\" property into a scratch container)  \n";
+      return false;
+    }
+
+    if (!parsed.has(ival, "glyphbench")) ival = 10000;
+    int quality = 4 * (int)drawstate.global("glyphs");
+    DrawingObject obj(drawstate, "glyphbench");
+    float vec[3] = {1.0, 0.5, 0.2};
+    Vec3d radii(1.0, 2.0, 3.0);
+    Quaternion rot;
+    for (int shape=0; shape<2; shape++)
+    {
+      Geometry glyphs(drawstate);
+      glyphs.type = lucTriangleType;
+      auto t0 = std::chrono::steady_clock::now();
+      for (int i=0; i<ival; i++)
+      {
+        Vec3d pos(i, 0, 0);
+        if (shape == 0)
+          glyphs.drawVector(&obj, pos.ref(), vec, 1.0, 0, 0, 2.0, quality);
+        else
+          glyphs.drawEllipsoid(&obj, pos, radii, rot, quality);
+      }
+      double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+      unsigned int verts = glyphs.getVertexCount(&obj);
+      std::cout << (shape == 0 ? "Arrows: " : "Spheres: ") << ival << " glyphs, " << verts << " vertices, "
+                << secs << " seconds, " << (secs > 0 ? verts / secs / 1000000.0 : 0) << " million vertices/second" << std::endl;
+    }
+    return false;
+  }
+  else if (parsed.exists("colourbench"))
+  {
+    if (gethelp)
+    {
+      help += "> Benchmark colour mapping throughput\n\n"
+              "> **Usage:** colourbench [count]\n\n"
+              "> count (integer) : number of values to map, default 1000000  \n"
+              "> (compares per vertex lookups against batched mapping, on linear and log scales)  \n";
+      return false;
+    }
+
+    if (!parsed.has(ival, "colourbench")) ival = 1000000;
+    DrawingObject obj(drawstate, "colourbench");
+    ColourMap cmap(drawstate, "colourbench", "colours=#0000ff #00ff00 #ff0000");
+    obj.colourMap = &cmap;
+    std::vector<float> data(ival);
+    for (int i=0; i<ival; i++)
+      data[i] = 1.0 + (i * 7919 % 100000);
+    Geometry scratch(drawstate);
+    GeomData* geom = scratch.read(&obj, ival, data.data(), "values");
+    obj.colourIdx = geom->valuesIndex("values");
+    std::vector<Colour> single(ival), batch(ival);
+    for (int logscale=0; logscale<2; logscale++)
+    {
+      cmap.properties.set("logscale", (bool)logscale);
+      cmap.calibrated = false;
+      cmap.calibrate(1.0, 100000.0);
+      auto t0 = std::chrono::steady_clock::now();
+      for (int i=0; i<ival; i++)
+        geom->getColour(single[i], i);
+      double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+      t0 = std::chrono::steady_clock::now();
+      geom->fillColours(batch.data(), 0, ival);
+      double bsecs = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+      int diff = 0;
+      for (int i=0; i<ival; i++)
+        if (single[i].value != batch[i].value) diff++;
+      std::cout << (logscale ? "Log scale: " : "Linear: ") << ival << " values, per vertex "
+                << (secs > 0 ? ival / secs / 1000000.0 : 0) << " million colours/second, batched "
+                << (bsecs > 0 ? ival / bsecs / 1000000.0 : 0) << " million colours/second, "
+                << diff << " differences" << std::endl;
+    }
+    return false;
+  }
+  else if (parsed.exists("propbench"))
+  {
+    if (gethelp)
+    {
+      help += "> Benchmark property resolution throughput\n\n"
+              "> **Usage:** propbench [count]\n\n"
+              "> count (integer) : number of lookups of each kind, default 1000000  \n"
+              "> (compares string key lookups against interned key id lookups, on an object and on globals)  \n";
+      return false;
+    }
+
+    if (!parsed.has(ival, "propbench")) ival = 1000000;
+    //Mix of object, global and default layer hits
+    DrawingObject obj(drawstate, "propbench", "pointsize=2\nopacity=0.5");
+    std::vector<std::string> keys = {"pointsize", "opacity", "scaling", "glyphs", "flat", "colour", "lit", "arrowhead"};
+    std::vector<unsigned int> ids;
+    for (auto key : keys)
+      ids.push_back(PropertyKeys::id(key));
+    for (int mode=0; mode<4; mode++)
+    {
+      float sum = 0;
+      auto t0 = std::chrono::steady_clock::now();
+      for (int i=0; i<ival; i++)
+      {
+        unsigned int k = i % keys.size();
+        const json& val = mode == 0 ? obj.properties[keys[k]]
+                        : mode == 1 ? obj.properties[ids[k]]
+                        : mode == 2 ? drawstate.global(keys[k])
+                        : drawstate.global(ids[k]);
+        if (val.is_number()) sum += (float)val;
+      }
+      double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+      const char* labels[] = {"Object by key: ", "Object by id: ", "Global by key: ", "Global by id: "};
+      std::cout << labels[mode] << ival << " lookups, " << secs << " seconds, "
+                << (secs > 0 ? ival / secs / 1000000.0 : 0) << " million lookups/second (" << sum << ")" << std::endl;
+    }
+    return false;
+  }
+  else if (parsed.exists("cache"))
+  {
+    if (gethelp)
+    {
+      help += "> Timestep cache control and statistics (requires \"cache\" property enabled)\n\n"
+              "> **Usage:** cache [pin/unpin/clear] [step]\n\n"
+              "> With no arguments, prints cache statistics  \n"
+              "> pin : keep timestep in cache, never evict when \"cachesize\" limit reached  \n"
+              "> unpin : allow timestep to be evicted again  \n"
+              "> clear : free all cached timesteps  \n"
+              "> step (integer) : the timestep to pin/unpin, default is current  \n";
+      return false;
+    }
+
+    std::string action = parsed["cache"];
+    if (action == "pin" || action == "unpin")
+    {
+      int idx = drawstate.now;
+      if (parsed.has(ival, "cache", 1))
+        idx = amodel->nearestTimeStep(ival);
+      amodel->cachePin(idx, action == "pin");
+      if (idx >= 0 && idx < (int)amodel->timesteps.size())
+        printMessage("Timestep %d %s", amodel->timesteps[idx]->step, action == "pin" ? "pinned" : "unpinned");
+    }
+    else if (action == "clear")
+    {
+      amodel->deleteCache();
+      printMessage("Cache cleared");
+    }
+    else
+    {
+      int cached = 0;
+      std::stringstream pinned;
+      for (unsigned int i=0; i<amodel->timesteps.size(); i++)
+      {
+        if (amodel->timesteps[i]->cache.size() > 0) cached++;
+        if (amodel->timesteps[i]->pinned) pinned << amodel->timesteps[i]->step << " ";
+      }
+      float cachesize = drawstate.global("cachesize");
+      std::cout << "Cached timesteps: " << cached << " / " << amodel->timesteps.size();
+      if (cachesize > 0)
+        std::cout << ", limit " << cachesize << " mb";
+      std::cout << ", cached " << amodel->cacheBytes()/1000000.0f << " mb, geometry memory usage " << DataArena::used/1000000.0f << " mb" << std::endl;
+      std::cout << "Hits: " << amodel->cachehits << ", misses: " << amodel->cachemisses
+                << ", evictions: " << amodel->cacheevictions << ", prefetched: " << amodel->prefetchloads << std::endl;
+      if (pinned.str().length())
+        std::cout << "Pinned: " << pinned.str() << std::endl;
+    }
+    return false;
+  }
   else
   {
     //If value parses as integer and contains nothing else
@@ -3260,9 +3596,9 @@ void LavaVu::helpCommand(std::string cmd)
     {"background", "alpha", "axis", "scaling", "rulers",
      "antialias", "valuerange", "colourmap", "colourbar", "pointtype",
      "pointsample", "border", "title", "scale", "modelscale"},
-    {"next", "play", "stop", "open", "interactive"},
+    {"next", "play", "stop", "follow", "open", "interactive"},
     {"shaders", "blend", "props", "defaults", "test", "voltest", "newstep", "filter", "filterout", "filtermin", "filtermax", "clearfilters",
-     "verbose", "toggle", "createvolume", "clearvolume"}
+     "verbose", "toggle", "createvolume", "clearvolume", "stats", "cache", "region", "codecs", "glyphbench", "propbench", "colourbench"}
   };
 
   //Verbose command help
@@ -146,7 +146,7 @@ void LavaVu::defaults()
   writeimage = false;
   writemovie = 0;
 #ifdef USE_OMEGALIB
-  drawstate.globals["sort"] = 0;
+  drawstate.setGlobal("sort", 0);
 #endif
   message[0] = '\0';
   volume = NULL;
@@ -159,6 +159,8 @@ void LavaVu::defaults()
 
   loop = false;
   animate = 0;
+  follow = 0;
+  followlatest = false;
   repeat = 0;
   encoder = NULL;
 }
@@ -176,7 +178,7 @@ LavaVu::~LavaVu()
 #ifdef HAVE_LIBAVCODEC
   if (encoder) delete encoder;
 #endif
-  debug_print("LavaVu closing: peak geometry memory usage: %.3f mb\n", mempeak__/1000000.0f);
+  debug_print("LavaVu closing: peak geometry memory usage: %.3f mb\n", DataArena::peak/1000000.0f);
   if (viewer) delete viewer;
 }
 
@@ -280,13 +282,13 @@ void LavaVu::arguments(std::vector<std::string> args)
         break;
       case 'r':
         ss >> vars[0] >> x >> vars[1];
-        drawstate.globals["resolution"] = json::array({vars[0], vars[1]});
+        drawstate.setGlobal("resolution", json::array({vars[0], vars[1]}));
         break;
       case 'N':
-        drawstate.globals["noload"] = true;
+        drawstate.setGlobal("noload", true);
         break;
       case 'A':
-        drawstate.globals["hideall"] = true;
+        drawstate.setGlobal("hideall", true);
         break;
       case 'v':
         parseCommands("verbose on");
@@ -296,30 +298,30 @@ void LavaVu::arguments(std::vector<std::string> args)
         break;
       case 'c':
         ss >> vars[0];
-        if (vars[0]) drawstate.globals["cache"] = true;
+        if (vars[0]) drawstate.setGlobal("cache", true);
         break;
       case 't':
         //Use alpha channel in png output
-        drawstate.globals["pngalpha"] = true;
+        drawstate.setGlobal("pngalpha", true);
         break;
       case 'y':
         //Swap y & z axis on import
-        drawstate.globals["swapyz"] = true;
+        drawstate.setGlobal("swapyz", true);
         break;
       case 'T':
         //Split triangles
         ss >> vars[0];
-        drawstate.globals["trisplit"] = vars[0];
+        drawstate.setGlobal("trisplit", vars[0]);
         break;
       case 'C':
         //Global camera
-        drawstate.globals["globalcam"] = true;
+        drawstate.setGlobal("globalcam", true);
         break;
       case 'V':
         {
           float res[3];
           ss >> res[0] >> x >> res[1] >> x >> res[2];
-          drawstate.globals["volres"] = {res[0], res[1], res[2]};
+          drawstate.setGlobal("volres", {res[0], res[1], res[2]});
         }
         break;
       case 'd':
@@ -371,7 +373,7 @@ void LavaVu::arguments(std::vector<std::string> args)
         break;
       case 'e':
         //Add new timesteps after loading files
-        drawstate.globals["filestep"] = true;
+        drawstate.setGlobal("filestep", true);
         break;
       default:
         //Attempt to interpret as timestep
@@ -534,7 +536,11 @@ void LavaVu::clearData(bool objects)
   if (objects)
   {
     if (aview) aview->objects.clear();
-    if (amodel) amodel->objects.clear();
+    if (amodel)
+    {
+      amodel->objects.clear();
+      amodel->objectsChanged();
+    }
   }
   aobject = NULL;
 }
@@ -964,7 +970,7 @@ void LavaVu::createDemoVolume()
     addObject(vobj);
 
     //Demo colourmap, depth 
-    vobj->properties.data["colourmap"] = colourMap("volume", "#3333ff #00ffff #ffff77 #ff8800 #ff0000 #000000");
+    vobj->properties.set("colourmap", colourMap("volume", "#3333ff #00ffff #ffff77 #ff8800 #ff0000 #000000"));
     //Add colour bar display
     colourBar(vobj);
 
@@ -1217,7 +1223,7 @@ void LavaVu::readHeightMapImage(const FilePath& fn)
   obj = addObject(new DrawingObject(drawstate, fn.base, props));
 
   //Default colourmap
-  obj->properties.data["colourmap"] = colourMap("elevation", "darkgreen yellow brown");
+  obj->properties.set("colourmap", colourMap("elevation", "darkgreen yellow brown"));
 
   Vec3d vertex;
 
@@ -1322,26 +1328,25 @@ void LavaVu::readOBJ(const FilePath& fn)
     if (trisplit == 0 || attrib.texcoords.size())
     {
 #if 1
-      int voffset = 0;
-      for (size_t f=0; f < shapes[i].mesh.indices.size(); f+=3)
+      //Reserve all the shape's vertices, indices and attributes, then copy in
+      unsigned int count = shapes[i].mesh.indices.size() / 3 * 3;
+      GeomSpan span = amodel->triSurfaces->append(tobj, count, count, attrib.normals.size() > 0, attrib.texcoords.size() > 0);
+      for (unsigned int v=0; v < count; v++)
       {
-        tinyobj::index_t ids[3] = {shapes[i].mesh.indices[f], shapes[i].mesh.indices[f+1], shapes[i].mesh.indices[f+2]};
-        for (int c=0; c<3; c++)
+        tinyobj::index_t& id = shapes[i].mesh.indices[v];
+        memcpy(span.vertices + 3*v, &attrib.vertices[3*id.vertex_index], sizeof(float) * 3);
+        span.indices[v] = span.offset + v;
+        if (span.texCoords)
+          memcpy(span.texCoords + 2*v, &attrib.texcoords[2*id.texcoord_index], sizeof(float) * 2);
+        if (span.normals)
         {
-          amodel->triSurfaces->read(tobj, 1, lucVertexData, &attrib.vertices[3*ids[c].vertex_index]);
-          amodel->triSurfaces->read(tobj, 1, lucIndexData, &voffset);
-          voffset++;
-          if (attrib.texcoords.size())
-            amodel->triSurfaces->read(tobj, 1, lucTexCoordData, &attrib.texcoords[2*ids[c].texcoord_index]);
-          if (attrib.normals.size())
-          {
-            //Some files skip the normal index, so assume it is the same as vertex index
-            int nidx = ids[c].normal_index;
-            if (nidx < 0) nidx = ids[c].vertex_index;
-            amodel->triSurfaces->read(tobj, 1, lucNormalData, &attrib.normals[3*nidx]);
-          }
+          //Some files skip the normal index, so assume it is the same as vertex index
+          int nidx = id.normal_index;
+          if (nidx < 0) nidx = id.vertex_index;
+          memcpy(span.normals + 3*v, &attrib.normals[3*nidx], sizeof(float) * 3);
         }
       }
+      amodel->triSurfaces->commit(span);
 #else
       int v0 = attrib.vertices.size();
       int v1 = 0;
@@ -1442,7 +1447,7 @@ void LavaVu::createDemoModel(unsigned int numpoints)
   DrawingObject* obj = addObject(new DrawingObject(drawstate, "particles", "opacity=0.75\nstatic=1\nlit=0\n"));
   //Demo colourmap, distance from model origin
   int cmap = colourMap("particles", "#66bb33 #00ff00 #3333ff #00ffff #ffff77 #ff8800 #ff0000 #000000");
-  obj->properties.data["colourmap"] = cmap;
+  obj->properties.set("colourmap", cmap);
   //Add colour bar display
   colourBar(obj);
   int pointsperswarm = numpoints/4; //4 swarms
@@ -1465,7 +1470,7 @@ void LavaVu::createDemoModel(unsigned int numpoints)
 
   //Add lines
   obj = addObject(new DrawingObject(drawstate, "line-segments", "static=1\nlit=0\n"));
-  obj->properties.data["colourmap"] = cmap;
+  obj->properties.set("colourmap", cmap);
   for (int i=0; i < 50; i++)
   {
     float colour, ref[3];
@@ -1494,7 +1499,7 @@ void LavaVu::createDemoModel(unsigned int numpoints)
     obj = addObject(new DrawingObject(drawstate, label, "opacity=0.5\nstatic=1\n"));
     Colour c;
     c.value = (0xff000000 | 0xff<<(8*i));
-    obj->properties.data["colour"] = c.toJson();
+    obj->properties.set("colour", c.toJson());
     //amodel->triSurfaces->read(obj, 4, lucVertexData, verts[i], 2, 2);
     //Read 2 triangles and split recursively for a nicer surface
     amodel->triSurfaces->addTriangle(obj, &verts[i][0], &verts[i][1*3], &verts[i][3*3], 8);
@@ -1534,22 +1539,26 @@ void LavaVu::reloadShaders()
   //Point shaders
   if (drawstate.prog[lucPointType]) delete drawstate.prog[lucPointType];
   drawstate.prog[lucPointType] = new Shader("pointShader.vert", "pointShader.frag");
-  const char* pUniforms[14] = {"uPointScale", "uPointType", "uOpacity", "uPointDist", "uTextured", "uTexture", "uClipMin", "uClipMax", "uBrightness", "uContrast", "uSaturation", "uAmbient", "uDiffuse", "uSpecular"};
-  drawstate.prog[lucPointType]->loadUniforms(pUniforms, 14);
-  const char* pAttribs[2] = {"aSize", "aPointType"};
-  drawstate.prog[lucPointType]->loadAttribs(pAttribs, 2);
+  const char* pUniforms[21] = {"uPointScale", "uPointType", "uOpacity", "uPointDist", "uTextured", "uTexture", "uClipMin", "uClipMax", "uBrightness", "uContrast", "uSaturation", "uAmbient", "uDiffuse", "uSpecular", "uColourMap", "uColourMapTexel", "uColourRange", "uColourFlags", "uFilterMin", "uFilterMax", "uFilterMode"};
+  drawstate.prog[lucPointType]->loadUniforms(pUniforms, 21);
+  const char* pAttribs[4] = {"aSize", "aPointType", "aColourValue", "aFilterValue"};
+  drawstate.prog[lucPointType]->loadAttribs(pAttribs, 4);
 
   //Line shaders
   if (drawstate.prog[lucLineType]) delete drawstate.prog[lucLineType];
   drawstate.prog[lucLineType] = new Shader("lineShader.vert", "lineShader.frag");
-  const char* lUniforms[6] = {"uOpacity", "uClipMin", "uClipMax", "uBrightness", "uContrast", "uSaturation"};
-  drawstate.prog[lucLineType]->loadUniforms(lUniforms, 6);
+  const char* lUniforms[10] = {"uOpacity", "uClipMin", "uClipMax", "uBrightness", "uContrast", "uSaturation", "uColourMap", "uColourMapTexel", "uColourRange", "uColourFlags"};
+  drawstate.prog[lucLineType]->loadUniforms(lUniforms, 10);
+  const char* lAttribs[1] = {"aColourValue"};
+  drawstate.prog[lucLineType]->loadAttribs(lAttribs, 1);
 
   //Triangle shaders
   if (drawstate.prog[lucTriangleType]) delete drawstate.prog[lucTriangleType];
   drawstate.prog[lucTriangleType] = new Shader("triShader.vert", "triShader.frag");
-  const char* tUniforms[13] = {"uOpacity", "uLighting", "uTextured", "uTexture", "uCalcNormal", "uClipMin", "uClipMax", "uBrightness", "uContrast", "uSaturation", "uAmbient", "uDiffuse", "uSpecular"};
-  drawstate.prog[lucTriangleType]->loadUniforms(tUniforms, 13);
+  const char* tUniforms[17] = {"uOpacity", "uLighting", "uTextured", "uTexture", "uCalcNormal", "uClipMin", "uClipMax", "uBrightness", "uContrast", "uSaturation", "uAmbient", "uDiffuse", "uSpecular", "uColourMap", "uColourMapTexel", "uColourRange", "uColourFlags"};
+  drawstate.prog[lucTriangleType]->loadUniforms(tUniforms, 17);
+  const char* tAttribs[1] = {"aColourValue"};
+  drawstate.prog[lucTriangleType]->loadAttribs(tAttribs, 1);
   drawstate.prog[lucGridType] = drawstate.prog[lucTriangleType];
 
   //Volume ray marching shaders
@@ -1577,7 +1586,7 @@ void LavaVu::resize(int new_width, int new_height)
 
   //Set resolution
   //drawstate.globals["resolution"] = {new_width, new_height};
-  aview->properties.data["resolution"] = {new_width, new_height};
+  aview->properties.set("resolution", {new_width, new_height});
 
   amodel->redraw();
 }
@@ -2023,11 +2032,11 @@ void LavaVu::drawRulers()
   if (!obj) obj = new DrawingObject(drawstate, "", "wireframe=false\nclip=false\nlit=false");
   if (!aview->hasObject(obj)) aview->addObject(obj);
   rulers->add(obj);
-  obj->properties.data["linewidth"] = (float)aview->properties["rulerwidth"];
-  obj->properties.data["fontscale"] = (float)aview->properties["fontscale"] * 0.5*aview->model_size;
-  obj->properties.data["font"] = "vector";
+  obj->properties.set("linewidth", (float)aview->properties["rulerwidth"]);
+  obj->properties.set("fontscale", (float)aview->properties["fontscale"] * 0.5*aview->model_size);
+  obj->properties.set("font", "vector");
   //Colour for labels
-  obj->properties.data["colour"] = viewer->textColour.toJson();
+  obj->properties.set("colour", viewer->textColour.toJson());
 
 
   int ticks = aview->properties["rulerticks"];
@@ -2145,24 +2154,24 @@ void LavaVu::drawBorder()
   border->setView(aview);
   if (!obj) obj = new DrawingObject(drawstate, "", "clip=false\n");
   if (!aview->hasObject(obj)) aview->addObject(obj);
-  obj->properties.data["colour"] = aview->properties["bordercolour"];
-  if (!aview->is3d) obj->properties.data["depthtest"] = false;
+  obj->properties.set("colour", aview->properties["bordercolour"]);
+  if (!aview->is3d) obj->properties.set("depthtest", false);
 
   infostream = NULL; //Disable debug output while drawing this
   bool filled = aview->properties["fillborder"];
 
   if (!filled)
   {
-    obj->properties.data["lit"] = false;
-    obj->properties.data["wireframe"] = true;
-    obj->properties.data["cullface"] = false;
-    obj->properties.data["linewidth"] = bordersize - 0.5;
+    obj->properties.set("lit", false);
+    obj->properties.set("wireframe", true);
+    obj->properties.set("cullface", false);
+    obj->properties.set("linewidth", bordersize - 0.5);
   }
   else
   {
-    obj->properties.data["lit"] = true;
-    obj->properties.data["wireframe"] = false;
-    obj->properties.data["cullface"] = true;
+    obj->properties.set("lit", true);
+    obj->properties.set("wireframe", false);
+    obj->properties.set("cullface", true);
   }
 
   Vec3d minvert = Vec3d(aview->min);
@@ -2439,7 +2448,7 @@ bool LavaVu::loadFile(const std::string& file)
 
     //Set default window title to model name
     std::string name = drawstate.global("caption");
-    if (name == APPNAME__ && !amodel->memorydb) drawstate.globals["caption"] = amodel->file.base;
+    if (name == APPNAME__ && !amodel->memorydb) drawstate.setGlobal("caption", amodel->file.base);
 
     //Save path of first sucessfully loaded model
     if (dbpath && viewer->output_path.length() == 0)
@@ -2833,7 +2842,7 @@ DrawingObject* LavaVu::colourBar(DrawingObject* obj)
 {
   //Add colour bar display to specified object
   DrawingObject* cbar = addObject(new DrawingObject(drawstate, obj->name() + "_colourbar", "colourbar=1\n"));
-  cbar->properties.data["colourmap"] = obj->properties["colourmap"];
+  cbar->properties.set("colourmap", obj->properties["colourmap"]);
   return cbar;
 }
 
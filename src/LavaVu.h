@@ -107,6 +107,8 @@ protected:
 public:
   bool loop;
   int animate;
+  int follow;         //Follow mode check interval (ms), 0 = disabled
+  bool followlatest;  //Follow mode switches to newest timestep
   bool status;
   bool objectlist;
   char message[MAX_MSG];
@@ -35,6 +35,15 @@
 
 #include "Geometry.h"
 
+//Interned ids of properties read in update() and draw()
+static const unsigned int tubesKey = PropertyKeys::id("tubes");
+static const unsigned int limitKey = PropertyKeys::id("limit");
+static const unsigned int linkKey = PropertyKeys::id("link");
+static const unsigned int glyphsKey = PropertyKeys::id("glyphs");
+static const unsigned int scalelinesKey = PropertyKeys::id("scalelines");
+static const unsigned int scalingKey = PropertyKeys::id("scaling");
+static const unsigned int linewidthKey = PropertyKeys::id("linewidth");
+
 Lines::Lines(DrawState& drawstate, bool all2Dflag) : Geometry(drawstate)
 {
   type = lucLineType;
@@ -55,6 +64,7 @@ Lines::~Lines()
 void Lines::close()
 {
   tris->close();
+  Geometry::close();
 }
 
 void Lines::update()
@@ -71,7 +81,7 @@ void Lines::update()
   linetotal = 0;
   for (unsigned int i=0; i<geom.size(); i++)
   { //Force true as default here, global default is false for "flat"
-    if (all2d || (geom[i]->draw->properties.getBool("flat", true) && !geom[i]->draw->properties["tubes"]))
+    if (all2d || (geom[i]->draw->properties.getBool("flat", true) && !geom[i]->draw->properties[tubesKey]))
       linetotal += geom[i]->count;
   }
 
@@ -80,6 +90,9 @@ void Lines::update()
   unsigned char *p, *ptr;
   ptr = p = NULL;
   int datasize = sizeof(float) * 3 + sizeof(Colour);   //Vertex(3), and 32-bit colour
+  bool values = loadColourSlots();
+  if (values)
+    datasize += sizeof(float) * 2;   //Raw colour value and slot for mapping in shader
   int bsize = linetotal * datasize;
   if (linetotal > 0)
   {
@@ -108,27 +121,41 @@ void Lines::update()
 
     //Calibrate colour maps on range for this object
     geom[i]->colourCalibrate();
-    float limit = props["limit"];
-    bool linked = props["link"];
+    float limit = props[limitKey];
+    bool linked = props[linkKey];
 
-    if (all2d || (props.getBool("flat", true) && !props["tubes"]))
+    if (all2d || (props.getBool("flat", true) && !props[tubesKey]))
     {
       int hasColours = geom[i]->colourCount();
       int colrange = hasColours ? geom[i]->count / hasColours : 1;
       if (colrange < 1) colrange = 1;
       debug_print("Using 1 colour per %d vertices (%d : %d)\n", colrange, geom[i]->count, hasColours);
 
-      Colour colour;
+      //Without colour data every vertex gets the same colour
+      //Colours are mapped here unless the shader can map the raw values
+      int slot = colourSlot(i);
+      std::vector<Colour> colours(hasColours > 0 ? hasColours : 1);
+      std::vector<float> cvalues(slot < 0 ? 0 : hasColours);
+      if (slot >= 0)
+        geom[i]->fillValues(cvalues.data(), 0, hasColours);
+      else if (hasColours > 0)
+        geom[i]->fillColours(colours.data(), 0, hasColours);
+      else
+        geom[i]->getColour(colours[0], -1);
+      geom[i]->filterMask();
       for (unsigned int v=0; v < geom[i]->count; v++)
       {
-        if (!internal && geom[i]->filter(i)) continue;
+        if (!internal && geom[i]->filter(v)) continue;
 
         //Check length limit if applied (used for periodic boundary conditions)
         //NOTE: will not work with linked lines, require separated segments
         if (!linked && v%2 == 0 && v < geom[i]->count-1 && limit > 0.f)
         {
           Vec3d line;
-          vectorSubtract(line, geom[i]->vertices[v+1], geom[i]->vertices[v]);
+          float v0[3], v1[3];
+          geom[i]->vertices.get(v, v0);
+          geom[i]->vertices.get(v+1, v1);
+          vectorSubtract(line, v1, v0);
           if (line.magnitude() > limit) 
           {
             //Skip next two vertices
@@ -140,16 +167,21 @@ void Lines::update()
         //Have colour values but not enough for per-vertex, spread over range (eg: per segment)
         int cidx = v / colrange;
         if (cidx >= hasColours) cidx = hasColours - 1;
-        geom[i]->getColour(colour, cidx);
-        //if (cidx%100 ==0) printf("COLOUR %d => %d,%d,%d\n", cidx, colour.r, colour.g, colour.b);
+        if (cidx < 0) cidx = 0;
         //Write vertex data to vbo
         assert((int)(ptr-p) < bsize);
-        //Copies vertex bytes
-        memcpy(ptr, &geom[i]->vertices[v][0], sizeof(float) * 3);
+        //Copies vertex bytes (decoded if compact)
+        geom[i]->vertices.get(v, (float*)ptr);
         ptr += sizeof(float) * 3;
         //Copies colour bytes
-        memcpy(ptr, &colour, sizeof(Colour));
+        memcpy(ptr, &colours[cidx], sizeof(Colour));
         ptr += sizeof(Colour);
+        if (values)
+        {
+          float cv[2] = {slot < 0 ? 0.0f : cvalues[cidx], (float)slot};
+          memcpy(ptr, cv, sizeof(float) * 2);
+          ptr += sizeof(float) * 2;
+        }
 
         //Count of vertices actually plotted
         counts[i]++;
@@ -167,27 +199,29 @@ void Lines::update()
       tris->add(geom[i]->draw);
 
       //3d lines - using triangle sub-renderer
-      geom[i]->draw->properties.data["lit"] = true; //Override lit
+      geom[i]->draw->properties.set("lit", true); //Override lit
       //Draw as 3d cylinder sections
-      int quality = 4 * (int)props["glyphs"];
-      float scaling = props["scalelines"];
+      int quality = 4 * (int)props[glyphsKey];
+      float scaling = props[scalelinesKey];
       //Don't apply object scaling to internal lines objects
-      if (!internal) scaling *= (float)props["scaling"];
+      if (!internal) scaling *= (float)props[scalingKey];
       float radius = scaling*0.1;
-      float* oldpos = NULL;
-      Colour colour;
+      float pos[3], oldpos[3];
+      bool started = false;
+      std::vector<Colour> colours(geom[i]->count);
+      geom[i]->fillColours(colours.data(), 0, geom[i]->count);
       for (unsigned int v=0; v < geom[i]->count; v++)
       {
-        if (v%2 == 0 && !linked) oldpos = NULL;
-        float* pos = geom[i]->vertices[v];
-        if (oldpos)
+        if (v%2 == 0 && !linked) started = false;
+        geom[i]->vertices.get(v, pos);
+        if (started)
         {
           tris->drawTrajectory(geom[i]->draw, oldpos, pos, radius, radius, -1, view->scale, limit, quality);
           //Per line colours (can do this as long as sub-renderer always outputs same tri count)
-          geom[i]->getColour(colour, v);
-          tris->read(geom[i]->draw, 1, lucRGBAData, &colour.value);
+          tris->read(geom[i]->draw, 1, lucRGBAData, &colours[v].value);
         }
-        oldpos = pos;
+        memcpy(oldpos, pos, sizeof(pos));
+        started = true;
       }
 
       //Adjust bounding box
@@ -230,6 +264,8 @@ void Lines::draw()
   clock_t t0 = clock();
   double time;
   int stride = 3 * sizeof(float) + sizeof(Colour);   //3+3+2 vertices, normals, texCoord + 32-bit colour
+  if (colourslots.size())
+    stride += 2 * sizeof(float);   //+ raw colour value and slot
   int offset = 0;
   if (geom.size() > 0 && elements > 0 && glIsBuffer(vbo))
   {
@@ -238,6 +274,7 @@ void Lines::draw()
     glColorPointer(4, GL_UNSIGNED_BYTE, stride, (GLvoid*)(3*sizeof(float)));   // Load rgba, offset 3 float
     glEnableClientState(GL_VERTEX_ARRAY);
     glEnableClientState(GL_COLOR_ARRAY);
+    GLint aColourValue = useColourMaps(drawstate.prog[lucLineType], stride, 3*sizeof(float) + sizeof(Colour));
 
     //Disable depth test on 2d models
     if (view->is3d)
@@ -248,20 +285,20 @@ void Lines::draw()
     for (unsigned int i=0; i<geom.size(); i++)
     {
       Properties& props = geom[i]->draw->properties;
-      if (drawable(i) && props.getBool("flat", true) && !props["tubes"])
+      if (drawable(i) && props.getBool("flat", true) && !props[tubesKey])
       {
         //Set draw state
         setState(i, drawstate.prog[lucLineType]);
 
         //Lines specific state
-        float scaling = props["scalelines"];
+        float scaling = props[scalelinesKey];
         //Don't apply object scaling to internal lines objects
-        if (!internal) scaling *= (float)props["scaling"];
-        float lineWidth = (float)props["linewidth"] * scaling * view->scale2d; //Include 2d scale factor
+        if (!internal) scaling *= (float)props[scalingKey];
+        float lineWidth = (float)props[linewidthKey] * scaling * view->scale2d; //Include 2d scale factor
         if (lineWidth <= 0) lineWidth = scaling;
         glLineWidth(lineWidth);
 
-        if (props["link"])
+        if (props[linkKey])
           glDrawArrays(GL_LINE_STRIP, offset, counts[i]);
         else
           glDrawArrays(GL_LINES, offset, counts[i]);
@@ -270,6 +307,7 @@ void Lines::draw()
       offset += counts[i];
     }
 
+    releaseColourMaps(aColourValue);
     glDisableClientState(GL_VERTEX_ARRAY);
     glDisableClientState(GL_COLOR_ARRAY);
   }
@@ -39,6 +39,21 @@
 Model::Model(DrawState& drawstate) : drawstate(drawstate), readonly(true), attached(0), now(-1), db(NULL), memorydb(false), figure(-1)
 {
   prefix[0] = '\0';
+  loadrecords = loadcopies = loadshared = 0;
+  loadbytes = readbytes = 0;
+  cacheclock = cachehits = cachemisses = cacheevictions = 0;
+  prefetchloads = 0;
+  attachclock = 0;
+  writestatement = NULL;
+  writebytes = writtenbytes = 0;
+  writeid = 0;
+  querytime = decodetime = 0;
+  prefetchbusy = -1;
+  prefetchquit = false;
+  inflatebusy = 0;
+  inflatefailed = -1;
+  inflatequit = false;
+  sharedblocks = std::make_shared<SharedBlocks>();
   
   //Create new geometry containers
   init();
@@ -110,10 +125,31 @@ void Model::init()
     if (hideall)
       geometry[i]->hideShowAll(true);
   }
+
+  newArena();
+}
+
+void Model::newArena()
+{
+  //Data of the step loaded into the containers allocated from one arena per step,
+  //if no store of the previous step is left its slabs are reset in one go,
+  //otherwise that arena is freed with the last store using it and a new one started
+  std::shared_ptr<DataArena> arena = geometry.size() ? geometry[0]->arena : NULL;
+  long holders = 1;
+  for (unsigned int i=0; i < geometry.size(); i++)
+    if (geometry[i]->arena == arena) holders++;
+  if (arena && arena.use_count() == holders)
+    arena->reset();
+  else
+    arena = std::make_shared<DataArena>();
+  for (unsigned int i=0; i < geometry.size(); i++)
+    geometry[i]->arena = arena;
 }
 
 Model::~Model()
 {
+  prefetchStop();
+  inflateStop();
   clearTimeSteps();
 
   //Clear drawing objects
@@ -128,6 +164,7 @@ Model::~Model()
   for(unsigned int i=0; i<colourMaps.size(); i++)
     delete colourMaps[i];
 
+  clearQueries();
   if (db) sqlite3_close(db);
 
   fignames.clear();
@@ -146,7 +183,7 @@ bool Model::loadFigure(int fig)
 
   //Set window caption
   if (fignames[figure].length() > 0)
-    drawstate.globals["caption"] = fignames[figure];
+    drawstate.setGlobal("caption", fignames[figure]);
   return true;
 }
 
@@ -191,20 +228,26 @@ void Model::addObject(DrawingObject* obj)
       if (o->name() == obj->name())
       {
         found = true;
-        obj->properties.data["name"] = obj->name() + "_";
+        obj->properties.set("name", obj->name() + "_");
       }
     }
   } while (found);
 
   //Create master drawing object list entry
   objects.push_back(obj);
+  objectindex.clear();
 }
 
 DrawingObject* Model::findObject(unsigned int id)
 {
-  for (unsigned int i=0; i<objects.size(); i++)
-    if (objects[i]->dbid == id) return objects[i];
-  return NULL;
+  //Index built on first use after the object list or ids change
+  if (objectindex.empty())
+  {
+    for (unsigned int i=0; i<objects.size(); i++)
+      objectindex.insert(std::make_pair(objects[i]->dbid, i)); //(first object with id)
+  }
+  auto it = objectindex.find(id);
+  return it != objectindex.end() ? objects[it->second] : NULL;
 }
 
 bool Model::open(bool write)
@@ -238,63 +281,139 @@ bool Model::open(bool write)
 void Model::reopen(bool write)
 {
   if (!readonly || !db) return;
+  clearQueries();
   if (db) sqlite3_close(db);
   open(write);
 
-  //Re-attach any attached db file
-  if (attached)
+  //Re-attach any attached db files
+  std::map<int, unsigned long> pool = attachpool;
+  attachpool.clear();
+  for (auto it : pool)
   {
-    char SQL[SQL_QUERY_MAX];
-    sprintf(SQL, "attach database '%s' as t%d", timesteps[drawstate.now]->path.c_str(), attached);
-    if (issue(SQL))
-      debug_print("Model %s found and re-attached\n", timesteps[drawstate.now]->path.c_str());
+    for (unsigned int idx=0; idx < timesteps.size(); idx++)
+    {
+      if (timesteps[idx]->step != it.first) continue;
+      char SQL[SQL_QUERY_MAX];
+      sprintf(SQL, "attach database '%s' as t%d", timesteps[idx]->path.c_str(), it.first);
+      if (issue(SQL))
+      {
+        debug_print("Model %s found and re-attached\n", timesteps[idx]->path.c_str());
+        attachpool[it.first] = it.second;
+      }
+      break;
+    }
   }
 }
 
 void Model::attach(int stepidx)
 {
+  //Attach n'th timestep database if available, databases stay attached in a pool
+  //for re-use when returning to a step, least recently used detached when full
+  if (memorydb || stepidx < 0 || stepidx >= (int)timesteps.size()) return;
   int timestep = timesteps[stepidx]->step;
-  //Detach any attached db file
-  if (memorydb) return;
+  attached = 0;
+  prefix[0] = '\0';
+  if (timestep > 0 && attachStep(stepidx))
+  {
+    snprintf(prefix, sizeof(prefix), "t%d.", timestep);
+    attached = timestep;
+  }
+  //else
+  //   debug_print("Model %s not found, loading from current db\n", path.c_str());
+}
+
+bool Model::attachStep(int stepidx)
+{
+  //Add timestep database to attached pool, returns false if not available
+  int timestep = timesteps[stepidx]->step;
+  const std::string& path = timesteps[stepidx]->path;
+  if (path.length() == 0) return false;
+
+  //Already attached?
+  if (attachpool.count(timestep))
+  {
+    attachpool[timestep] = ++attachclock;
+    return true;
+  }
+
+  int limit = attachLimit();
+  while ((int)attachpool.size() >= limit)
+  {
+    //Detach least recently used, except current
+    int lru = -1;
+    for (auto it : attachpool)
+      if (it.first != attached && (lru < 0 || it.second < attachpool[lru])) lru = it.first;
+    if (lru < 0 || !detach(lru)) return false;
+  }
+
   char SQL[SQL_QUERY_MAX];
-  if (attached && attached != timestep)
+  sprintf(SQL, "attach database '%s' as t%d", path.c_str(), timestep);
+  if (!issue(SQL))
   {
-    sprintf(SQL, "detach database 't%d'", attached);
-    if (issue(SQL))
-    {
-      debug_print("Model t%d detached\n", attached);
-      attached = 0;
-      prefix[0] = '\0';
-    }
-    else
-      debug_print("Model t%d detach failed!\n", attached);
+    debug_print("Model %s found but attach failed!\n", path.c_str());
+    return false;
   }
+  attachpool[timestep] = ++attachclock;
+  debug_print("Model %s found and attached\n", path.c_str());
+  return true;
+}
 
-  //Attach n'th timestep database if available
-  if (timestep > 0 && !attached)
+int Model::attachLimit()
+{
+  //Pool size, limited by SQLite maximum attached databases
+  int limit = drawstate.global("attachpool");
+  int maxattach = sqlite3_limit(db, SQLITE_LIMIT_ATTACHED, -1);
+  if (limit > maxattach) limit = maxattach;
+  if (limit < 1) limit = 1;
+  return limit;
+}
+
+bool Model::detach(int timestep)
+{
+  //Cached statements on this database must be freed before detaching
+  char SQL[SQL_QUERY_MAX];
+  snprintf(SQL, sizeof(SQL), "t%d.", timestep);
+  clearQueries(SQL);
+  sprintf(SQL, "detach database 't%d'", timestep);
+  if (!issue(SQL))
   {
-    const std::string& path = timesteps[stepidx]->path;
-    if (path.length() > 0)
-    {
-      sprintf(SQL, "attach database '%s' as t%d", path.c_str(), timestep);
-      if (issue(SQL))
-      {
-        sprintf(prefix, "t%d.", timestep);
-        debug_print("Model %s found and attached\n", path.c_str());
-        attached = timestep;
-      }
-      else
-      {
-        debug_print("Model %s found but attach failed!\n", path.c_str());
-      }
-    }
-    //else
-    //   debug_print("Model %s not found, loading from current db\n", path.c_str());
+    debug_print("Model t%d detach failed!\n", timestep);
+    return false;
+  }
+  debug_print("Model t%d detached\n", timestep);
+  attachpool.erase(timestep);
+  if (attached == timestep)
+  {
+    attached = 0;
+    prefix[0] = '\0';
+  }
+  return true;
+}
+
+void Model::attachAhead()
+{
+  //Attach following timestep databases in advance of loading them
+  if (memorydb || !db || now < 0) return;
+  int ahead = drawstate.global("attachahead");
+  int limit = attachLimit();
+  if (ahead >= limit) ahead = limit - 1; //Leave room for current step
+  if (ahead <= 0) return;
+  char SQL[SQL_QUERY_MAX];
+  for (int idx=now+1; idx <= now + ahead && idx < (int)timesteps.size(); idx++)
+  {
+    int timestep = timesteps[idx]->step;
+    if (timestep <= 0 || attachpool.count(timestep)) continue;
+    if (!attachStep(idx)) continue;
+    //Read schema now rather than on first query
+    sprintf(SQL, "SELECT id FROM t%d.geometry LIMIT 0", timestep);
+    sqlite3_stmt* statement = select(SQL, true);
+    if (statement) sqlite3_finalize(statement);
   }
 }
 
 void Model::close()
 {
+  prefetchStop();
   for (unsigned int i=0; i < geometry.size(); i++)
     delete geometry[i];
   geometry.clear();
@@ -312,12 +431,13 @@ void Model::close()
 
 void Model::clearObjects(bool all)
 {
-  if (membytes__ > 0 && geometry.size() > 0)
-    debug_print("Clearing geometry, geom memory usage before clear %.3f mb\n", membytes__/1000000.0f);
+  if (DataArena::used > 0 && geometry.size() > 0)
+    debug_print("Clearing geometry, geom memory usage before clear %.3f mb\n", DataArena::used/1000000.0f);
 
   //Clear containers...
   for (unsigned int i=0; i < geometry.size(); i++)
     geometry[i]->clear(all);
+  newArena();
 }
 
 void Model::setup()
@@ -346,6 +466,23 @@ void Model::reload(DrawingObject* obj)
     colourMaps[i]->calibrated = false;
 }
 
+void Model::recolour(DrawingObject* obj)
+{
+  //Colour map change on selected object, data with colours mapped in the shaders is not reloaded
+  for (unsigned int i=0; i < geometry.size(); i++)
+    geometry[i]->recolourObject(obj);
+
+  for (unsigned int i = 0; i < colourMaps.size(); i++)
+    colourMaps[i]->calibrated = false;
+}
+
+void Model::refilter(DrawingObject* obj)
+{
+  //Filter change on selected object, data filtered in the shaders is not reloaded
+  for (unsigned int i=0; i < geometry.size(); i++)
+    geometry[i]->refilterObject(obj);
+}
+
 void Model::redraw(bool reload)
 {
   //Flag redraw on all objects...
@@ -422,13 +559,13 @@ void Model::loadWindows()
           max[i] = -FLT_MAX;
       }
 
-      drawstate.globals["caption"] = wtitle;
-      drawstate.globals["resolution"] = {width, height};
-      drawstate.globals["min"] = {min[0], min[1], min[2]};
-      drawstate.globals["max"] = {max[0], max[1], max[2]};
+      drawstate.setGlobal("caption", wtitle);
+      drawstate.setGlobal("resolution", {width, height});
+      drawstate.setGlobal("min", {min[0], min[1], min[2]});
+      drawstate.setGlobal("max", {max[0], max[1], max[2]});
       //Support legacy colour field
       if (colour.value != 0 && !drawstate.globals.count("colour"))
-        drawstate.globals["background"] = colour.toJson();
+        drawstate.setGlobal("background", colour.toJson());
 
       //Link the window viewports, objects & colourmaps
       loadLinks();
@@ -534,7 +671,7 @@ void Model::loadViewCamera(int viewport_id)
     v->rotate(rotate[0], rotate[1], rotate[2]);
     v->setScale(scale[0], scale[1], scale[2]);
     v->properties.parseSet(std::string(vprops));
-    v->properties["coordsystem"] = orientation;
+    v->properties.set("coordsystem", orientation);
     //debug_print("Loaded \"%s\" at %f,%f\n");
   }
   sqlite3_finalize(statement);
@@ -565,12 +702,12 @@ void Model::loadObjects()
     {
       Colour cobj;
       cobj.value = sqlite3_column_int(statement, 2);
-      if (cobj.value != 0 && !obj->properties.has("colour")) obj->properties.data["colour"] = cobj.toJson();
+      if (cobj.value != 0 && !obj->properties.has("colour")) obj->properties.set("colour", cobj.toJson());
     }
     if (sqlite3_column_type(statement, 2) != SQLITE_NULL)
     {
       float opacity = (float)sqlite3_column_double(statement, 3);
-      if (opacity > 0 && !obj->properties.has("opacity")) obj->properties.data["opacity"] = opacity;
+      if (opacity > 0 && !obj->properties.has("opacity")) obj->properties.set("opacity", opacity);
     }
 
     addObject(obj);
@@ -628,7 +765,7 @@ void Model::loadLinks()
         abort_program("Invalid colourmap id %d\n", colourmap_id);
       //Find colourmap by id == index
       //Add colourmap to drawing object
-      draw->properties.data["colourmap"] = colourmap_id-1;
+      draw->properties.set("colourmap", colourmap_id-1);
     }
   }
   sqlite3_finalize(statement);
@@ -660,7 +797,7 @@ void Model::loadLinks(DrawingObject* obj)
       if (colourMaps.size() < colourmap_id || !colourMaps[colourmap_id-1])
         abort_program("Invalid colourmap id %d\n", colourmap_id);
       //Add colourmap to drawing object by index
-      obj->properties.data["colourmap"] = colourmap_id-1;
+      obj->properties.set("colourmap", colourmap_id-1);
     }
   }
   sqlite3_finalize(statement);
@@ -668,6 +805,12 @@ void Model::loadLinks(DrawingObject* obj)
 
 void Model::clearTimeSteps()
 {
+  //Pending prefetch requests refer to existing steps
+  prefetchStop();
+  //Detach step databases
+  std::map<int, unsigned long> pool = attachpool;
+  for (auto it : pool)
+    detach(it.first);
   for (unsigned int idx=0; idx < timesteps.size(); idx++)
   {
     //Clear the store first to avoid deleting active (double free)
@@ -675,6 +818,8 @@ void Model::clearTimeSteps()
     delete timesteps[idx];
   }
   timesteps.clear();
+  deltabase.clear();
+  sharedPrune();
 }
 
 int Model::loadTimeSteps(bool scan)
@@ -746,6 +891,11 @@ int Model::loadTimeSteps(bool scan)
     debug_print("Scanning complete, found %d steps.\n", timesteps.size());
   }
 
+  //Index the database files found before any geometry is loaded
+  if (db) checkIndex(file.full);
+  for (unsigned int idx=0; idx < timesteps.size(); idx++)
+    if (timesteps[idx]->path.length() > 0) checkIndex(timesteps[idx]->path);
+
   //Copy to static for use in Tracers etc
   if (infostream) std::cerr << timesteps.size() << " timesteps loaded\n";
   drawstate.timesteps = timesteps;
@@ -760,6 +910,57 @@ void Model::loadFixed()
       geometry[i]->insertFixed(fixed[i]);
 }
 
+int Model::followTimeSteps()
+{
+  //Append any timesteps added since last check, keeps existing steps and cached data
+  //(only queries/checks for steps after the last known, cost does not grow with history)
+  if (!db || memorydb) return 0;
+  int added = 0;
+  int last = lastStep();
+
+  //New entries in timestep table
+  bool cached;
+  sqlite3_stmt* statement = query("SELECT id, time FROM timestep WHERE id > ?1 ORDER BY id", cached);
+  if (statement)
+  {
+    sqlite3_bind_int(statement, 1, last);
+    while (sqlite3_step(statement) == SQLITE_ROW)
+    {
+      int step = sqlite3_column_int(statement, 0);
+      double time = sqlite3_column_double(statement, 1);
+      addTimeStep(step, time, checkFileStep(step, basename, 3));
+      if (last >= 0 && step - last > drawstate.gap) drawstate.gap = step - last;
+      last = step;
+      added++;
+    }
+    if (cached) sqlite3_reset(statement); else sqlite3_finalize(statement);
+  }
+
+  //New timestep database files (without table entries), check up to next expected step
+  if (added == 0 && timesteps.size() > 0 && timesteps[timesteps.size()-1]->path.length() > 0)
+  {
+    int gap = drawstate.gap > 0 ? drawstate.gap : 1;
+    for (int ts = last+1; ts <= last + gap; ts++)
+    {
+      std::string path = checkFileStep(ts, basename);
+      if (path.length() == 0) continue;
+      addTimeStep(ts, 0.0, path);
+      added++;
+      break;
+    }
+  }
+
+  if (added)
+  {
+    debug_print("Follow: %d new timesteps, last step now %d\n", added, lastStep());
+    drawstate.timesteps = timesteps;
+    //Load ahead when current step is now followed by new steps
+    attachAhead();
+    prefetch();
+  }
+  return added;
+}
+
 std::string Model::checkFileStep(unsigned int ts, const std::string& basename, unsigned int limit)
 {
   int len = (ts == 0 ? 1 : (int)log10((float)ts) + 1);
@@ -878,15 +1079,15 @@ void Model::loadColourMapsLegacy()
 void Model::setColourMapProps(Properties& properties, float minimum, float maximum, bool logscale, bool discrete)
 {
   //These properties used to be database fields, convert
-  if (logscale) properties.data["logscale"] = true;
-  if (discrete) properties.data["discrete"] = true;
+  if (logscale) properties.set("logscale", true);
+  if (discrete) properties.set("discrete", true);
 
   //Set range if dynamic=0 or minimum/maximum values are not defaults
   float range = maximum - minimum;
   if ((properties.has("dynamic") && !properties["dynamic"]) ||
       (!properties.has("range") && range != 0.0 && range != 1.0))
   {
-    properties.data["range"] = {minimum, maximum};
+    properties.set("range", {minimum, maximum});
   }
 }
 
@@ -937,14 +1138,18 @@ void Model::freeze()
 void Model::deleteCache()
 {
   if (!drawstate.global("cache")) return;
+  //Free all cached steps, except current which may be in use
+  for (unsigned int idx=0; idx < timesteps.size(); idx++)
+    if ((int)idx != now) timesteps[idx]->clear();
   debug_print("~~~ Cache emptied\n");
-  //cache.clear();
 }
 
 void Model::cacheLoad()
 {
   for (unsigned int i=0; i<timesteps.size(); i++)
   {
+    //Stop when cache memory limit reached
+    if (i > 0 && cacheFull()) break;
     setTimeStep(i);
     if (drawstate.now != (int)i) break; //All cached in loadGeometry (doesn't work for split db timesteps so still need this loop)
     debug_print("Cached time %d : %d/%d (%s)\n", step(), i+1, timesteps.size(), file.base.c_str());
@@ -959,59 +1164,67 @@ void Model::cacheStep()
 {
   //Don't cache if we already loaded from cache or out of range!
   if (!drawstate.global("cache") || drawstate.now < 0 || (int)timesteps.size() <= drawstate.now) return;
-  if (timesteps[drawstate.now]->cache.size() > 0) return; //Already cached this step
+  if (timesteps[drawstate.now]->cache.size() > 0)
+  {
+    //Already cached this step, release containers so they are not re-used for next step
+    if (geometry == timesteps[drawstate.now]->cache)
+      geometry.clear();
+    else
+      //Loaded again, discard duplicate data
+      clearObjects();
+    return;
+  }
 
-  debug_print("~~~ Caching geometry @ %d (step %d : %s), geom memory usage: %.3f mb\n", step(), drawstate.now, file.base.c_str(), membytes__/1000000.0f);
+  debug_print("~~~ Caching geometry @ %d (step %d : %s), geom memory usage: %.3f mb\n", step(), drawstate.now, file.base.c_str(), DataArena::used/1000000.0f);
 
   //Copy all elements
-  if (membytes__ > 0)
+  if (DataArena::used > 0)
   {
     timesteps[drawstate.now]->write(geometry);
+    timesteps[drawstate.now]->used = ++cacheclock;
     debug_print("~~~ Cached step, at: %d\n", step());
     geometry.clear();
   }
   else
     debug_print("~~~ Nothing to cache\n");
 
-  //TODO: fix support for partial caching?
-  /*/Remove if over limit
-  if (cache.size() > GeomCache::size)
-  {
-     GeomCache* cached = cache.front();
-     cache.pop_front();
-     //Clear containers...
-     for (unsigned int i=0; i < cached->store.size(); i++)
-     {
-        cached->store[i]->clear(true);
-        delete cached->store[i];
-     }
-     debug_print("~~~ Deleted oldest cached step (%d)\n", cached->step);
-     delete cached;
-  }*/
+  //Remove least recently used steps if over limit
+  cacheEvict();
 }
 
 bool Model::restoreStep()
 {
   if (drawstate.now < 0 || !drawstate.global("cache")) return false;
-  if (timesteps[drawstate.now]->cache.size() == 0)
+  TimeStep* ts = timesteps[drawstate.now];
+  if (ts->cache.size() == 0)
+  {
+    cachemisses++;
     return false; //Nothing cached this step
+  }
 
-  //Load the cache and save loaded timestep
-  timesteps[drawstate.now]->read(geometry, !drawstate.global("gpucache"));
-  debug_print("~~~ Cache hit at ts %d (idx %d), loading! %s\n", step(), drawstate.now, file.base.c_str());
-
-  //Switch geometry containers
-  labels = geometry[lucLabelType];
-  points = (Points*)geometry[lucPointType];
-  vectors = (Vectors*)geometry[lucVectorType];
-  tracers = (Tracers*)geometry[lucTracerType];
-  quadSurfaces = (QuadSurfaces*)geometry[lucGridType];
-  volumes = (Volumes*)geometry[lucVolumeType];
-  triSurfaces = (TriSurfaces*)geometry[lucTriangleType];
-  lines = (Lines*)geometry[lucLineType];
-  shapes = (Shapes*)geometry[lucShapeType];
-
-  debug_print("~~~ Geom memory usage after load: %.3f mb\n", membytes__/1000000.0f);
+  {
+    //Swap containers while display is locked out
+    std::lock_guard<std::mutex> guard(drawstate.mutex);
+
+    //Load the cache and save loaded timestep
+    ts->read(geometry, !drawstate.global("gpucache"));
+    ts->used = ++cacheclock;
+    cachehits++;
+    debug_print("~~~ Cache hit at ts %d (idx %d), loading! %s\n", step(), drawstate.now, file.base.c_str());
+
+    //Switch geometry containers
+    labels = geometry[lucLabelType];
+    points = (Points*)geometry[lucPointType];
+    vectors = (Vectors*)geometry[lucVectorType];
+    tracers = (Tracers*)geometry[lucTracerType];
+    quadSurfaces = (QuadSurfaces*)geometry[lucGridType];
+    volumes = (Volumes*)geometry[lucVolumeType];
+    triSurfaces = (TriSurfaces*)geometry[lucTriangleType];
+    lines = (Lines*)geometry[lucLineType];
+    shapes = (Shapes*)geometry[lucShapeType];
+  }
+
+  debug_print("~~~ Geom memory usage after load: %.3f mb\n", DataArena::used/1000000.0f);
   //Redraw display
   redraw();
   return true;
@@ -1024,6 +1237,221 @@ void Model::printCache()
     debug_print(" %d: has %d records\n", idx, timesteps[idx]->cache.size());
 }
 
+long Model::cacheBytes()
+{
+  //Memory held by cached steps other than the one displayed (the steps that can be evicted)
+  long bytes = 0;
+  for (unsigned int idx=0; idx < timesteps.size(); idx++)
+    if (timesteps[idx]->cache != geometry) bytes += timesteps[idx]->bytes();
+  return bytes;
+}
+
+bool Model::cacheFull()
+{
+  //Check memory held by cached steps against cache limit (mb)
+  float cachesize = drawstate.global("cachesize");
+  return cachesize > 0 && cacheBytes() > cachesize * 1000000.0f;
+}
+
+void Model::cacheEvict()
+{
+  //Free least recently used steps until within cache limit
+  //(skips the step displayed and any pinned steps)
+  while (cacheFull())
+  {
+    int lru = -1;
+    for (unsigned int idx=0; idx < timesteps.size(); idx++)
+    {
+      TimeStep* ts = timesteps[idx];
+      if (ts->cache == geometry || ts->pinned || ts->cache.size() == 0) continue;
+      if (lru < 0 || ts->used < timesteps[lru]->used) lru = idx;
+    }
+    if (lru < 0) break; //Nothing left to free
+
+    timesteps[lru]->clear();
+    cacheevictions++;
+    debug_print("~~~ Evicted cached step %d (idx %d), cached memory: %.3f mb\n", timesteps[lru]->step, lru, cacheBytes()/1000000.0f);
+  }
+}
+
+void Model::cachePin(int stepidx, bool pin)
+{
+  //Pinned steps are never evicted from cache
+  if (stepidx < 0 || stepidx >= (int)timesteps.size()) return;
+  timesteps[stepidx]->pinned = pin;
+  if (!pin) cacheEvict();
+}
+
+void Model::prefetch()
+{
+  //Queue the steps following current for reading in the background
+  //(record data is read and decompressed ahead, geometry is always built on the main thread when loaded)
+  int depth = drawstate.global("prefetch");
+  if (depth <= 0 || now < 0 || !db || memorydb) return;
+
+  //Free any prefetched data no longer ahead of current
+  for (unsigned int idx=0; idx < timesteps.size(); idx++)
+    if ((int)idx <= now || (int)idx > now + depth) timesteps[idx]->records.clear();
+
+  std::lock_guard<std::mutex> guard(prefetchmutex);
+  prefetchdb = file.full;
+
+  //Replace any outstanding requests
+  for (unsigned int i=0; i < prefetchqueue.size(); i++)
+    delete prefetchqueue[i];
+  prefetchqueue.clear();
+
+  for (int idx=now+1; idx <= now + depth && idx < (int)timesteps.size(); idx++)
+  {
+    TimeStep* ts = timesteps[idx];
+    //Skip steps already cached, read or reading
+    bool loaded = ts->cache.size() > 0 || ts->records.size() > 0 || ts->step == prefetchbusy;
+    for (unsigned int i=0; i < prefetchready.size(); i++)
+      if (prefetchready[i]->step == ts->step) loaded = true;
+    if (loaded) continue;
+    prefetchqueue.push_back(new TimeStep(ts->step, ts->time, ts->path));
+  }
+
+  if (prefetchqueue.size() == 0) return;
+  if (!prefetcher.joinable())
+    prefetcher = std::thread(&Model::prefetchLoop, this);
+  prefetchcv.notify_one();
+}
+
+void Model::prefetchCollect()
+{
+  //Move any record data read in background to its timestep
+  std::deque<TimeStep*> ready;
+  {
+    std::lock_guard<std::mutex> guard(prefetchmutex);
+    ready.swap(prefetchready);
+  }
+
+  for (unsigned int i=0; i < ready.size(); i++)
+  {
+    for (unsigned int idx=0; idx < timesteps.size(); idx++)
+    {
+      TimeStep* ts = timesteps[idx];
+      if (ts->step != ready[i]->step) continue;
+      //Not needed if step was cached in the meantime
+      if (ts->cache.size() == 0 && ready[i]->records.size() > 0)
+      {
+        ts->records.swap(ready[i]->records);
+        prefetchloads++;
+        debug_print("~~~ Prefetched step %d (idx %d) collected\n", ts->step, idx);
+      }
+      break;
+    }
+    delete ready[i];
+  }
+}
+
+void Model::prefetchStop()
+{
+  //Stop the prefetch thread and discard any pending or read steps
+  if (prefetcher.joinable())
+  {
+    {
+      std::lock_guard<std::mutex> guard(prefetchmutex);
+      prefetchquit = true;
+    }
+    prefetchcv.notify_all();
+    prefetcher.join();
+    prefetchquit = false;
+  }
+
+  for (unsigned int i=0; i < prefetchqueue.size(); i++)
+    delete prefetchqueue[i];
+  for (unsigned int i=0; i < prefetchready.size(); i++)
+    delete prefetchready[i];
+  prefetchqueue.clear();
+  prefetchready.clear();
+}
+
+void Model::prefetchLoop()
+{
+  //Prefetch thread: read queued steps until stopped
+  std::unique_lock<std::mutex> lock(prefetchmutex);
+  while (true)
+  {
+    prefetchcv.wait(lock, [this] {return prefetchquit || prefetchqueue.size() > 0;});
+    if (prefetchquit) break;
+
+    TimeStep* ts = prefetchqueue.front();
+    prefetchqueue.pop_front();
+    prefetchbusy = ts->step;
+    std::string dbpath = prefetchdb;
+
+    lock.unlock();
+    prefetchRead(ts, dbpath);
+    lock.lock();
+
+    prefetchready.push_back(ts);
+    prefetchbusy = -1;
+  }
+}
+
+void Model::prefetchRead(TimeStep* ts, const std::string& dbpath)
+{
+  //Read the geometry record data of a step with a separate database connection and decompress it
+  //(runs on the prefetch thread, uses only the queued step and its own connection,
+  // must not touch any objects, properties or geometry shared with the main thread)
+  clock_t t1 = clock();
+  //Steps with their own database file hold only that step's geometry (see attach())
+  bool separate = ts->step > 0 && ts->path.length() > 0;
+  const std::string& path = separate ? ts->path : dbpath;
+  sqlite3* rdb = NULL;
+  if (sqlite3_open_v2(path.c_str(), &rdb, SQLITE_OPEN_READONLY, NULL) != SQLITE_OK)
+  {
+    debug_print("Prefetch can't open database %s: %s\n", path.c_str(), sqlite3_errmsg(rdb));
+    sqlite3_close(rdb);
+    return;
+  }
+  sqlite3_busy_timeout(rdb, 10000); //10 seconds
+
+  //Codec column not present in older databases, deflate used if size differs (see loadGeometry())
+  char SQL[SQL_QUERY_MAX];
+  sqlite3_stmt* statement = NULL;
+  for (const char* codec : {"codec", "NULL"})
+  {
+    sprintf(SQL, "SELECT id,data_type,count,%s,data FROM geometry%s", codec, separate ? "" : " WHERE timestep=?1");
+    if (sqlite3_prepare_v2(rdb, SQL, -1, &statement, NULL) == SQLITE_OK) break;
+    sqlite3_finalize(statement);
+    statement = NULL;
+  }
+  if (statement)
+  {
+    sqlite3_bind_int(statement, 1, ts->step);
+    unsigned long long bytes = 0;
+    int decoded = 0;
+    while (sqlite3_step(statement) == SQLITE_ROW)
+    {
+      PrefetchRecord& rec = ts->records[sqlite3_column_int64(statement, 0)];
+      lucGeometryDataType data_type = (lucGeometryDataType)sqlite3_column_int(statement, 1);
+      unsigned long len = (unsigned long)sqlite3_column_int(statement, 2) * GeomData::byteSize(data_type);
+      const unsigned char* data = (const unsigned char*)sqlite3_column_blob(statement, 4);
+      unsigned long size = sqlite3_column_bytes(statement, 4);
+      int codec = sqlite3_column_type(statement, 3) != SQLITE_NULL ? sqlite3_column_int(statement, 3) : -1;
+      if (codec < 0) codec = size != len ? lucCompressDeflate : lucCompressNone;
+      bytes += size;
+
+      //Decompress, except delta encoded records (need base from the previous step, decoded on load)
+      rec.decoded = false;
+      if (codec != lucCompressNone && !CODEC_DELTA(codec) && size > 0)
+      {
+        rec.data.resize(len);
+        rec.decoded = Codec::decode(codec, data, size, rec.data.data(), len, GeomData::byteSize(data_type));
+        if (rec.decoded) decoded++;
+      }
+      if (!rec.decoded)
+        rec.data.assign(data, data + size);
+    }
+    debug_print("~~~ Prefetched step %d, %d records (%d decompressed), %llu bytes, %.4lf seconds\n", ts->step, (int)ts->records.size(), decoded, bytes, (clock()-t1)/(double)CLOCKS_PER_SEC);
+  }
+  sqlite3_finalize(statement);
+  sqlite3_close(rdb);
+}
+
 //Set time step if available, otherwise return false and leave unchanged
 bool Model::hasTimeStep(int ts)
 {
@@ -1086,6 +1514,9 @@ int Model::setTimeStep(int stepidx)
   drawstate.now = now = stepidx;
   debug_print("TimeStep set to: %d (%d)\n", step(), stepidx);
 
+  //Pick up any steps loaded in background
+  prefetchCollect();
+
   if (!restoreStep())
   {
     //Create new geometry containers if required
@@ -1109,9 +1540,15 @@ int Model::setTimeStep(int stepidx)
       //Detach any attached db file and attach n'th timestep database if available
       attach(drawstate.now);
 
-      if (drawstate.global("cache"))
-        //Attempt caching all geometry from database at start
-        rows += loadGeometry(0, 0, timesteps[timesteps.size()-1]->step, true);
+      float cachesize = drawstate.global("cachesize");
+      if (drawstate.global("cache") && cachesize <= 0)
+      {
+        //Attempt caching all geometry from database at start (unless cache limited)
+        //(from first uncached step, so steps appended in follow mode don't reload all)
+        int uncached = 0;
+        while (uncached < now && timesteps[uncached]->cache.size() > 0) uncached++;
+        rows += loadGeometry(0, timesteps[uncached]->step, timesteps[timesteps.size()-1]->step, true);
+      }
       else
         rows += loadGeometry();
 
@@ -1119,6 +1556,13 @@ int Model::setTimeStep(int stepidx)
     }
   }
 
+  //Release shared data no longer used by any step
+  sharedPrune();
+
+  //Start loading following steps
+  attachAhead();
+  prefetch();
+
   return rows;
 }
 
@@ -1130,20 +1574,33 @@ int Model::loadGeometry(int obj_id, int time_start, int time_stop, bool recurseT
     return 0;
   }
   clock_t t1 = clock();
+  auto t0 = std::chrono::steady_clock::now();
+  double nested = querytime + decodetime; //To exclude recursive loads from timing
 
   //Default to current timestep
   if (time_start < 0) time_start = step();
   if (time_stop < 0) time_stop = step();
 
+  //Database name for blob access
+  char dbname[sizeof(prefix)] = "main";
+  if (strlen(prefix) > 0)
+  {
+    snprintf(dbname, sizeof(dbname), "%s", prefix);
+    dbname[strlen(dbname)-1] = '\0'; //Strip "."
+  }
+
+  //Delta bases kept from a previous load only if this step follows it
+  if (recurseTracers) deltaPrune();
+
   //Load geometry
   char SQL[SQL_QUERY_MAX];
-  char filter[256] = {'\0'};
+  char filter[512] = {'\0'};
   char objfilter[32] = {'\0'};
 
-  //Setup filters, object...
+  //Setup filters (as parameters, so statements can be re-used) object...
   if (obj_id > 0)
   {
-    sprintf(objfilter, "WHERE object_id=%d", obj_id);
+    strcpy(objfilter, "WHERE object_id=?1");
     //Remove the skip flag now we have explicitly loaded object
     DrawingObject* obj = findObject(obj_id);
     if (obj) obj->skip = false;
@@ -1153,28 +1610,55 @@ int Model::loadGeometry(int obj_id, int time_start, int time_stop, bool recurseT
   if (time_start >= 0 && time_stop >= 0 && !attached)
   {
     if (strlen(objfilter) > 0)
-      sprintf(filter, "%s AND timestep BETWEEN %d AND %d", objfilter, time_start, time_stop);
+      sprintf(filter, "%s AND timestep BETWEEN ?2 AND ?3", objfilter);
     else
-      sprintf(filter, " WHERE timestep BETWEEN %d AND %d", time_start, time_stop);
+      sprintf(filter, " WHERE timestep BETWEEN ?2 AND ?3");
   }
   else
     strcpy(filter, objfilter);
 
+  //...region (records with bounds intersecting box, using spatial index)
+  json region = drawstate.global("region");
+  bool regional = region.size() == 6 && hasRTree(dbname);
+  if (regional)
+  {
+    strcat(filter, strlen(filter) > 0 ? " AND" : " WHERE");
+    sprintf(filter + strlen(filter), " id IN (SELECT id FROM %sgeometry_rtree WHERE maxX >= ?4 AND minX <= ?7 AND maxY >= ?5 AND minY <= ?8 AND maxZ >= ?6 AND minZ <= ?9)", prefix);
+  }
+
+  //Direct load: data column replaced by its length, blob content read straight into the
+  //data store with incremental blob i/o (or decompressed directly into it), avoiding
+  //any intermediate buffer and the copy into growing data arrays
+  //(also used for steps with record data read ahead by the prefetch thread, taken from there instead)
+  std::map<long long, PrefetchRecord>* fetched = NULL;
+  if (now >= 0 && time_start == step() && time_stop == step() && timesteps[now]->records.size() > 0)
+    fetched = &timesteps[now]->records;
+  bool direct = drawstate.global("directload") || fetched;
+  const char* idcol = direct ? "rowid" : "id";
+  const char* datasel = direct ? "length(data)" : "data";
   int datacol = 21;
+  bool extended = true;
+  //Optional columns (chunk series, codec id, delta base record and duplicated record), NULL where not present
+  std::string extcols;
+  const char* optional[] = {"chunk", "codec", "base", "ref"};
+  for (auto col : optional)
+    extcols += std::string(",") + (hasColumn(dbname, col) ? col : "NULL");
   //object (id, name, colourmap_id, colour, opacity, wireframe, cullface, scaling, lineWidth, arrowHead, flat, steps, time)
   //geometry (id, object_id, timestep, rank, idx, type, data_type, size, count, width, minimum, maximum, dim_factor, units, labels,
-  //minX, minY, minZ, maxX, maxY, maxZ, data)
-  sprintf(SQL, "SELECT id,object_id,timestep,rank,idx,type,data_type,size,count,width,minimum,maximum,dim_factor,units,labels,minX,minY,minZ,maxX,maxY,maxZ,data FROM %sgeometry %s ORDER BY timestep,object_id,idx,rank", prefix, filter);
-  sqlite3_stmt* statement = select(SQL, true);
+  //minX, minY, minZ, maxX, maxY, maxZ, data, chunk, codec, base, ref)
+  sprintf(SQL, "SELECT %s,object_id,timestep,rank,idx,type,data_type,size,count,width,minimum,maximum,dim_factor,units,labels,minX,minY,minZ,maxX,maxY,maxZ,%s%s FROM %sgeometry %s ORDER BY timestep,object_id,idx,rank,id", idcol, datasel, extcols.c_str(), prefix, filter);
+  bool cached = true;
+  sqlite3_stmt* statement = query(SQL, cached);
 
   //Old database compatibility
   if (statement == NULL)
   {
     //object (id, name, colourmap_id, colour, opacity, wireframe, cullface, scaling, lineWidth, arrowHead, flat, steps, time)
     //geometry (id, object_id, timestep, rank, idx, type, data_type, size, count, width, minimum, maximum, dim_factor, units, data)
-    sprintf(SQL, "SELECT id,object_id,timestep,rank,idx,type,data_type,size,count,width,minimum,maximum,dim_factor,units,labels,data FROM %sgeometry %s ORDER BY timestep,object_id,idx,rank", prefix, filter);
-    statement = select(SQL, true);
+    sprintf(SQL, "SELECT %s,object_id,timestep,rank,idx,type,data_type,size,count,width,minimum,maximum,dim_factor,units,labels,%s FROM %sgeometry %s ORDER BY timestep,object_id,idx,rank,id", idcol, datasel, prefix, filter);
+    statement = query(SQL, cached);
     datacol = 15;
+    extended = false;
 
     //Fix
 #ifdef ALTER_DB
@@ -1190,19 +1674,35 @@ int Model::loadGeometry(int obj_id, int time_start, int time_stop, bool recurseT
   //Very old database compatibility
   if (statement == NULL)
   {
-    sprintf(SQL, "SELECT id,object_id,timestep,rank,idx,type,data_type,size,count,width,minimum,maximum,dim_factor,units,data FROM %sgeometry %s ORDER BY timestep,object_id,idx,rank", prefix, filter);
-    statement = select(SQL);
+    sprintf(SQL, "SELECT %s,object_id,timestep,rank,idx,type,data_type,size,count,width,minimum,maximum,dim_factor,units,%s FROM %sgeometry %s ORDER BY timestep,object_id,idx,rank,id", idcol, datasel, prefix, filter);
+    statement = query(SQL, cached);
     datacol = 14;
+    extended = false;
+    if (!statement) select(SQL); //Report error
   }
 
   if (!statement) return 0;
+  //Parameters not used in filter are ignored
+  sqlite3_bind_int(statement, 1, obj_id);
+  sqlite3_bind_int(statement, 2, time_start);
+  sqlite3_bind_int(statement, 3, time_stop);
+  if (regional)
+    for (int i=0; i<6; i++)
+      sqlite3_bind_double(statement, 4+i, region[i]);
+
   int rows = 0;
   int tbytes = 0;
   int ret;
   Geometry* active = NULL;
+  sqlite3_int64 chunkid = 0; //Chunk series being loaded
+  sqlite3_blob* blob = NULL;
+  double qtime = 0; //Time spent in database queries
+  auto tq = std::chrono::steady_clock::now();
   do
   {
+    tq = std::chrono::steady_clock::now();
     ret = sqlite3_step(statement);
+    qtime += std::chrono::duration<double>(std::chrono::steady_clock::now() - tq).count();
     if (ret == SQLITE_ROW)
     {
       rows++;
@@ -1224,8 +1724,18 @@ int Model::loadGeometry(int obj_id, int time_start, int time_stop, bool recurseT
       //const char *units = (const char*)sqlite3_column_text(statement, 13);
       const char *labels = datacol < 15 ? "" : (const char*)sqlite3_column_text(statement, 14);
 
-      const void *data = sqlite3_column_blob(statement, datacol);
-      unsigned int bytes = sqlite3_column_bytes(statement, datacol);
+      const void *data = NULL;
+      unsigned int bytes;
+      if (direct)
+        bytes = sqlite3_column_int(statement, datacol);
+      else
+      {
+        data = sqlite3_column_blob(statement, datacol);
+        bytes = sqlite3_column_bytes(statement, datacol);
+      }
+
+      //Record is a chunk of a larger series?
+      sqlite3_int64 chunk = extended ? sqlite3_column_int64(statement, datacol+1) : 0;
 
       DrawingObject* obj = findObject(object_id);
 
@@ -1237,6 +1747,9 @@ int Model::loadGeometry(int obj_id, int time_start, int time_stop, bool recurseT
       // - disabled when using attached databases (cached in loop via cacheLoad())
       if (recurseTracers && step() != timestep && !attached)
       {
+        //Complete loading previous step before caching
+        inflateRecords();
+        compactGeometry();
         cacheStep();
         drawstate.now = now = nearestTimeStep(timestep);
         debug_print("TimeStep set to: %d, rows %d\n", step(), rows);
@@ -1273,78 +1786,259 @@ int Model::loadGeometry(int obj_id, int time_start, int time_stop, bool recurseT
       }
       else
       {
-        unsigned char* buffer = NULL;
-        if (bytes != (unsigned int)(count * GeomData::byteSize(data_type)))
-        {
-          //Decompress!
-          unsigned long dst_len = (unsigned long)(count * GeomData::byteSize(data_type));
-          unsigned long uncomp_len = dst_len;
-          unsigned long cmp_len = bytes;
-          buffer = new unsigned char[dst_len];
-          if (!buffer)
-            abort_program("Out of memory!\n");
-
-#ifdef USE_ZLIB
-          int res = uncompress(buffer, &uncomp_len, (const unsigned char *)data, cmp_len);
-          if (res != Z_OK || dst_len != uncomp_len)
-#else
-          int res = tinfl_decompress_mem_to_mem(buffer, uncomp_len, (const unsigned char *)data, cmp_len, TINFL_FLAG_PARSE_ZLIB_HEADER);
-          if (!res)
-#endif
-          {
-            abort_program("uncompress() failed! error code %d\n", res);
-            //abort_program("uncompress() failed! error code %d expected size %d actual size %d\n", res, dst_len, uncomp_len);
-          }
-          data = buffer; //Replace data pointer
-          bytes = uncomp_len;
-        }
-
-        tbytes += bytes;   //Byte counter
-
-        //Always add a new element for each new vertex geometry record, not suitable if writing db on multiple procs!
-        if (data_type == lucVertexData && recurseTracers) active->add(obj);
-
-        //Read data block
-        GeomData* g;
         //Convert legacy value types to use data labels
         //TODO: allow label set in database (via property on geometry record?)
+        const char* label = NULL;
         switch (data_type)
         {
           case lucColourValueData:
-            g = active->read(obj, items, data, "colours");
+            label = "colours";
             break;
           case lucOpacityValueData:
-            g = active->read(obj, items, data, "opacities");
+            label = "opacities";
             break;
           case lucRedValueData:
-            g = active->read(obj, items, data, "red");
+            label = "red";
             break;
           case lucGreenValueData:
-            g = active->read(obj, items, data, "green");
+            label = "green";
             break;
           case lucBlueValueData:
-            g = active->read(obj, items, data, "blue");
+            label = "blue";
             break;
           case lucXWidthData:
-            g = active->read(obj, items, data, "widths");
+            label = "widths";
             break;
           case lucYHeightData:
-            g = active->read(obj, items, data, "heights");
+            label = "heights";
             break;
           case lucZLengthData:
-            g = active->read(obj, items, data, "lengths");
+            label = "lengths";
             break;
           case lucSizeData:
-            g = active->read(obj, items, data, "sizes");
+            label = "sizes";
             break;
           case lucMaxDataType:
-            g = active->read(obj, items, data, "values");
+            label = "values";
             break;
           default:
             //Non-value data
+            break;
+        }
+
+        //Codec recorded per record, older databases compressed with deflate if size differs
+        unsigned long dst_len = (unsigned long)(count * GeomData::byteSize(data_type));
+        int codec = extended && sqlite3_column_type(statement, datacol+2) != SQLITE_NULL ? sqlite3_column_int(statement, datacol+2) : -1;
+        if (codec < 0) codec = bytes != dst_len ? lucCompressDeflate : lucCompressNone;
+        bool compressed = codec != lucCompressNone;
+
+        //Delta encoded against record of previous step, get decoded base data
+        sqlite3_int64 recid = sqlite3_column_int64(statement, 0);
+        sqlite3_int64 baseid = extended ? sqlite3_column_int64(statement, datacol+3) : 0;
+        std::shared_ptr<std::vector<unsigned char> > base;
+        if (CODEC_DELTA(codec))
+        {
+          base = deltaBase(baseid);
+          if (!base || base->size() != dst_len)
+            abort_program("Delta base record %lld not found or invalid for geometry record %lld\n", (long long)baseid, (long long)recid);
+        }
+        //Duplicate of another record's data, shares its decoded data
+        sqlite3_int64 refid = extended ? sqlite3_column_int64(statement, datacol+4) : 0;
+        std::shared_ptr<DataContainer> shared;
+        if (refid)
+        {
+          shared = sharedBlock(dbname, refid);
+          if (!shared || shared->bytes() != dst_len)
+          {
+            std::cerr << "Shared data record not found for geometry record " << recid << std::endl;
+            continue;
+          }
+        }
+        readbytes += bytes;
+        GeomData* g;
+        if (shared)
+        {
+          //Always add a new element for each new vertex geometry record (except following chunks)
+          if (data_type == lucVertexData && recurseTracers && (!chunk || chunk != chunkid)) active->add(obj);
+
+          //Appending a copy may move the store's data, wait for records decompressing into it
+          if (inflatepending.size())
+          {
+            DataContainer* store = label ? active->reserveStore(obj, label, g) : active->reserveStore(obj, 0, data_type, g, width, height, depth);
+            inflateWait(store, shared->count());
+          }
+
+          if (label)
+            g = active->share(obj, shared.get(), label);
+          else
+            g = active->share(obj, shared.get(), data_type, width, height, depth);
+          loadshared++;
+
+          //Single vertex, apply bounds
+          if (data_type == lucVertexData && items == 1 && type != lucLabelType)
+          {
+            float vertex[3];
+            ((FloatValues*)shared.get())->decode(0, 3, vertex);
+            g->checkPointMinMax(vertex);
+          }
+        }
+        else if (direct)
+        {
+          //Prefetched record data? (already decompressed unless delta encoded)
+          std::vector<unsigned char>* record = NULL;
+          bool decoded = false;
+          if (fetched)
+          {
+            auto it = fetched->find(recid);
+            if (it != fetched->end() && it->second.data.size() == (it->second.decoded ? dst_len : bytes))
+            {
+              record = &it->second.data;
+              decoded = it->second.decoded;
+            }
+          }
+
+          //Otherwise open blob handle on this record, re-use for following records
+          int res = SQLITE_OK;
+          if (!record)
+          {
+            tq = std::chrono::steady_clock::now();
+            res = blob ? sqlite3_blob_reopen(blob, recid) : sqlite3_blob_open(db, dbname, "geometry", "data", recid, 0, &blob);
+            qtime += std::chrono::duration<double>(std::chrono::steady_clock::now() - tq).count();
+          }
+          if (res != SQLITE_OK)
+          {
+            std::cerr << "Database blob read failed: " << sqlite3_errmsg(db) << std::endl;
+            if (blob) sqlite3_blob_close(blob);
+            blob = NULL;
+            continue;
+          }
+
+          //Always add a new element for each new vertex geometry record, not suitable if writing db on multiple procs!
+          //(except following chunks of a series, appended to the same element)
+          if (data_type == lucVertexData && recurseTracers && (!chunk || chunk != chunkid)) active->add(obj);
+
+          //Get destination in data store, pre-sized from record count
+          //(growing the store moves its data, first wait for any records decompressing into it)
+          DataContainer* store;
+          if (label)
+            store = active->reserveStore(obj, label, g);
+          else
+            store = active->reserveStore(obj, items, data_type, g, width, height, depth);
+          inflateWait(store, items);
+          void* dest = store->append(items);
+
+          bool single = data_type == lucVertexData && items == 1 && type != lucLabelType;
+          if (dest && compressed && !decoded)
+          {
+            //Read compressed data and queue for decompression on worker threads straight into
+            //the data store while reading continues
+            inflatequeue.push_back(LoadRecord());
+            LoadRecord& rec = inflatequeue.back();
+            rec.store = store;
+            rec.dest = (unsigned char*)dest;
+            rec.length = dst_len;
+            rec.codec = codec;
+            rec.typesize = GeomData::byteSize(data_type);
+            rec.id = recid;
+            rec.baseid = baseid;
+            rec.base = base;
+            rec.step = timestep;
+            rec.bounds = single ? g : NULL;
+            if (record)
+            {
+              //(copied from blob by the prefetch thread)
+              rec.data.swap(*record);
+            }
+            else
+            {
+              rec.data.resize(bytes);
+              tq = std::chrono::steady_clock::now();
+              res = sqlite3_blob_read(blob, &rec.data[0], bytes, 0);
+              qtime += std::chrono::duration<double>(std::chrono::steady_clock::now() - tq).count();
+            }
+            loadcopies++;
+            if (res != SQLITE_OK)
+            {
+              //Don't decode unread data, store left zeroed
+              std::cerr << "Database blob read failed for geometry record " << recid << ": " << sqlite3_errmsg(db) << std::endl;
+              inflatequeue.pop_back();
+              memset(dest, 0, dst_len);
+            }
+            else
+              inflatePush(&rec);
+          }
+          else if (dest)
+          {
+            //Read directly into data store
+            if (record)
+            {
+              //(copied from blob and decompressed by the prefetch thread, then into the store)
+              memcpy(dest, record->data(), record->size());
+              loadcopies += decoded ? 3 : 2;
+              if (decoded && (codec & CODEC_KEYFRAME))
+                deltaKeep(recid, timestep, std::make_shared<std::vector<unsigned char> >(record->begin(), record->end()));
+            }
+            else
+            {
+              tq = std::chrono::steady_clock::now();
+              res = sqlite3_blob_read(blob, dest, bytes, 0);
+              qtime += std::chrono::duration<double>(std::chrono::steady_clock::now() - tq).count();
+            }
+            if (res != SQLITE_OK)
+            {
+              std::cerr << "Database blob read failed for geometry record " << recid << ": " << sqlite3_errmsg(db) << std::endl;
+              memset(dest, 0, dst_len);
+            }
+            loadcopies++;
+
+            //Single vertex, apply bounds
+            if (single) g->checkPointMinMax((float*)dest);
+          }
+        }
+        else
+        {
+          unsigned char* buffer = NULL;
+          if (compressed)
+          {
+            //Decompress!
+            buffer = new unsigned char[dst_len];
+            if (!buffer)
+              abort_program("Out of memory!\n");
+
+            if (!Codec::decode(codec, (const unsigned char *)data, bytes, buffer, dst_len, GeomData::byteSize(data_type)))
+              abort_program("Geometry record decode failed! codec %s\n", Codec::name(codec).c_str());
+
+            //Apply delta, keep decoded data if base for next step
+            if (base)
+            {
+              Codec::undelta(CODEC_DELTA(codec), buffer, base->data(), dst_len);
+              deltabase.erase(baseid);
+            }
+            if (CODEC_DELTA(codec) || (codec & CODEC_KEYFRAME))
+              deltaKeep(recid, timestep, std::make_shared<std::vector<unsigned char> >(buffer, buffer + dst_len));
+            data = buffer; //Replace data pointer
+            loadcopies++;
+          }
+
+          //Always add a new element for each new vertex geometry record, not suitable if writing db on multiple procs!
+          //(except following chunks of a series, appended to the same element)
+          if (data_type == lucVertexData && recurseTracers && (!chunk || chunk != chunkid)) active->add(obj);
+
+          //Read data block
+          if (label)
+            g = active->read(obj, items, data, label);
+          else
             g = active->read(obj, items, data_type, data, width, height, depth);
+          loadcopies++;
+
+          if (buffer) delete[] buffer;
         }
 
+        if (data_type == lucVertexData) chunkid = chunk;
+        tbytes += dst_len;   //Byte counter
+        loadbytes += dst_len;
+        loadrecords++;
+
         //Set geom labels if any
         if (labels) active->label(obj, labels);
 
@@ -1368,8 +2062,6 @@ int Model::loadGeometry(int obj_id, int time_start, int time_stop, bool recurseT
             g->checkPointMinMax(max);
           }
         }
-
-        if (buffer) delete[] buffer;
       }
     }
     else if (ret != SQLITE_DONE)
@@ -1377,24 +2069,461 @@ int Model::loadGeometry(int obj_id, int time_start, int time_stop, bool recurseT
   }
   while (ret == SQLITE_ROW);
 
-  sqlite3_finalize(statement);
-  debug_print("... loaded %d rows, %d bytes, %.4lf seconds\n", rows, tbytes, (clock()-t1)/(double)CLOCKS_PER_SEC);
+  //Decompress queued records
+  inflateRecords();
+  compactGeometry();
+
+  if (blob) sqlite3_blob_close(blob);
+  //Prefetched data used, free the rest
+  if (fetched) fetched->clear();
+  if (cached)
+    sqlite3_reset(statement);
+  else
+    sqlite3_finalize(statement);
+
+  //Query time (stepping statement, blob i/o) reported separately to decode time (decompress, data stores)
+  double total = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+  nested = querytime + decodetime - nested;
+  double dtime = total - qtime - nested;
+  querytime += qtime;
+  decodetime += dtime;
+  debug_print("... loaded %d rows, %d bytes, %.4lf seconds, query %.4lf decode %.4lf (total records %lu, copies %lu)\n", rows, tbytes, (clock()-t1)/(double)CLOCKS_PER_SEC, qtime, dtime, loadrecords, loadcopies);
 
   return rows;
 }
 
+sqlite3_stmt* Model::query(const char* SQL, bool& cached)
+{
+  //Get prepared statement for query, re-using any cached statement with same SQL
+  //(a new statement is returned uncached if the cached one is still in use, eg: recursive loads,
+  // cached by prefix of the database queried so detaching one frees only its statements)
+  sqlite3_stmt* statement = NULL;
+  std::string key = SQL;
+  std::map<std::string, sqlite3_stmt*>& cache = queries[prefix];
+  cached = true;
+  if (cache.count(key))
+  {
+    statement = cache[key];
+    if (!sqlite3_stmt_busy(statement))
+    {
+      sqlite3_clear_bindings(statement);
+      return statement;
+    }
+    cached = false;
+  }
+
+  statement = select(SQL, true);
+  if (statement && cached) cache[key] = statement;
+  return statement;
+}
+
+void Model::clearQueries(const char* dbprefix)
+{
+  //Free cached statements, required before closing or detaching database
+  //(all, or only those of the attached database with given prefix)
+  for (auto it = queries.begin(); it != queries.end(); )
+  {
+    if (dbprefix && it->first != dbprefix)
+    {
+      ++it;
+      continue;
+    }
+    for (auto q : it->second)
+      sqlite3_finalize(q.second);
+    it = queries.erase(it);
+  }
+}
+
+bool Model::hasRTree(const char* dbname)
+{
+  //Check for spatial index on geometry records, once per database file
+  const char* filename = sqlite3_db_filename(db, dbname);
+  std::string key = filename && strlen(filename) ? filename : dbname;
+  if (rtrees.count(key) == 0)
+  {
+    char SQL[SQL_QUERY_MAX];
+    sprintf(SQL, "SELECT name FROM %s.sqlite_master WHERE type='table' AND name='geometry_rtree'", dbname);
+    sqlite3_stmt* statement = select(SQL, true);
+    rtrees[key] = statement && sqlite3_step(statement) == SQLITE_ROW;
+    sqlite3_finalize(statement);
+    if (!rtrees[key])
+      debug_print("No spatial index found in %s, region ignored\n", key.c_str());
+  }
+  return rtrees[key];
+}
+
+bool Model::hasColumn(const char* dbname, const char* column)
+{
+  //Check for optional geometry table column, columns read once per database file
+  const char* filename = sqlite3_db_filename(db, dbname);
+  std::string key = filename && strlen(filename) ? filename : dbname;
+  if (geomcolumns.count(key) == 0)
+  {
+    char SQL[SQL_QUERY_MAX];
+    sprintf(SQL, "PRAGMA %s.table_info(geometry)", dbname);
+    sqlite3_stmt* statement = select(SQL, true);
+    std::set<std::string>& columns = geomcolumns[key];
+    while (statement && sqlite3_step(statement) == SQLITE_ROW)
+      columns.insert((const char*)sqlite3_column_text(statement, 1));
+    sqlite3_finalize(statement);
+  }
+  return geomcolumns[key].count(column) > 0;
+}
+
+std::shared_ptr<std::vector<unsigned char> > Model::deltaBase(sqlite3_int64 id)
+{
+  //Decoded data of delta base record, re-used from previous step if loaded
+  //in sequence, otherwise decoded from the series back to the keyframe
+  if (id <= 0) return NULL;
+  auto it = deltabase.find(id);
+  if (it != deltabase.end()) return it->second.data;
+
+  char SQL[SQL_QUERY_MAX];
+  sprintf(SQL, "SELECT data_type,count,codec,base,data FROM %sgeometry WHERE id=?1", prefix);
+  bool cached;
+  sqlite3_stmt* statement = query(SQL, cached);
+  if (!statement) return NULL;
+  sqlite3_bind_int64(statement, 1, id);
+  if (sqlite3_step(statement) != SQLITE_ROW)
+  {
+    if (cached) sqlite3_reset(statement); else sqlite3_finalize(statement);
+    return NULL;
+  }
+  lucGeometryDataType data_type = (lucGeometryDataType)sqlite3_column_int(statement, 0);
+  unsigned long len = sqlite3_column_int(statement, 1) * GeomData::byteSize(data_type);
+  int codec = sqlite3_column_int(statement, 2);
+  sqlite3_int64 baseid = sqlite3_column_int64(statement, 3);
+  const unsigned char* data = (const unsigned char*)sqlite3_column_blob(statement, 4);
+  std::vector<unsigned char> encoded(data, data + sqlite3_column_bytes(statement, 4));
+  if (cached) sqlite3_reset(statement); else sqlite3_finalize(statement);
+
+  std::shared_ptr<std::vector<unsigned char> > decoded = std::make_shared<std::vector<unsigned char> >(len);
+  if (!Codec::decode(codec, encoded.data(), encoded.size(), decoded->data(), len, GeomData::byteSize(data_type)))
+    return NULL;
+  if (CODEC_DELTA(codec))
+  {
+    std::shared_ptr<std::vector<unsigned char> > base = deltaBase(baseid);
+    if (!base || base->size() != len) return NULL;
+    Codec::undelta(CODEC_DELTA(codec), decoded->data(), base->data(), len);
+  }
+  //Intermediate records of the series are not kept, only needed for this base
+  debug_print("Delta base record %lld decoded\n", (long long)id);
+  return decoded;
+}
+
+void Model::deltaKeep(sqlite3_int64 id, int step, const std::shared_ptr<std::vector<unsigned char> >& data)
+{
+  //Keep copy of decoded data of a loaded delta series record as base for the following step
+  BaseRecord& base = deltabase[id];
+  base.step = step;
+  base.data = data;
+  loadcopies++;
+}
+
+void Model::deltaPrune()
+{
+  //Drop delta bases not from the step before current, their dependants won't be loaded next
+  //(queued records hold their own reference to any base in use)
+  int prev = now > 0 && now <= (int)timesteps.size() ? timesteps[now-1]->step : -1;
+  for (auto it = deltabase.begin(); it != deltabase.end(); )
+  {
+    if (it->second.step == prev)
+      ++it;
+    else
+      it = deltabase.erase(it);
+  }
+}
+
+std::shared_ptr<DataContainer> Model::sharedBlock(const char* dbname, sqlite3_int64 id)
+{
+  //Decoded data of a record referenced by duplicates, loaded once and then
+  //shared by the data stores of every step referencing it
+  const char* filename = sqlite3_db_filename(db, dbname);
+  auto key = std::make_pair(std::string(filename && strlen(filename) ? filename : dbname), id);
+  {
+    std::lock_guard<std::mutex> guard(sharedblocks->mutex);
+    auto it = sharedblocks->blocks.find(key);
+    if (it != sharedblocks->blocks.end()) return it->second;
+  }
+
+  char SQL[SQL_QUERY_MAX];
+  sprintf(SQL, "SELECT data_type,count,codec,data FROM %sgeometry WHERE id=?1", prefix);
+  bool cached;
+  sqlite3_stmt* statement = query(SQL, cached);
+  if (!statement) return NULL;
+  sqlite3_bind_int64(statement, 1, id);
+  std::shared_ptr<DataContainer> block;
+  if (sqlite3_step(statement) == SQLITE_ROW)
+  {
+    lucGeometryDataType data_type = (lucGeometryDataType)sqlite3_column_int(statement, 0);
+    unsigned int count = sqlite3_column_int(statement, 1);
+    int codec = sqlite3_column_type(statement, 2) != SQLITE_NULL ? sqlite3_column_int(statement, 2) : lucCompressNone;
+    const unsigned char* data = (const unsigned char*)sqlite3_column_blob(statement, 3);
+    unsigned long bytes = sqlite3_column_bytes(statement, 3);
+    unsigned long len = count * GeomData::byteSize(data_type);
+
+    //Store of same element type as the records' data stores
+    if (data_type == lucIndexData || data_type == lucRGBAData)
+      block = std::make_shared<UIntValues>();
+    else if (data_type == lucLuminanceData || data_type == lucRGBData)
+      block = std::make_shared<UCharValues>();
+    else
+      block = std::make_shared<FloatValues>();
+
+    //Referenced records are never delta encoded
+    unsigned char* dest = (unsigned char*)block->append(count);
+    if (CODEC_DELTA(codec) || !dest || !Codec::decode(codec, data, bytes, dest, len, GeomData::byteSize(data_type)))
+      block = NULL;
+  }
+  if (cached) sqlite3_reset(statement); else sqlite3_finalize(statement);
+  if (!block) return NULL;
+
+  //(another loader may have added it meanwhile, use the existing data)
+  debug_print("Shared data record %lld decoded\n", (long long)id);
+  std::lock_guard<std::mutex> guard(sharedblocks->mutex);
+  auto it = sharedblocks->blocks.insert(std::make_pair(key, block));
+  return it.first->second;
+}
+
+void Model::sharedPrune()
+{
+  //Release shared data no longer used by any data store
+  std::lock_guard<std::mutex> guard(sharedblocks->mutex);
+  for (auto it = sharedblocks->blocks.begin(); it != sharedblocks->blocks.end(); )
+  {
+    if (it->second->shared())
+      ++it;
+    else
+      it = sharedblocks->blocks.erase(it);
+  }
+}
+
+void Model::reloadStep()
+{
+  //Reload current step from database (eg: after load filters changed),
+  //other cached steps are discarded
+  if (now < 0 || !db) return;
+  prefetchStop();
+  for (unsigned int idx=0; idx < timesteps.size(); idx++)
+    if ((int)idx != now) timesteps[idx]->clear();
+  clearObjects();
+  loadFixed();
+  attach(now);
+  loadGeometry();
+  redraw(true);
+  prefetch();
+}
+
+void Model::checkIndex(const std::string& path)
+{
+  //Check for index on geometry (timestep, object_id) once per database file, create if "dbindex" set
+  //(when the file is opened, with a separate connection, so loading never has to reopen the database)
+  if (memorydb || !drawstate.global("dbindex") || indexchecked.count(path)) return;
+  indexchecked.insert(path);
+
+  sqlite3* idb;
+  if (sqlite3_open_v2(path.c_str(), &idb, SQLITE_OPEN_READWRITE, NULL) != SQLITE_OK)
+  {
+    debug_print("Can't open database %s to check index: %s\n", path.c_str(), sqlite3_errmsg(idb));
+    sqlite3_close(idb);
+    return;
+  }
+  sqlite3_busy_timeout(idb, 10000); //10 seconds
+
+  bool found = false;
+  sqlite3_stmt* statement = NULL;
+  sqlite3_prepare_v2(idb, "PRAGMA index_list(geometry)", -1, &statement, NULL);
+  while (statement && !found && sqlite3_step(statement) == SQLITE_ROW)
+  {
+    //(seq, name, unique, ...) -> (seqno, cid, name)
+    std::string name = (const char*)sqlite3_column_text(statement, 1);
+    std::string SQL = "PRAGMA index_info('" + name + "')";
+    sqlite3_stmt* info = NULL;
+    sqlite3_prepare_v2(idb, SQL.c_str(), -1, &info, NULL);
+    std::string columns;
+    while (info && sqlite3_step(info) == SQLITE_ROW)
+    {
+      const char* col = (const char*)sqlite3_column_text(info, 2);
+      columns += std::string(col ? col : "") + ",";
+    }
+    sqlite3_finalize(info);
+    found = columns.find("timestep,object_id,") == 0;
+  }
+  sqlite3_finalize(statement);
+
+  if (!found)
+  {
+    clock_t t1 = clock();
+    if (issue("create index if not exists geometry_timestep_object on geometry (timestep, object_id, idx, rank)", idb))
+      debug_print("Created geometry index in %s, %.4lf seconds\n", path.c_str(), (clock()-t1)/(double)CLOCKS_PER_SEC);
+  }
+  sqlite3_close(idb);
+}
+
+void Model::inflatePush(LoadRecord* rec)
+{
+  //Queue a record for decompression, waits while queue full
+  int threads = drawstate.global("loadthreads");
+  if (threads <= 0) threads = std::thread::hardware_concurrency();
+  if (threads < 1) threads = 1;
+  if ((int)inflatepool.size() != threads)
+  {
+    //Start workers, or restart with new thread count
+    inflateStop();
+    for (int t=0; t<threads; t++)
+      inflatepool.push_back(std::thread(&Model::inflateLoop, this));
+  }
+
+  std::unique_lock<std::mutex> lock(inflatemutex);
+  inflatedone.wait(lock, [this] {return inflatewaiting.size() < 4 * inflatepool.size();});
+  inflatepending[rec->store]++;
+  inflatewaiting.push_back(rec);
+  inflatecv.notify_one();
+}
+
+void Model::inflateWait(DataContainer* store, unsigned int n)
+{
+  //Before appending n data units to a store: if that will move the data,
+  //wait for the records still to be decompressed into it
+  if (store->fits(n)) return;
+  std::unique_lock<std::mutex> lock(inflatemutex);
+  inflatedone.wait(lock, [this, store] {return inflatepending.count(store) == 0;});
+}
+
+void Model::inflateLoop()
+{
+  //Worker thread: decompress waiting records until stopped
+  //(straight into the data store, which won't move while records pending, see inflateWait(),
+  // delta applied here too so the main thread only applies bounds in load order)
+  std::unique_lock<std::mutex> lock(inflatemutex);
+  while (true)
+  {
+    inflatecv.wait(lock, [this] {return inflatequit || inflatewaiting.size() > 0;});
+    if (inflatequit) break;
+
+    LoadRecord* rec = inflatewaiting.front();
+    inflatewaiting.pop_front();
+    inflatebusy++;
+    inflatedone.notify_all();
+
+    lock.unlock();
+    bool ok = Codec::decode(rec->codec, rec->data.data(), rec->data.size(), rec->dest, rec->length, rec->typesize);
+    std::vector<unsigned char>().swap(rec->data);
+    //Apply delta (base already decoded), copy if base for next step
+    if (ok && rec->base)
+      Codec::undelta(CODEC_DELTA(rec->codec), rec->dest, rec->base->data(), rec->length);
+    if (ok && (CODEC_DELTA(rec->codec) || (rec->codec & CODEC_KEYFRAME)))
+      rec->keep = std::make_shared<std::vector<unsigned char> >(rec->dest, rec->dest + rec->length);
+    lock.lock();
+
+    if (!ok) inflatefailed = rec->codec;
+    if (--inflatepending[rec->store] == 0) inflatepending.erase(rec->store);
+    inflatebusy--;
+    inflatedone.notify_all();
+  }
+}
+
+void Model::inflateStop()
+{
+  //Stop the worker threads once any waiting records are done
+  if (inflatepool.size() == 0) return;
+  {
+    std::unique_lock<std::mutex> lock(inflatemutex);
+    inflatedone.wait(lock, [this] {return inflatewaiting.size() == 0 && inflatebusy == 0;});
+    inflatequit = true;
+  }
+  inflatecv.notify_all();
+  for (unsigned int t=0; t<inflatepool.size(); t++)
+    inflatepool[t].join();
+  inflatepool.clear();
+  inflatequit = false;
+}
+
+void Model::inflateRecords()
+{
+  //Wait for queued records to be decompressed into their data stores and complete loading
+  if (inflatequeue.size() == 0) return;
+  clock_t t1 = clock();
+  int failed;
+  {
+    std::unique_lock<std::mutex> lock(inflatemutex);
+    inflatedone.wait(lock, [this] {return inflatewaiting.size() == 0 && inflatebusy == 0;});
+    failed = inflatefailed;
+    inflatefailed = -1;
+  }
+
+  //Apply bounds from single vertex records (in load order),
+  //keep decoded delta series data as base for next step, previous base no longer needed
+  for (unsigned int i=0; i<inflatequeue.size() && failed < 0; i++)
+  {
+    LoadRecord& rec = inflatequeue[i];
+    if (rec.bounds)
+      rec.bounds->checkPointMinMax((float*)rec.dest);
+    if (rec.base) deltabase.erase(rec.baseid);
+    if (rec.keep) deltaKeep(rec.id, rec.step, rec.keep);
+  }
+
+  loadcopies += inflatequeue.size(); //(decompressed into store)
+  debug_print("... decompressed %d records with %d threads, %.4lf seconds waiting\n", inflatequeue.size(), inflatepool.size(), (clock()-t1)/(double)CLOCKS_PER_SEC);
+  inflatequeue.clear();
+
+  if (failed >= 0)
+    abort_program("Geometry record decode failed! codec %s\n", Codec::name(failed).c_str());
+}
+
+void Model::compactGeometry()
+{
+  //Objects with "compact" enabled keep loaded data in 16-bit form
+  for (unsigned int i=0; i < geometry.size(); i++)
+    geometry[i]->compact();
+}
+
 void Model::mergeDatabases()
 {
   if (!db) return;
   char SQL[SQL_QUERY_MAX];
   reopen(true);  //Open writable
-  for (unsigned int i=0; i<=timesteps.size(); i++)
+
+  //Optional columns (chunk series, codec id, delta base record and duplicated record)
+  const char* optional[] = {"chunk", "codec", "base", "ref"};
+  for (auto col : optional)
+  {
+    if (hasColumn("main", col)) continue;
+    snprintf(SQL, SQL_QUERY_MAX, "ALTER TABLE geometry ADD COLUMN %s INTEGER", col);
+    issue(SQL);
+  }
+  const char* filename = sqlite3_db_filename(db, "main");
+  geomcolumns.erase(filename && strlen(filename) ? filename : "main");
+
+  for (unsigned int i=0; i<timesteps.size(); i++)
   {
     debug_print("MERGE %d/%d...%d\n", i, timesteps.size(), step());
     setTimeStep(i);
     if (attached == step())
     {
-      snprintf(SQL, SQL_QUERY_MAX, "insert into geometry select null, object_id, timestep, rank, idx, type, data_type, size, count, width, minimum, maximum, dim_factor, units, labels, properties, data, minX, minY, minZ, maxX, maxY, maxZ from %sgeometry", prefix);
+      //Record ids offset past existing records, chunk series, delta base and duplicate
+      //references are ids of records in the same file so are offset to match
+      sqlite3_int64 offset = 0;
+      sqlite3_stmt* statement = select("SELECT max(id) FROM geometry");
+      if (statement && sqlite3_step(statement) == SQLITE_ROW)
+        offset = sqlite3_column_int64(statement, 0);
+      sqlite3_finalize(statement);
+
+      char dbname[sizeof(prefix)];
+      snprintf(dbname, sizeof(dbname), "%s", prefix);
+      dbname[strlen(dbname)-1] = '\0'; //Strip "."
+      std::string extcols;
+      for (auto col : optional)
+      {
+        if (!hasColumn(dbname, col))
+          extcols += ", NULL";
+        else if (strcmp(col, "codec") == 0)
+          extcols += ", codec";
+        else
+          extcols += std::string(", ") + col + "+" + std::to_string(offset);
+      }
+
+      snprintf(SQL, SQL_QUERY_MAX, "insert into geometry (id, object_id, timestep, rank, idx, type, data_type, size, count, width, minimum, maximum, dim_factor, units, labels, properties, data, minX, minY, minZ, maxX, maxY, maxZ, chunk, codec, base, ref) select id+%lld, object_id, timestep, rank, idx, type, data_type, size, count, width, minimum, maximum, dim_factor, units, labels, properties, data, minX, minY, minZ, maxX, maxY, maxZ%s from %sgeometry", (long long)offset, extcols.c_str(), prefix);
       issue(SQL);
     }
   }
@@ -1407,11 +2536,52 @@ void Model::writeDatabase(const char* path, DrawingObject* obj, bool compress)
   if (sqlite3_open_v2(path, &outdb, SQLITE_OPEN_CREATE | SQLITE_OPEN_READWRITE, NULL))
   {
     debug_print("Can't open database %s: %s\n", path, sqlite3_errmsg(outdb));
+    sqlite3_close(outdb);
+    return;
+  }
+
+  auto t0 = std::chrono::steady_clock::now();
+  bool ok = false;
+  std::string error;
+  try
+  {
+    ok = writeContents(outdb, obj, compress);
+  }
+  catch (std::exception& e)
+  {
+    error = e.what();
+  }
+
+  //Every exit: finish or roll back any open transaction and close the file
+  //(export worker threads are always joined in writeRecords() before it returns or fails)
+  if (writestatement) sqlite3_finalize(writestatement);
+  writestatement = NULL;
+  writequeue.clear();
+  if (!sqlite3_get_autocommit(outdb))
+    issue(ok ? "COMMIT" : "ROLLBACK", outdb);
+  issue("PRAGMA journal_mode=DELETE", outdb);
+  sqlite3_close(outdb);
+  if (error.length())
+    throw std::runtime_error(error);
+  if (!ok)
+  {
+    std::cerr << "Export to " << path << " failed" << std::endl;
     return;
   }
 
+  double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+  std::cerr << "Exported " << writebytes/1000000.0f << " mb (" << writtenbytes/1000000.0f << " mb stored) to "
+            << path << " in " << secs << " seconds, " << (secs > 0 ? writebytes/1000000.0/secs : 0) << " mb/s" << std::endl;
+}
+
+bool Model::writeContents(sqlite3* outdb, DrawingObject* obj, bool compress)
+{
+  //Write tables and data of writeDatabase() in one transaction, false on failure
+  //(transaction left open to be rolled back by the caller)
+
   // Remove existing data?
   issue("drop table IF EXISTS geometry", outdb);
+  issue("drop table IF EXISTS geometry_rtree", outdb);
   issue("drop table IF EXISTS timestep", outdb);
   issue("drop table IF EXISTS object_colourmap", outdb);
   issue("drop table IF EXISTS colourmap", outdb);
@@ -1419,7 +2589,7 @@ void Model::writeDatabase(const char* path, DrawingObject* obj, bool compress)
   issue("drop table IF EXISTS state", outdb);
 
   // Create new tables when not present
-  issue("create table IF NOT EXISTS geometry (id INTEGER PRIMARY KEY ASC, object_id INTEGER, timestep INTEGER, rank INTEGER, idx INTEGER, type INTEGER, data_type INTEGER, size INTEGER, count INTEGER, width INTEGER, minimum REAL, maximum REAL, dim_factor REAL, units VARCHAR(32), minX REAL, minY REAL, minZ REAL, maxX REAL, maxY REAL, maxZ REAL, labels VARCHAR(2048), properties VARCHAR(2048), data BLOB, FOREIGN KEY (object_id) REFERENCES object (id) ON DELETE CASCADE ON UPDATE CASCADE, FOREIGN KEY (timestep) REFERENCES timestep (id) ON DELETE CASCADE ON UPDATE CASCADE)", outdb);
+  issue("create table IF NOT EXISTS geometry (id INTEGER PRIMARY KEY ASC, object_id INTEGER, timestep INTEGER, rank INTEGER, idx INTEGER, type INTEGER, data_type INTEGER, size INTEGER, count INTEGER, width INTEGER, minimum REAL, maximum REAL, dim_factor REAL, units VARCHAR(32), minX REAL, minY REAL, minZ REAL, maxX REAL, maxY REAL, maxZ REAL, labels VARCHAR(2048), properties VARCHAR(2048), data BLOB, chunk INTEGER, codec INTEGER, base INTEGER, ref INTEGER, FOREIGN KEY (object_id) REFERENCES object (id) ON DELETE CASCADE ON UPDATE CASCADE, FOREIGN KEY (timestep) REFERENCES timestep (id) ON DELETE CASCADE ON UPDATE CASCADE)", outdb);
 
   issue(
     "create table IF NOT EXISTS timestep (id INTEGER PRIMARY KEY ASC, time REAL, dim_factor REAL, units VARCHAR(32), properties VARCHAR(2048))", outdb);
@@ -1433,7 +2603,15 @@ void Model::writeDatabase(const char* path, DrawingObject* obj, bool compress)
   //Write state
   writeState(outdb);
 
-  issue("BEGIN EXCLUSIVE TRANSACTION", outdb);
+  //Bulk export settings, journal switched back at end so file is self contained
+  issue("PRAGMA journal_mode=WAL", outdb);
+  issue("PRAGMA synchronous=OFF", outdb);
+
+  writebytes = writtenbytes = 0;
+  writeid = 0;
+  deltaprev.clear();
+  writehashes.clear();
+  if (!issue("BEGIN EXCLUSIVE TRANSACTION", outdb)) return false;
 
   char SQL[SQL_QUERY_MAX];
 
@@ -1444,17 +2622,18 @@ void Model::writeDatabase(const char* path, DrawingObject* obj, bool compress)
     {
       snprintf(SQL, SQL_QUERY_MAX, "insert into object (name, properties) values ('%s', '%s')", objects[i]->name().c_str(), objects[i]->properties.data.dump().c_str());
       //printf("%s\n", SQL);
-      if (!issue(SQL, outdb)) return;
+      if (!issue(SQL, outdb)) return false;
       //Store the id
       objects[i]->dbid = sqlite3_last_insert_rowid(outdb);
     }
   }
+  objectindex.clear();
 
   //Write timesteps & objects...
   if (timesteps.size() == 0)
   {
     //Create a timestep and
-    if (!issue("insert into timestep (id, time) values (0, 0)", outdb)) return;
+    if (!issue("insert into timestep (id, time) values (0, 0)", outdb)) return false;
     writeObjects(outdb, obj, 0, compress);
   }
 
@@ -1462,7 +2641,7 @@ void Model::writeDatabase(const char* path, DrawingObject* obj, bool compress)
   {
     snprintf(SQL, SQL_QUERY_MAX, "insert into timestep (id, time, properties) values (%d, %g, '%s')", timesteps[i]->step, timesteps[i]->time, "");
     //printf("%s\n", SQL);
-    if (!issue(SQL, outdb)) return;
+    if (!issue(SQL, outdb)) return false;
 
     //Get data at this timestep
     setTimeStep(i);
@@ -1471,7 +2650,27 @@ void Model::writeDatabase(const char* path, DrawingObject* obj, bool compress)
     writeObjects(outdb, obj, step(), compress);
   }
 
-  issue("COMMIT", outdb);
+  //Index for per step and per object queries
+  issue("create index if not exists geometry_timestep_object on geometry (timestep, object_id, idx, rank)", outdb);
+
+  //Spatial index of record bounds for region loading (if rtree module available)
+  //(records without valid bounds are indexed as unbounded, so always loaded)
+  if (sqlite3_compileoption_used("ENABLE_RTREE"))
+  {
+    issue("create virtual table geometry_rtree using rtree(id, minX, maxX, minY, maxY, minZ, maxZ)", outdb);
+    std::string SQL = "insert into geometry_rtree select id";
+    const char* axes[] = {"X", "Y", "Z"};
+    for (auto a : axes)
+    {
+      char col[128];
+      snprintf(col, sizeof(col), ", CASE WHEN min%1$s <= max%1$s THEN min%1$s ELSE -1e38 END, CASE WHEN min%1$s <= max%1$s THEN max%1$s ELSE 1e38 END", a);
+      SQL += col;
+    }
+    SQL += " from geometry where minX is not null";
+    issue(SQL.c_str(), outdb);
+  }
+
+  return true;
 }
 
 void Model::writeState(sqlite3* outdb)
@@ -1519,116 +2718,410 @@ void Model::writeObjects(sqlite3* outdb, DrawingObject* obj, int step, bool comp
       //Loop through all geometry classes (points/vectors etc)
       for (int type=lucMinType; type<lucMaxType; type++)
       {
-        writeGeometry(outdb, (lucGeometryType)type, objects[i], step, compress);
+        writeGeometry((lucGeometryType)type, objects[i], step, compress);
       }
     }
   }
+
+  //Write all queued records
+  writeRecords(outdb, compress);
 }
 
-void Model::writeGeometry(sqlite3* outdb, lucGeometryType type, DrawingObject* obj, int step, bool compressdata)
+void Model::writeGeometry(lucGeometryType type, DrawingObject* obj, int step, bool compressdata)
 {
   std::vector<GeomData*> data = geometry[type]->getAllObjects(obj);
   //Loop through and write out all object data
-  char SQL[SQL_QUERY_MAX];
   unsigned int data_type;
   for (unsigned int i=0; i<data.size(); i++)
   {
-    for (data_type=0; data_type < data[i]->data.size(); data_type++)
+    //Large per vertex data split into chunks of records with their own bounds,
+    //vertex record followed by all other data for each chunk
+    unsigned int chunk = chunkItems(type, data[i]);
+    unsigned int chunks = chunk ? (data[i]->count + chunk - 1) / chunk : 1;
+    if (chunk)
+      std::cerr << "Writing geometry in " << chunks << " chunks of " << chunk << " vertices for object : "
+                << obj->dbid << " => " << obj->name() << std::endl;
+    for (unsigned int c=0; c<chunks; c++)
     {
-      //Write the data entry
-      DataContainer* block = data[i]->data[data_type];
-      if (!block || block->size() == 0) continue;
-      std::cerr << "Writing geometry (type[" << data_type << "] * " << block->size()
-                << ") for object : " << obj->dbid << " => " << obj->name() << ", compress: " << compressdata << std::endl;
-      writeGeometryRecord(outdb, type, (lucGeometryDataType)data_type, obj->dbid, data[i], block, step, compressdata);
-    }
-    for (unsigned int j=0; j<data[i]->values.size(); j++)
-    {
-      //Write the value data entry
-      DataContainer* block = (DataContainer*)data[i]->values[j];
-      if (!block || block->size() == 0) continue;
-      std::cerr << "Writing geometry (values[" << j << "] * " << block->size()
-                << ") for object : " << obj->dbid << " => " << obj->name() << ", compress: " << compressdata << std::endl;
-      //TODO: fix to write/read labels for data values from database, preferably in a separate table?
-      //This hack will work for up to 7 value data sets for now
-      //Filters and colourby properties will need modification though
-      data_type = lucColourValueData+j;
-      if (data_type == lucIndexData) data_type++;
-      writeGeometryRecord(outdb, type, (lucGeometryDataType)data_type, obj->dbid, data[i], block, step, compressdata);
+      unsigned int start = c * chunk;
+      unsigned int items = chunk ? min(chunk, data[i]->count - start) : 0;
+      int cidx = chunk ? c : -1;
+      for (data_type=0; data_type < data[i]->data.size(); data_type++)
+      {
+        //Write the data entry
+        DataContainer* block = data[i]->data[data_type];
+        if (!block || block->size() == 0) continue;
+        if (!chunk)
+          std::cerr << "Writing geometry (type[" << data_type << "] * " << block->size()
+                    << ") for object : " << obj->dbid << " => " << obj->name() << ", compress: " << compressdata << std::endl;
+        writeGeometryRecord(type, (lucGeometryDataType)data_type, obj->dbid, data[i], block, step, start, items, cidx);
+      }
+      for (unsigned int j=0; j<data[i]->values.size(); j++)
+      {
+        //Write the value data entry
+        DataContainer* block = (DataContainer*)data[i]->values[j];
+        if (!block || block->size() == 0) continue;
+        if (!chunk)
+          std::cerr << "Writing geometry (values[" << j << "] * " << block->size()
+                    << ") for object : " << obj->dbid << " => " << obj->name() << ", compress: " << compressdata << std::endl;
+        //TODO: fix to write/read labels for data values from database, preferably in a separate table?
+        //This hack will work for up to 7 value data sets for now
+        //Filters and colourby properties will need modification though
+        data_type = lucColourValueData+j;
+        if (data_type == lucIndexData) data_type++;
+        writeGeometryRecord(type, (lucGeometryDataType)data_type, obj->dbid, data[i], block, step, start, items, cidx);
+      }
     }
   }
 }
 
-void Model::writeGeometryRecord(sqlite3* outdb, lucGeometryType type, lucGeometryDataType dtype, unsigned int objid, GeomData* data, DataContainer* block, int step, bool compressdata)
+unsigned int Model::chunkItems(lucGeometryType type, GeomData* data)
 {
-  char SQL[SQL_QUERY_MAX];
-  sqlite3_stmt* statement;
-  unsigned char* buffer = (unsigned char*)block->ref(0);
-  unsigned long src_len = block->bytes();
-  // Compress the data if enabled and > 1kb
-  unsigned long cmp_len = 0;
-  if (compressdata &&  src_len > 1000)
-  {
-    cmp_len = compressBound(src_len);
-    buffer = (unsigned char*)malloc((size_t)cmp_len);
-    if (buffer == NULL)
-      abort_program("Compress database: out of memory!\n");
-    if (compress(buffer, &cmp_len, (const unsigned char *)block->ref(0), src_len) != Z_OK)
-      abort_program("Compress database buffer failed!\n");
-    if (cmp_len >= src_len)
+  //Vertices per chunk when splitting geometry records on export, 0 = write whole
+  //(only unstructured geometry where all data is per vertex can be split)
+  int chunksize = drawstate.global("chunksize");
+  if (chunksize <= 0 || data->count <= (unsigned int)chunksize) return 0;
+  if (data->labels.size() || data->width || data->height) return 0;
+  unsigned int chunk = chunksize;
+  switch (type)
+  {
+    case lucPointType:
+    case lucShapeType:
+    case lucVectorType:
+      break;
+    case lucTriangleType:
+      //Whole triangles only
+      chunk -= chunk % 3;
+      if (chunk == 0 || data->indices.size()) return 0;
+      break;
+    default:
+      return 0;
+  }
+  for (auto block : data->data)
+    if (block && block->size() && block->count() != data->count) return 0;
+  for (auto block : data->values)
+    if (block->size() && block->count() != data->count) return 0;
+  return chunk;
+}
+
+void Model::writeGeometryRecord(lucGeometryType type, lucGeometryDataType dtype, unsigned int objid, GeomData* data, DataContainer* block, int step, unsigned int start, unsigned int items, int chunk)
+{
+  //Queue record, written by writeRecords() (data must remain valid until then)
+  writequeue.push_back(WriteRecord());
+  WriteRecord& rec = writequeue.back();
+  rec.type = type;
+  rec.dtype = dtype;
+  rec.objid = objid;
+  rec.data = data;
+  rec.block = block;
+  rec.step = step;
+  rec.start = start;
+  rec.items = items ? items : block->count();
+  rec.chunk = chunk;
+  rec.minimum = block->minimum;
+  rec.maximum = block->maximum;
+
+  //Compact data decoded now, read as is by the workers in writeRecords()
+  FloatValues* fvals = dynamic_cast<FloatValues*>(block);
+  if (fvals && fvals->compacted())
+  {
+    rec.decoded.resize(rec.items * block->unitsize());
+    fvals->decode(start * block->unitsize(), rec.decoded.size(), rec.decoded.data());
+  }
+  for (int c=0; c<3; c++)
+  {
+    if (!ISFINITE(data->min[c])) data->min[c] = drawstate.min[c];
+    if (!ISFINITE(data->max[c])) data->max[c] = drawstate.max[c];
+    rec.min[c] = data->min[c];
+    rec.max[c] = data->max[c];
+  }
+
+  //Chunk bounds and value range
+  if (chunk >= 0)
+  {
+    for (int c=0; c<3; c++)
     {
-      free(buffer);
-      buffer = (unsigned char*)block->ref(0);
-      cmp_len = 0;
+      rec.min[c] = HUGE_VAL;
+      rec.max[c] = -HUGE_VAL;
+    }
+    float pos[3];
+    for (unsigned int v=start; v<start+rec.items; v++)
+    {
+      data->vertices.get(v, pos);
+      for (int c=0; c<3; c++)
+      {
+        if (pos[c] < rec.min[c]) rec.min[c] = pos[c];
+        if (pos[c] > rec.max[c]) rec.max[c] = pos[c];
+      }
+    }
+    if (std::find(data->values.begin(), data->values.end(), block) != data->values.end())
+    {
+      FloatValues* vals = (FloatValues*)block;
+      rec.minimum = HUGE_VAL;
+      rec.maximum = -HUGE_VAL;
+      for (unsigned int v=start; v<start+rec.items; v++)
+      {
+        float val = (*vals)[v];
+        if (val < rec.minimum) rec.minimum = val;
+        if (val > rec.maximum) rec.maximum = val;
+      }
     }
-    else
-      src_len = cmp_len;
   }
+}
 
-  if (block->minimum == HUGE_VAL) block->minimum = 0;
-  if (block->maximum == -HUGE_VAL) block->maximum = 0;
+void Model::writeRecords(sqlite3* outdb, bool compressdata)
+{
+  //Delta encode, check for duplicates and compress queued records on worker threads while inserting completed records in order
+  if (writequeue.size() == 0) return;
 
-  float min[3], max[3];
-  for (int c=0; c<3; c++)
+  //Prepare insert, re-used for all records
+  if (!writestatement)
   {
-    if (ISFINITE(data->min[c])) min[c] = data->min[c];
-    else data->min[c] = drawstate.min[c];
-    if (ISFINITE(data->max[c])) max[c] = data->max[c];
-    else data->max[c] = drawstate.max[c];
+    const char* SQL = "insert into geometry (object_id, timestep, rank, idx, type, data_type, size, count, width, minimum, maximum, dim_factor, units, minX, minY, minZ, maxX, maxY, maxZ, labels, data, id, chunk, codec, base, ref) values (?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?)";
+    if (sqlite3_prepare_v2(outdb, SQL, -1, &writestatement, NULL) != SQLITE_OK)
+      abort_program("SQL prepare error: (%s) %s\n", SQL, sqlite3_errmsg(outdb));
+  }
 
+  //Temporal delta encoding of vertex and value data against same record of previous step
+  std::string deltaname = drawstate.global("delta");
+  int deltamode = deltaname == "xor" ? lucDeltaXOR : (deltaname == "diff" ? lucDeltaDiff : lucDeltaNone);
+  int keyframes = drawstate.global("deltakeyframe");
+  if (keyframes < 1) keyframes = 1;
+  //Records with data identical to one exported previously (> 1kb, not delta encoded) stored as a reference
+  bool dedup = drawstate.global("dedup");
+  std::map<std::tuple<unsigned int, int, int>, unsigned int> ordinal;
+  for (auto& rec : writequeue)
+  {
+    rec.codec = lucCompressNone;
+    rec.delta = lucDeltaNone;
+    rec.series = NULL;
+    rec.ref = 0;
+    rec.hashed = dedup && rec.bytes() > 1000;
+    bool values = std::find(rec.data->values.begin(), rec.data->values.end(), rec.block) != rec.data->values.end();
+    if (!deltamode || (rec.dtype != lucVertexData && !values)) continue;
+    unsigned int n = ordinal[std::make_tuple(rec.objid, (int)rec.type, (int)rec.dtype)]++;
+    rec.series = &deltaprev[std::make_tuple(rec.objid, (int)rec.type, (int)rec.dtype, n)];
+    rec.hashed = false;
+    //New keyframe at interval or if size changed
+    if (rec.series->id && rec.series->count % keyframes != 0 && rec.series->data.size() == rec.bytes())
+      rec.delta = deltamode;
+    else
+      rec.series->count = 0;
   }
 
-  snprintf(SQL, SQL_QUERY_MAX, "insert into geometry (object_id, timestep, rank, idx, type, data_type, size, count, width, minimum, maximum, dim_factor, units, minX, minY, minZ, maxX, maxY, maxZ, labels, data) values (%d, %d, %d, %d, %d, %d, %d, %d, %d, %g, %g, %g, '%s', %g, %g, %g, %g, %g, %g, ?, ?)", objid, step, data->height, data->depth, type, dtype, block->unitsize(), block->size(), data->width, block->minimum, block->maximum, 0.0, "", min[0], min[1], min[2], max[0], max[1], max[2]);
+  //Duplicates stored as a reference to the earlier record, each hash added as its record is queued
+  //(so duplicates within this call are found too) and every match verified against the earlier data
+  for (unsigned int i=0; i<writequeue.size(); i++)
+  {
+    WriteRecord& rec = writequeue[i];
+    if (!rec.hashed) continue;
+    unsigned long len = rec.bytes();
+    const unsigned char* src = rec.source();
+    uint64_t hash[2];
+    Codec::hash(src, len, hash);
+    auto key = std::make_tuple(hash[0], hash[1], len, (int)rec.dtype);
+    auto it = writehashes.find(key);
+    if (it == writehashes.end())
+      writehashes[key] = writeid + 1 + i; //Id record will be inserted with
+    else if (writtenData(outdb, it->second, src, len, rec.block->bytes() / rec.block->size()))
+      rec.ref = it->second;
+  }
 
-  /* Prepare statement... */
-  if (sqlite3_prepare_v2(outdb, SQL, -1, &statement, NULL) != SQLITE_OK)
+  bool encode = compressdata || deltamode || dedup;
+  int threads = 0;
+  if (encode)
   {
-    abort_program("SQL prepare error: (%s) %s\n", SQL, sqlite3_errmsg(outdb));
+    threads = drawstate.global("writethreads");
+    if (threads <= 0) threads = std::thread::hardware_concurrency();
+    if (threads > (int)writequeue.size()) threads = writequeue.size();
+    if (threads < 1) threads = 1;
   }
 
-  /* Setup text data for insert (on vertex block only) */
-  std::string labels = data->getLabels().c_str();
-  if (dtype == lucVertexData && labels.length() > 0)
+  //Codec and deflate level
+  std::string codecname = drawstate.global("codec");
+  int codec = Codec::lookup(codecname);
+  if (codec < 0)
   {
-    if (sqlite3_bind_text(statement, 1, labels.c_str(), labels.length(), SQLITE_STATIC) != SQLITE_OK)
-    //const char* clabels = labels.c_str();
-    //if (sqlite3_bind_text(statement, 1, clabels, strlen(clabels), SQLITE_STATIC) != SQLITE_OK)
-      abort_program("SQL bind error: %s\n", sqlite3_errmsg(outdb));
+    std::cerr << "Unknown codec: " << codecname << ", using deflate" << std::endl;
+    codec = lucCompressDeflate;
   }
+  int level = drawstate.global("compresslevel");
 
-  /* Setup blob data for insert */
-  debug_print("Writing %lu bytes\n", src_len);
-  if (sqlite3_bind_blob(statement, 2, buffer, src_len, SQLITE_STATIC) != SQLITE_OK)
-    abort_program("SQL bind error: %s\n", sqlite3_errmsg(outdb));
+  std::mutex donemutex;
+  std::condition_variable donecv;
+  std::vector<bool> done(writequeue.size(), !encode);
+  std::atomic<unsigned int> next(0);
+  auto worker = [this, &next, &done, &donemutex, &donecv, compressdata, codec, level]()
+  {
+    unsigned int i;
+    while ((i = next++) < writequeue.size())
+    {
+      WriteRecord& rec = writequeue[i];
+      unsigned int typesize = rec.block->bytes() / rec.block->size();
+      unsigned long src_len = rec.bytes();
+      const unsigned char* src = rec.source();
 
-  /* Execute statement */
-  if (sqlite3_step(statement) != SQLITE_DONE )
-    abort_program("SQL step error: (%s) %s\n", SQL, sqlite3_errmsg(outdb));
+      //Duplicate of an earlier record, nothing to encode
+      if (rec.ref)
+      {
+        std::lock_guard<std::mutex> guard(donemutex);
+        done[i] = true;
+        donecv.notify_all();
+        continue;
+      }
 
-  sqlite3_finalize(statement);
+      //Delta against previous step
+      std::vector<unsigned char> deltas;
+      if (rec.delta)
+      {
+        deltas.resize(src_len);
+        Codec::delta(rec.delta, src, &rec.series->data[0], &deltas[0], src_len);
+        src = &deltas[0];
+      }
+
+      // Compress the data if > 1kb, keep only if smaller
+      if (compressdata && src_len > 1000)
+        rec.codec = Codec::encode(codec, src, src_len, rec.compressed, typesize, level);
+
+      //Uncompressed deltas stored as is
+      if (rec.delta && rec.codec == lucCompressNone)
+        rec.compressed.swap(deltas);
+      if (rec.delta)
+        rec.codec = CODEC_WITH_DELTA(rec.codec, rec.delta);
+      else if (rec.series)
+        rec.codec |= CODEC_KEYFRAME;
+
+      std::lock_guard<std::mutex> guard(donemutex);
+      done[i] = true;
+      donecv.notify_all();
+    }
+  };
 
-  // Free compression buffer
-  if (cmp_len > 0) free(buffer);
+  std::vector<std::thread> pool;
+  for (int t=0; t<threads; t++)
+    pool.push_back(std::thread(worker));
+
+  std::string error;
+  sqlite3_int64 chunkid = 0; //Id of first record in current chunk series
+  for (unsigned int i=0; i<writequeue.size(); i++)
+  {
+    //Wait for record to be compressed
+    {
+      std::unique_lock<std::mutex> lock(donemutex);
+      donecv.wait(lock, [&done, i] {return done[i] == true;});
+    }
+
+    WriteRecord& rec = writequeue[i];
+    DataContainer* block = rec.block;
+    GeomData* data = rec.data;
+    if (rec.minimum == HUGE_VAL) rec.minimum = 0;
+    if (rec.maximum == -HUGE_VAL) rec.maximum = 0;
+    unsigned long bytes = rec.bytes();
+
+    //Chunks of the same data share the id of the series' first record
+    writeid++;
+    if (rec.chunk == 0 && rec.dtype == lucVertexData) chunkid = writeid;
+
+    sqlite3_stmt* statement = writestatement;
+    sqlite3_bind_int(statement, 1, rec.objid);
+    sqlite3_bind_int(statement, 2, rec.step);
+    sqlite3_bind_int(statement, 3, data->height);
+    sqlite3_bind_int(statement, 4, data->depth);
+    sqlite3_bind_int(statement, 5, rec.type);
+    sqlite3_bind_int(statement, 6, rec.dtype);
+    sqlite3_bind_int(statement, 7, block->unitsize());
+    sqlite3_bind_int(statement, 8, rec.items * block->unitsize());
+    sqlite3_bind_int(statement, 9, data->width);
+    sqlite3_bind_double(statement, 10, rec.minimum);
+    sqlite3_bind_double(statement, 11, rec.maximum);
+    sqlite3_bind_double(statement, 12, 0.0);
+    sqlite3_bind_text(statement, 13, "", 0, SQLITE_STATIC);
+    for (int c=0; c<3; c++)
+    {
+      sqlite3_bind_double(statement, 14+c, rec.min[c]);
+      sqlite3_bind_double(statement, 17+c, rec.max[c]);
+    }
+    sqlite3_bind_int64(statement, 22, writeid);
+    if (rec.chunk >= 0)
+      sqlite3_bind_int64(statement, 23, chunkid);
+    sqlite3_bind_int(statement, 24, rec.codec);
+    if (rec.delta)
+      sqlite3_bind_int64(statement, 25, rec.series->id);
+    if (rec.ref)
+      sqlite3_bind_int64(statement, 26, rec.ref);
+
+    /* Setup text data for insert (on vertex block only) */
+    std::string labels = data->getLabels();
+    if (rec.dtype == lucVertexData && labels.length() > 0)
+      sqlite3_bind_text(statement, 20, labels.c_str(), labels.length(), SQLITE_STATIC);
+
+    /* Setup blob data for insert (empty if a reference) */
+    const void* buffer = rec.compressed.size() ? (void*)&rec.compressed[0] : (void*)rec.source();
+    unsigned long len = rec.compressed.size() ? rec.compressed.size() : (rec.ref ? 0 : bytes);
+    debug_print("Writing %lu bytes\n", len);
+    if (sqlite3_bind_blob(statement, 21, buffer, len, SQLITE_STATIC) != SQLITE_OK)
+      error = "SQL bind error: ";
+
+    /* Execute statement */
+    if (error.length() == 0 && sqlite3_step(statement) != SQLITE_DONE)
+      error = "SQL step error: ";
+    if (error.length())
+    {
+      error += sqlite3_errmsg(outdb);
+      next = writequeue.size(); //Stop workers
+      break;
+    }
+
+    sqlite3_reset(statement);
+    sqlite3_clear_bindings(statement);
+
+    writebytes += bytes;
+    writtenbytes += len;
+
+    //Save data as delta base for next step
+    if (rec.series)
+    {
+      const unsigned char* raw = rec.source();
+      rec.series->id = writeid;
+      rec.series->count++;
+      rec.series->data.assign(raw, raw + bytes);
+    }
+
+    //Free compressed data once written
+    std::vector<unsigned char>().swap(rec.compressed);
+  }
+
+  for (unsigned int t=0; t<pool.size(); t++)
+    pool[t].join();
+  writequeue.clear();
+
+  if (error.length())
+    abort_program("%s\n", error.c_str());
+}
+
+bool Model::writtenData(sqlite3* outdb, sqlite3_int64 id, const unsigned char* src, unsigned long len, unsigned int typesize)
+{
+  //Compare data with that of an exported record, still queued or already in the database
+  if (id > writeid)
+  {
+    WriteRecord& rec = writequeue[id - writeid - 1];
+    return rec.bytes() == len && memcmp(rec.source(), src, len) == 0;
+  }
+
+  sqlite3_stmt* statement;
+  if (sqlite3_prepare_v2(outdb, "SELECT codec,data FROM geometry WHERE id=?1", -1, &statement, NULL) != SQLITE_OK)
+    return false;
+  sqlite3_bind_int64(statement, 1, id);
+  bool same = false;
+  if (sqlite3_step(statement) == SQLITE_ROW)
+  {
+    int codec = sqlite3_column_int(statement, 0);
+    const unsigned char* data = (const unsigned char*)sqlite3_column_blob(statement, 1);
+    std::vector<unsigned char> decoded(len);
+    same = Codec::decode(codec, data, sqlite3_column_bytes(statement, 1), decoded.data(), len, typesize) && memcmp(decoded.data(), src, len) == 0;
+  }
+  sqlite3_finalize(statement);
+  return same;
 }
 
 void Model::deleteObject(unsigned int id)
@@ -1701,20 +3194,20 @@ void Model::jsonWrite(std::ostream& os, DrawingObject* o, bool objdata)
       max.push_back(view->max[i]);
     }
 
-    vprops["rotate"] = rot;
-    vprops["translate"] = trans;
-    vprops["focus"] = foc;
-    vprops["scale"] = scale;
+    view->properties.set("rotate", rot);
+    view->properties.set("translate", trans);
+    view->properties.set("focus", foc);
+    view->properties.set("scale", scale);
     //Can't set min/max properties from auto calc or will override future bounding box calc,
     //useful to get the calculated bounding box, so export as "bounds"
     json bounds;
     bounds["min"] = min;
     bounds["max"] = max;
-    vprops["bounds"] = bounds;
+    view->properties.set("bounds", bounds);
 
     //Converts named colours to js readable
     if (vprops.count("background") > 0)
-      vprops["background"] = Colour(vprops["background"]).toString();
+      view->properties.set("background", Colour(vprops["background"]).toString());
 
     //Add the view
     outviews.push_back(vprops);
@@ -1938,7 +3431,7 @@ void Model::jsonRead(std::string data)
     if (i >= inobjects.size())
     {
       //Not in imported list, assume hidden
-      objects[i]->properties.data["visible"] = false;
+      objects[i]->properties.set("visible", false);
     }
     
     //Merge properties
@@ -1948,6 +3441,7 @@ void Model::jsonRead(std::string data)
   //if (viewer && viewer->isopen)
   //  viewer->setBackground(Colour(aview->properties["background"])); //Update background colour
 
+  Properties::changed();
   bool reload = (imported["reload"].is_boolean() && imported["reload"]);
   redraw(reload);
 }
@@ -44,16 +44,151 @@
 #include "View.h"
 #include "Geometry.h"
 #include "TimeStep.h"
+#include "Codec.h"
 
 #define SQL_QUERY_MAX 4096
 
+//Compressed geometry record waiting to be decompressed into its reserved data store
+struct LoadRecord
+{
+  DataContainer* store;
+  unsigned char* dest;      //Destination in store, valid until store grows (see inflateWait)
+  unsigned long length;     //Uncompressed bytes
+  int codec;                //Codec id of compressed data
+  unsigned int typesize;    //Element size for prefilter
+  sqlite3_int64 id;         //Record id, decoded data kept when used as delta base
+  sqlite3_int64 baseid;     //Delta base record id
+  std::shared_ptr<std::vector<unsigned char> > base; //Delta base data if delta encoded
+  std::shared_ptr<std::vector<unsigned char> > keep; //Copy of decoded data to keep as delta base for next step
+  int step;                 //Timestep of record
+  std::vector<unsigned char> data; //Compressed bytes
+  GeomData* bounds;         //Single vertex record, apply bounds when loaded
+};
+
+//Decoded data of a loaded delta series record, base of the record in the following step
+struct BaseRecord
+{
+  int step;                 //Timestep of record
+  std::shared_ptr<std::vector<unsigned char> > data;
+};
+
+//Last exported record of a delta encoded series
+struct DeltaState
+{
+  sqlite3_int64 id;         //Record id, 0 if none
+  unsigned int count;       //Records written since keyframe
+  std::vector<unsigned char> data;
+};
+
+//Decoded data of records referenced by duplicate records (by database file and record id),
+//shared read-only by the data stores of every step using them, dropped once unused
+struct SharedBlocks
+{
+  std::mutex mutex;
+  std::map<std::pair<std::string, sqlite3_int64>, std::shared_ptr<DataContainer> > blocks;
+};
+
+//Geometry record queued for export, compressed on worker threads
+struct WriteRecord
+{
+  lucGeometryType type;
+  lucGeometryDataType dtype;
+  unsigned int objid;
+  GeomData* data;
+  DataContainer* block;
+  int step;
+  unsigned int start;       //First data unit of block to write
+  unsigned int items;       //Data units to write
+  int chunk;                //Chunk index when split, -1 if whole block
+  float min[3];             //Bounds of record vertices
+  float max[3];
+  float minimum;            //Value range of record data
+  float maximum;
+  int codec;                //Codec id applied, lucCompressNone if stored uncompressed
+  int delta;                //Temporal delta mode applied
+  DeltaState* series;       //Delta series state, NULL if not delta encoded
+  bool hashed;              //Checked for duplicates
+  sqlite3_int64 ref;        //Id of earlier record with identical data, 0 if none
+  std::vector<unsigned char> compressed; //Compressed data, empty if not compressed
+  std::vector<float> decoded; //Copy of compact data decoded for export, empty if not compact
+
+  unsigned long bytes() {return items * block->unitsize() * (block->bytes() / block->size());}
+  const unsigned char* source() {return decoded.size() ? (const unsigned char*)decoded.data() : (const unsigned char*)block->ref(start * block->unitsize());}
+};
+
 class Model
 {
 private:
   bool readonly;
-  int attached;
-  char prefix[10];    //attached db prefix
+  int attached;       //Current step attached db
+  char prefix[32];    //attached db prefix
+  std::map<int, unsigned long> attachpool; //Attached step dbs and last use
+  unsigned long attachclock;
   int now;            //Loaded step per model
+  unsigned long cacheclock; //Cache access counter
+
+  //Background timestep prefetch
+  std::thread prefetcher;
+  std::mutex prefetchmutex;
+  std::condition_variable prefetchcv;
+  std::deque<TimeStep*> prefetchqueue;  //Steps waiting to read
+  std::deque<TimeStep*> prefetchready;  //Read steps waiting to be collected
+  std::string prefetchdb;               //Model database file
+  int prefetchbusy;                     //Step currently loading, -1 if none
+  bool prefetchquit;
+
+  //Records decompressed on worker threads while loadGeometry continues reading
+  //(workers kept running between loads, queue of waiting records is bounded)
+  std::deque<LoadRecord> inflatequeue;  //Records of current load (deque: references stay valid as it grows)
+  std::vector<std::thread> inflatepool;
+  std::mutex inflatemutex;
+  std::condition_variable inflatecv;    //Records waiting or stopping
+  std::condition_variable inflatedone;  //Record taken or finished
+  std::deque<LoadRecord*> inflatewaiting;
+  std::map<DataContainer*, unsigned int> inflatepending; //Records queued or decompressing into each store
+  unsigned int inflatebusy;             //Records being decompressed
+  int inflatefailed;                    //Codec of failed record, -1 if none
+  bool inflatequit;
+  void inflatePush(LoadRecord* rec);
+  void inflateLoop();
+  void inflateWait(DataContainer* store, unsigned int n);
+  void inflateStop();
+  void inflateRecords();
+  void compactGeometry();
+
+  std::vector<WriteRecord> writequeue;  //Records pending export in writeDatabase
+  sqlite3_stmt* writestatement;         //Prepared geometry insert for export
+  unsigned long long writebytes;        //Data bytes exported
+  unsigned long long writtenbytes;      //Bytes stored in exported database (compressed size)
+  sqlite3_int64 writeid;                //Last geometry record id exported
+  std::map<std::tuple<unsigned int, int, int, unsigned int>, DeltaState> deltaprev; //Delta series by object, type, data type, index
+  std::map<sqlite3_int64, BaseRecord> deltabase; //Delta base records by id, dropped once dependant decoded
+  std::shared_ptr<std::vector<unsigned char> > deltaBase(sqlite3_int64 id);
+  void deltaKeep(sqlite3_int64 id, int step, const std::shared_ptr<std::vector<unsigned char> >& data);
+  void deltaPrune();
+  std::map<std::tuple<uint64_t, uint64_t, unsigned long, int>, sqlite3_int64> writehashes; //Exported records by content hash, bytes and data type
+  std::shared_ptr<SharedBlocks> sharedblocks;
+  std::shared_ptr<DataContainer> sharedBlock(const char* dbname, sqlite3_int64 id);
+  void sharedPrune();
+  unsigned int chunkItems(lucGeometryType type, GeomData* data);
+  void writeRecords(sqlite3* outdb, bool compress);
+  bool writtenData(sqlite3* outdb, sqlite3_int64 id, const unsigned char* src, unsigned long len, unsigned int typesize);
+
+  std::unordered_map<unsigned int, unsigned int> objectindex; //Position in object list by id (clear when objects or ids change)
+  std::map<std::string, std::map<std::string, sqlite3_stmt*> > queries; //Cached prepared geometry queries by attached database prefix and SQL
+  std::set<std::string> indexchecked;           //Database files checked for geometry index
+  sqlite3_stmt* query(const char* SQL, bool& cached);
+  void clearQueries(const char* dbprefix=NULL);
+  void checkIndex(const std::string& path);
+  std::map<std::string, bool> rtrees;           //Database files with spatial index
+  std::map<std::string, std::set<std::string> > geomcolumns; //Geometry table columns of database files
+  bool hasColumn(const char* dbname, const char* column);
+  bool hasRTree(const char* dbname);
+
+  void newArena();
+
+  void prefetchLoop();
+  void prefetchRead(TimeStep* ts, const std::string& dbpath);
 
 public:
   DrawState& drawstate;
@@ -86,6 +221,15 @@ public:
   Shapes* shapes;
   Volumes* volumes;
 
+  //Geometry load counters
+  unsigned long loadrecords;   //Records loaded
+  unsigned long loadcopies;    //Copies of record data made in loading (blob reads, decompression or copy into stores, delta bases)
+  unsigned long loadshared;    //Records sharing the data of an identical record
+  unsigned long long loadbytes; //Data bytes stored
+  unsigned long long readbytes; //Bytes read from database (compressed size)
+  double querytime;            //Seconds in database queries and blob reads
+  double decodetime;           //Seconds decompressing and storing data
+
   DrawingObject* borderobj;
   DrawingObject* axisobj;
   DrawingObject* rulerobj;
@@ -94,10 +238,16 @@ public:
   bool open(bool write=false);
   void reopen(bool write=false);
   void attach(int stepidx);
+  int attachLimit();
+  bool attachStep(int stepidx);
+  bool detach(int timestep);
+  void attachAhead();
   void close();
   void clearObjects(bool all=false);
   void setup();
   void reload(DrawingObject* obj);
+  void recolour(DrawingObject* obj);
+  void refilter(DrawingObject* obj);
   void redraw(bool reload=false);
   unsigned int addColourMap(ColourMap* cmap=NULL);
   void loadWindows();
@@ -105,6 +255,7 @@ public:
   void loadLinks(DrawingObject* obj);
   void clearTimeSteps();
   int loadTimeSteps(bool scan=false);
+  int followTimeSteps();
   void loadFixed();
   std::string checkFileStep(unsigned int ts, const std::string& basename, unsigned int limit=1);
   void loadViewports();
@@ -124,17 +275,31 @@ public:
   int addFigure(const std::string& name="", const std::string& state="");
   void addObject(DrawingObject* obj);
   DrawingObject* findObject(unsigned int id);
+  void objectsChanged() {objectindex.clear();} //Call after modifying object list or ids directly
   View* defaultView();
 
   //Data fix
   void freeze();
 
   //Timestep caching
+  unsigned long cachehits;
+  unsigned long cachemisses;
+  unsigned long cacheevictions;
   void deleteCache();
   void cacheLoad();
   void cacheStep();
   bool restoreStep();
   void printCache();
+  long cacheBytes();
+  bool cacheFull();
+  void cacheEvict();
+  void cachePin(int stepidx, bool pin=true);
+
+  //Timestep prefetch
+  unsigned long prefetchloads;
+  void prefetch();
+  void prefetchCollect();
+  void prefetchStop();
 
   int step()
   {
@@ -162,13 +327,15 @@ public:
   }
 
   int setTimeStep(int stepidx);
+  void reloadStep();
   int loadGeometry(int obj_id=0, int time_start=-1, int time_stop=-1, bool recurseTracers=true);
   void mergeDatabases();
   void writeDatabase(const char* path, DrawingObject* obj, bool compress=false);
+  bool writeContents(sqlite3* outdb, DrawingObject* obj, bool compress);
   void writeState(sqlite3* outdb=NULL);
   void writeObjects(sqlite3* outdb, DrawingObject* obj, int step, bool compress);
-  void writeGeometry(sqlite3* outdb, lucGeometryType type, DrawingObject* obj, int step, bool compress);
-  void writeGeometryRecord(sqlite3* outdb, lucGeometryType type, lucGeometryDataType dtype, unsigned int objid, GeomData* data, DataContainer* block, int step, bool compressdata);
+  void writeGeometry(lucGeometryType type, DrawingObject* obj, int step, bool compress);
+  void writeGeometryRecord(lucGeometryType type, lucGeometryDataType dtype, unsigned int objid, GeomData* data, DataContainer* block, int step, unsigned int start=0, unsigned int items=0, int chunk=-1);
   void deleteObject(unsigned int id);
   void backup(sqlite3 *fromDb, sqlite3* toDb);
   void objectBounds(DrawingObject* draw, float* min, float* max);
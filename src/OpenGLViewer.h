@@ -177,8 +177,11 @@ public:
     textColour.value = 0xff000000;
     if (avg < 127) 
       textColour.value = 0xffffffff;
-    if (app)
+    if (app && app->drawstate.defaults["colour"] != textColour.toJson())
+    {
       app->drawstate.defaults["colour"] = textColour.toJson();
+      Properties::changed();
+    }
     //Set GL colours
     if (isopen)
     {
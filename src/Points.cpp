@@ -36,6 +36,12 @@
 #include "GraphicsUtil.h"
 #include "Geometry.h"
 
+//Interned ids of properties read when loading vertices
+static const unsigned int pointattribsKey = PropertyKeys::id("pointattribs");
+static const unsigned int pointsizeKey = PropertyKeys::id("pointsize");
+static const unsigned int scalingKey = PropertyKeys::id("scaling");
+static const unsigned int sizebyKey = PropertyKeys::id("sizeby");
+
 Points::Points(DrawState& drawstate) : Geometry(drawstate)
 {
   type = lucPointType;
@@ -96,10 +102,16 @@ void Points::loadVertices()
 
   // VBO - copy normals/colours/positions to buffer object for quick display
   int datasize;
-  if (drawstate.global("pointattribs"))
+  if (drawstate.global(pointattribsKey))
     datasize = sizeof(float) * 5 + sizeof(Colour);   //Vertex(3), two flags and 32-bit colour
   else
     datasize = sizeof(float) * 3 + sizeof(Colour);   //Vertex(3) and 32-bit colour
+  bool values = loadColourSlots();
+  if (values)
+    datasize += sizeof(float) * 2;   //Raw colour value and slot for mapping in shader
+  bool filters = loadFilterSlots();
+  if (filters)
+    datasize += sizeof(float) * 4;   //Filter values and slot for filtering in shader
   if (!drawstate.pvbo) glGenBuffers(1, &drawstate.pvbo);
 
   glBindBuffer(GL_ARRAY_BUFFER, drawstate.pvbo);
@@ -138,15 +150,25 @@ void Points::loadVertices()
     geom[s]->colourCalibrate();
 
     Properties& props = geom[s]->draw->properties;
-    float psize0 = props["pointsize"];
-    float scaling = props["scaling"];
+    float psize0 = props[pointsizeKey];
+    float scaling = props[scalingKey];
     psize0 *= scaling;
     float ptype = getPointType(s); //Default (-1) is to use the global (uniform) value
-    bool attribs = drawstate.global("pointattribs");
-    unsigned int sizeidx = geom[s]->valuesLookup(geom[s]->draw->properties["sizeby"]);
+    bool attribs = drawstate.global(pointattribsKey);
+    unsigned int sizeidx = geom[s]->valuesLookup(props[sizebyKey]);
     bool usesize = geom[s]->valueData(sizeidx) != NULL;
     //std::cout << geom[s]->draw->properties["sizeby"] << " : " << sizeidx << " : " << usesize << std::endl;
-    Colour c;
+    //Colours are mapped here unless the shader can map the raw values
+    int slot = colourSlot(s);
+    std::vector<Colour> colours(slot < 0 ? geom[s]->count : 0);
+    std::vector<float> cvalues(slot < 0 ? 0 : geom[s]->count);
+    if (slot < 0)
+      geom[s]->fillColours(colours.data(), 0, geom[s]->count);
+    else
+      geom[s]->fillValues(cvalues.data(), 0, geom[s]->count);
+    //Filters are applied here unless the shader can compare the values
+    std::vector<float> fvalues;
+    int fslot = filterSlot(s, fvalues);
 
     for (unsigned int i = 0; i < geom[s]->count; i ++)
     {
@@ -154,11 +176,13 @@ void Points::loadVertices()
       if (ptr)
       {
         assert((unsigned int)(ptr-p) < total * datasize);
-        //Copies vertex bytes
-        memcpy(ptr, geom[s]->vertices[i], sizeof(float) * 3);
+        //Copies vertex bytes (decoded if compact)
+        geom[s]->vertices.get(i, (float*)ptr);
         ptr += sizeof(float) * 3;
-        geom[s]->getColour(c, i);
-        memcpy(ptr, &c, sizeof(Colour));
+        if (slot < 0)
+          memcpy(ptr, &colours[i], sizeof(Colour));
+        else
+          memset(ptr, 0, sizeof(Colour));
         ptr += sizeof(Colour);
         //Optional per-object size/type
         if (attribs)
@@ -171,6 +195,20 @@ void Points::loadVertices()
           memcpy(ptr, &ptype, sizeof(float));
           ptr += sizeof(float);
         }
+        if (values)
+        {
+          float cv[2] = {slot < 0 ? 0.0f : cvalues[i], (float)slot};
+          memcpy(ptr, cv, sizeof(float) * 2);
+          ptr += sizeof(float) * 2;
+        }
+        if (filters)
+        {
+          float fv[4] = {0.0f, 0.0f, 0.0f, (float)fslot};
+          if (fslot >= 0)
+            memcpy(fv, &fvalues[i * MAX_SHADER_FILTERS], sizeof(float) * MAX_SHADER_FILTERS);
+          memcpy(ptr, fv, sizeof(float) * 4);
+          ptr += sizeof(float) * 4;
+        }
       }
     }
 
@@ -201,11 +239,15 @@ void Points::loadList()
   for (unsigned int s = 0; s < geom.size(); offset += geom[s]->count, s++)
   {
     if (!drawable(s)) continue;
+    //No pointer into compact vertex data, decoded when sorting
+    bool compact = geom[s]->vertices.compacted();
+    //Skip the filter mask when filtered in the shaders
+    bool filtered = (s >= filterslots.size() || filterslots[s] < 0) && geom[s]->filterMask();
     for (unsigned int i = 0; i < geom[s]->count; i ++)
     {
-      if (geom[s]->filter(i)) continue;
+      if (filtered && geom[s]->filter(i)) continue;
       pidx[elements].index = offset + i;
-      pidx[elements].vertex = geom[s]->vertices[i];
+      pidx[elements].vertex = compact ? NULL : geom[s]->vertices[i];
       pidx[elements].distance = 0;
       elements++;
     }
@@ -230,10 +272,22 @@ void Points::depthSort()
   //Update eye distances, clamping int distance to integer between 0 and SORT_DIST_MAX
   float multiplier = (float)SORT_DIST_MAX / (maxdist - mindist);
   float fdistance;
+  float vertex[3];
+  std::vector<unsigned int> offsets; //Global index of first point in each swarm
+  for (unsigned int s = 0, offset = 0; s < geom.size(); offset += geom[s]->count, s++)
+    offsets.push_back(offset);
   for (unsigned int i = 0; i < elements; i++)
   {
+    float* pos = pidx[i].vertex;
+    if (!pos)
+    {
+      //Compact vertex, find swarm and decode
+      unsigned int s = std::upper_bound(offsets.begin(), offsets.end(), pidx[i].index) - offsets.begin() - 1;
+      geom[s]->vertices.get(pidx[i].index - offsets[s], vertex);
+      pos = vertex;
+    }
     //Distance from viewing plane is -eyeZ
-    fdistance = eyeDistance(view->modelView, pidx[i].vertex);
+    fdistance = eyeDistance(view->modelView, pos);
     pidx[i].distance = (unsigned short)(multiplier * (fdistance - mindist));
   }
   t2 = clock();
@@ -327,7 +381,7 @@ void Points::render()
 
 int Points::getPointType(int index)
 {
-  json& pointtype = drawstate.global("pointtype");
+  json pointtype = drawstate.global("pointtype");
   int ptype = -1;
   if (index != -1)
   {
@@ -407,6 +461,10 @@ void Points::draw()
   int stride = 3 * sizeof(float) + sizeof(Colour);
   if (drawstate.global("pointattribs"))
     stride += 2 * sizeof(float);
+  if (colourslots.size())
+    stride += 2 * sizeof(float);
+  if (filterslots.size())
+    stride += 4 * sizeof(float);
   glBindBuffer(GL_ARRAY_BUFFER, drawstate.pvbo);
   glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, drawstate.pindexvbo);
   if (elements > 0 && glIsBuffer(drawstate.pvbo) && glIsBuffer(drawstate.pindexvbo))
@@ -417,6 +475,11 @@ void Points::draw()
     glEnableClientState(GL_VERTEX_ARRAY);
     glEnableClientState(GL_COLOR_ARRAY);
 
+    //Raw colour values for mapping in shader, then filter values, last four floats
+    size_t foffset = stride - (filterslots.size() ? 4*sizeof(float) : 0);
+    GLint aColourValue = useColourMaps(prog, stride, foffset - 2*sizeof(float));
+    GLint aFilterValue = useFilters(prog, stride, foffset);
+
     //Generic vertex attributes, "aSize", "aPointType"
     if (drawstate.global("pointattribs"))
     {
@@ -451,6 +514,8 @@ void Points::draw()
       glDrawElements(GL_POINTS, elements, GL_UNSIGNED_INT, (GLvoid*)0);
     }
 
+    releaseColourMaps(aColourValue);
+    releaseFilters(aFilterValue);
     glDisableClientState(GL_VERTEX_ARRAY);
     glDisableClientState(GL_COLOR_ARRAY);
   }
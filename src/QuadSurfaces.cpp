@@ -222,6 +222,8 @@ void QuadSurfaces::draw()
   clock_t t0 = clock();
   double time;
   int stride = 8 * sizeof(float) + sizeof(Colour);   //3+3+2 vertices, normals, texCoord + 32-bit colour
+  if (colourslots.size())
+    stride += 2 * sizeof(float);   //+ raw colour value and slot
   glBindBuffer(GL_ARRAY_BUFFER, vbo);
   glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexvbo);
   if (geom.size() > 0 && elements > 0 && glIsBuffer(vbo) && glIsBuffer(indexvbo))
@@ -234,6 +236,7 @@ void QuadSurfaces::draw()
     glEnableClientState(GL_NORMAL_ARRAY);
     glEnableClientState(GL_TEXTURE_COORD_ARRAY);
     glEnableClientState(GL_COLOR_ARRAY);
+    GLint aColourValue = useColourMaps(drawstate.prog[lucGridType], stride, 8*sizeof(float) + sizeof(Colour));
 
     //Render in reverse sorted order
     for (int i=geom.size()-1; i>=0; i--)
@@ -259,6 +262,7 @@ void QuadSurfaces::draw()
     //fprintf(stderr, "DRAWING ALL QUADS: %d\n", elements);
     //glDrawElements(GL_QUADS, elements, GL_UNSIGNED_INT, (GLvoid*)(0));
 
+    releaseColourMaps(aColourValue);
     glDisableClientState(GL_VERTEX_ARRAY);
     glDisableClientState(GL_NORMAL_ARRAY);
     glDisableClientState(GL_TEXTURE_COORD_ARRAY);
@@ -52,6 +52,8 @@ void Shader::init(std::string vsrc, std::string fsrc)
   //Default shaders
   if (fsrc.length() == 0) fsrc = std::string(fragmentShader);
   if (vsrc.length() == 0) vsrc = std::string(vertexShader);
+  vsrc = defines(vsrc);
+  fsrc = defines(fsrc);
   //Attempts to load and build shader programs
   if (compile(vsrc.c_str(), GL_VERTEX_SHADER) &&
       compile(fsrc.c_str(), GL_FRAGMENT_SHADER)) build();
@@ -80,12 +82,38 @@ std::string Shader::read_file(const char *fname)
   std::ifstream ifs(filepath);
   std::stringstream buffer;
   if (ifs.is_open())
-    buffer << ifs.rdbuf();
+  {
+    //Replace #include "file" lines with the source of file (shared functions)
+    std::string line;
+    while (std::getline(ifs, line))
+    {
+      size_t q0 = line.find('"');
+      size_t q1 = line.rfind('"');
+      if (line.compare(0, 8, "#include") == 0 && q0 < q1)
+        buffer << read_file(line.substr(q0+1, q1-q0-1).c_str());
+      else
+        buffer << line << std::endl;
+    }
+  }
   else
     std::cerr << "Error opening shader: " << filepath << std::endl;
   return buffer.str();
 }
 
+//Insert the array sizes shared with the renderers into shader source, after any #version line
+std::string Shader::defines(const std::string& src)
+{
+  std::stringstream defs;
+  defs << "#define MAX_COLOURMAP_SLOTS " << MAX_COLOURMAP_SLOTS << std::endl
+       << "#define MAX_FILTER_SLOTS " << MAX_FILTER_SLOTS << std::endl;
+  size_t pos = src.find("#version");
+  if (pos != std::string::npos)
+    pos = src.find('\n', pos);
+  if (pos == std::string::npos)
+    return defs.str() + src;
+  return src.substr(0, pos+1) + defs.str() + src.substr(pos+1);
+}
+
 bool Shader::compile(const char *src, GLuint type)
 {
   GLint compiled;
@@ -215,3 +243,15 @@ void Shader::setUniformf(const char* name, float value)
   }
 }
 
+
+void Shader::setUniform4fv(const char* name, int count, const float* values)
+{
+  if (!supported || !program) return;
+  std::map<std::string,int>::iterator it = uniforms.find(name);
+  if (it != uniforms.end())
+  {
+    GLint loc = uniforms[name];
+    if (loc >= 0) glUniform4fv(loc, count, values);
+    GL_Error_Check;
+  }
+}
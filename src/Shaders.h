@@ -4,6 +4,11 @@
 #include "Util.h"
 #include "GraphicsUtil.h"
 
+//Data stores per container that can be colour mapped in the shaders
+#define MAX_COLOURMAP_SLOTS 32
+//Data stores per container that can be filtered in the shaders, and filters per store
+#define MAX_FILTER_SLOTS 16
+
 class Shader
 {
 private:
@@ -22,6 +27,7 @@ public:
 
   bool version();
   std::string read_file(const char *fname);
+  std::string defines(const std::string& src);
   bool compile(const char *src, GLuint type);
   bool build();
   void use();
@@ -31,6 +37,7 @@ public:
   void setUniform(const char* name, float value);
   void setUniformi(const char* name, int value);
   void setUniformf(const char* name, float value);
+  void setUniform4fv(const char* name, int count, const float* values);
 
   std::map<std::string, GLint> uniforms;
   std::map<std::string, GLint> attribs;
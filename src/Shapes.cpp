@@ -35,6 +35,17 @@
 
 #include "Geometry.h"
 
+//Interned ids of properties read in update()
+static const unsigned int gpucacheKey = PropertyKeys::id("gpucache");
+static const unsigned int shapewidthKey = PropertyKeys::id("shapewidth");
+static const unsigned int shapeheightKey = PropertyKeys::id("shapeheight");
+static const unsigned int shapelengthKey = PropertyKeys::id("shapelength");
+static const unsigned int shapeKey = PropertyKeys::id("shape");
+static const unsigned int pointsizeKey = PropertyKeys::id("pointsize");
+static const unsigned int widthbyKey = PropertyKeys::id("widthby");
+static const unsigned int heightbyKey = PropertyKeys::id("heightby");
+static const unsigned int lengthbyKey = PropertyKeys::id("lengthby");
+
 Shapes::Shapes(DrawState& drawstate) : Geometry(drawstate)
 {
   type = lucShapeType;
@@ -55,7 +66,7 @@ void Shapes::close()
 
 void Shapes::update()
 {
-  if (!reload && drawstate.global("gpucache")) return;
+  if (!reload && drawstate.global(gpucacheKey)) return;
   //Convert shapes to triangles
   tris->clear();
   tris->setView(view);
@@ -69,31 +80,35 @@ void Shapes::update()
     //Create a new data store for output geometry
     tris->add(geom[i]->draw);
 
-    float scaling = props["scaling"];
+    const ObjectSnapshot& snap = geom[i]->draw->snapshot();
+    float scaling = snap.scaling;
 
     //Load constant scaling factors from properties
     float dims[3];
-    dims[0] = props["shapewidth"];
-    dims[1] = props["shapeheight"];
-    dims[2] = props["shapelength"];
-    int shape = props["shape"];
+    dims[0] = props[shapewidthKey];
+    dims[1] = props[shapeheightKey];
+    dims[2] = props[shapelengthKey];
+    int shape = props[shapeKey];
     int quality = 4 * props.getInt("glyphs", 3);
     //Points drawn as shapes?
     if (!geom[i]->draw->properties.has("shape"))
     {
-      dims[0] = dims[1] = dims[2] = (float)props["pointsize"] / 8.0;
+      dims[0] = dims[1] = dims[2] = (float)props[pointsizeKey] / 8.0;
       quality = 4 * props.getInt("glyphs", 4);
     }
 
     if (scaling <= 0) scaling = 1.0;
+    scaling *= snap.scaleshapes;
 
-    Colour colour;
     geom[i]->colourCalibrate();
+    std::vector<Colour> colours(geom[i]->count);
+    geom[i]->fillColours(colours.data(), 0, geom[i]->count);
 
-    unsigned int idxW = geom[i]->valuesLookup(geom[i]->draw->properties["widthby"]);
-    unsigned int idxH = geom[i]->valuesLookup(geom[i]->draw->properties["heightby"]);
-    unsigned int idxL = geom[i]->valuesLookup(geom[i]->draw->properties["lengthby"]);
+    unsigned int idxW = geom[i]->valuesLookup(props[widthbyKey]);
+    unsigned int idxH = geom[i]->valuesLookup(props[heightbyKey]);
+    unsigned int idxL = geom[i]->valuesLookup(props[lengthbyKey]);
 
+    geom[i]->filterMask();
     for (unsigned int v=0; v < geom[i]->count; v++)
     {
       if (!drawable(i) || geom[i]->filter(v)) continue;
@@ -110,7 +125,7 @@ void Shapes::update()
       {
         if (dims[c] != FLT_MIN) sdims[c] *= dims[c];
         //Apply scaling, also inverse of model scaling to avoid distorting glyphs
-        sdims[c] *= scaling * (float)props["scaleshapes"] * tris->iscale[c];
+        sdims[c] *= scaling * tris->iscale[c];
       }
 
       //Setup orientation using alignment vector
@@ -132,15 +147,16 @@ void Shapes::update()
       }
 
       //Create shape
-      Vec3d pos = Vec3d(geom[i]->vertices[v]);
+      float vert[3];
+      geom[i]->vertices.get(v, vert);
+      Vec3d pos = Vec3d(vert);
       if (shape == 1)
         tris->drawCuboidAt(geom[i]->draw, pos, sdims, qrot);
       else
         tris->drawEllipsoid(geom[i]->draw, pos, sdims, qrot, quality);
 
       //Per shape colours (can do this as long as sub-renderer always outputs same tri count per shape)
-      geom[i]->getColour(colour, v);
-      tris->read(geom[i]->draw, 1, lucRGBAData, &colour.value);
+      tris->read(geom[i]->draw, 1, lucRGBAData, &colours[v].value);
     }
 
     //Adjust bounding box
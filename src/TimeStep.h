@@ -38,6 +38,13 @@
 
 #include "Geometry.h"
 
+//Geometry record data read ahead by the prefetch thread
+struct PrefetchRecord
+{
+  bool decoded;  //Decompressed already (not delta encoded), otherwise record data as stored
+  std::vector<unsigned char> data;
+};
+
 class TimeStep
 {
 public:
@@ -47,15 +54,35 @@ public:
 
   //Cached data
   std::vector<Geometry*> cache;
+  unsigned long used;  //Last access, for least recently used eviction
+  bool pinned;         //Never evict from cache
 
-  TimeStep(int step, float time, const std::string& path="") : step(step), time(time), path(path) {}
-  TimeStep() : step(0), time(0) {}
+  //Geometry record data read ahead by prefetch thread (by record id), used and freed on load
+  std::map<long long, PrefetchRecord> records;
+
+  TimeStep(int step, float time, const std::string& path="") : step(step), time(time), path(path), used(0), pinned(false) {}
+  TimeStep() : step(0), time(0), used(0), pinned(false) {}
 
   ~TimeStep()
+  {
+    clear();
+  }
+
+  void clear()
   {
     //Free cached geometry
     for (unsigned int i=0; i < cache.size(); i++)
       delete cache[i];
+    cache.clear();
+    records.clear();
+  }
+
+  long bytes()
+  {
+    //Memory held by the cached data, allocated from the step's own arena
+    //(data shared with other steps or fixed data not included, not freed with the step)
+    if (cache.size() == 0 || !cache[0]->arena) return 0;
+    return cache[0]->arena->held;
   }
 
   void write(std::vector<Geometry*> &data)
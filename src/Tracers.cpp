@@ -36,6 +36,17 @@
 #include "Geometry.h"
 #include "TimeStep.h"
 
+//Interned ids of properties read in update()
+static const unsigned int gpucacheKey = PropertyKeys::id("gpucache");
+static const unsigned int stepsKey = PropertyKeys::id("steps");
+static const unsigned int taperKey = PropertyKeys::id("taper");
+static const unsigned int fadeKey = PropertyKeys::id("fade");
+static const unsigned int glyphsKey = PropertyKeys::id("glyphs");
+static const unsigned int scalingKey = PropertyKeys::id("scaling");
+static const unsigned int scaletracersKey = PropertyKeys::id("scaletracers");
+static const unsigned int arrowheadKey = PropertyKeys::id("arrowhead");
+static const unsigned int flatKey = PropertyKeys::id("flat");
+
 Tracers::Tracers(DrawState& drawstate) : Geometry(drawstate)
 {
   type = lucTracerType;
@@ -59,7 +70,7 @@ void Tracers::close()
 
 void Tracers::update()
 {
-  if (!reload && drawstate.global("gpucache")) return;
+  if (!reload && drawstate.global(gpucacheKey)) return;
   //Convert tracers to triangles
   //All tracers stored as single vertex/value block
   //Contains vertex/value for every tracer particle at each timestep
@@ -86,7 +97,7 @@ void Tracers::update()
     int timesteps = (datasteps-1) * drawstate.gap + 1; //Multiply by gap between recorded steps
 
     //Per-Swarm step limit
-    int drawSteps = props["steps"];
+    int drawSteps = props[stepsKey];
     if (drawSteps > 0 && timesteps > drawSteps)
       timesteps = drawSteps;
 
@@ -101,6 +112,7 @@ void Tracers::update()
 
     //Calibrate colour maps on timestep if no value data
     bool timecolour = false;
+    std::vector<Colour> colours;
     ColourMap* cmap = geom[i]->draw->colourMap;
     if (cmap && !geom[i]->colourData())
     {
@@ -111,28 +123,31 @@ void Tracers::update()
     {
       //Calibrate colour map on provided value range
       geom[i]->colourCalibrate();
+      colours.resize(count);
+      geom[i]->fillColours(colours.data(), 0, count);
     }
 
     //Get properties
-    bool taper = props["taper"];
-    bool fade = props["fade"];
-    int quality = 4 * (int)props["glyphs"];
-    float size0 = props["scaling"];
+    bool taper = props[taperKey];
+    bool fade = props[fadeKey];
+    int quality = 4 * (int)props[glyphsKey];
+    float size0 = props[scalingKey];
     size0 *= 0.001;
     float limit = props.getFloat("limit", view->model_size * 0.3);
-    float factor = props["scaling"];
-    float scaling = props["scaletracers"];
+    float factor = props[scalingKey];
+    float scaling = props[scaletracersKey];
     factor *= scaling * drawstate.gap * 0.0005;
-    float arrowSize = props["arrowhead"];
+    float arrowSize = props[arrowheadKey];
+    bool flat = props[flatKey] || quality < 1;
+    geom[i]->filterMask();
     //Iterate individual tracers
     float size;
     for (unsigned int p=0; p < particles; p++)
     {
-      float* oldpos = NULL;
+      float pos[3], oldpos[3];
       Colour colour, oldColour;
       float radius, oldRadius = 0;
       size = size0;
-      bool flat = props["flat"] || quality < 1;
       //Loop through time steps
       for (int step=start; step <= end; step++)
       {
@@ -157,14 +172,14 @@ void Tracers::update()
         int pp = step * particles + pidx;
         if (!drawable(i) || geom[i]->filter(pp)) continue;
 
-        float* pos = geom[i]->vertices[pp];
+        geom[i]->vertices.get(pp, pos);
         //printf("p %d step %d POS = %f,%f,%f\n", p, step, pos[0], pos[1], pos[2]);
 
         //Get colour either from supplied colour values or time step
         if (timecolour)
           colour = cmap->getfast(drawstate.timesteps[step]->time);
         else
-          geom[i]->getColour(colour, pp);
+          colour = colours[pp];
 
         //Fade out
         if (fade) colour.a = 255 * (step-start) / (float)(end-start);
@@ -176,10 +191,13 @@ void Tracers::update()
         {
           if (flat)
           {
-            lines->read(geom[i]->draw, 1, lucVertexData, oldpos);
-            lines->read(geom[i]->draw, 1, lucVertexData, pos);
-            lines->read(geom[i]->draw, 1, lucRGBAData, &oldColour);
-            lines->read(geom[i]->draw, 1, lucRGBAData, &colour);
+            GeomSpan span = lines->append(geom[i]->draw, 2, 0, false);
+            memcpy(span.vertices, oldpos, sizeof(float) * 3);
+            memcpy(span.vertices + 3, pos, sizeof(float) * 3);
+            lines->commit(span);
+            unsigned int* cols = (unsigned int*)lines->reserve(geom[i]->draw, 2, lucRGBAData, span.geom);
+            cols[0] = oldColour.value;
+            cols[1] = colour.value;
           }
           else
           {
@@ -190,19 +208,21 @@ void Tracers::update()
             tris->drawTrajectory(geom[i]->draw, oldpos, pos, oldRadius, radius, arrowHead, view->scale, limit, quality);
             diff = tris->getVertexIdx(geom[i]->draw) - diff;
             //Per vertex colours
+            GeomData* gd;
+            unsigned int* cols = diff > 0 ? (unsigned int*)tris->reserve(geom[i]->draw, diff, lucRGBAData, gd) : NULL;
             for (int c=0; c<diff; c++)
             {
               //Top of shaft and arrowhead use current colour, others (base) use previous
               //(Every second vertex is at top of shaft, first quality*2 are shaft verts)
               Colour& col = oldColour;
               if (c%2==1 || c > quality*2) col = colour;
-              tris->read(geom[i]->draw, 1, lucRGBAData, &col);
+              cols[c] = col.value;
             }
           }
         }
 
         //oldtime = time;
-        oldpos = pos;
+        memcpy(oldpos, pos, sizeof(pos));
         oldRadius = radius;
         oldColour = colour;
       }
@@ -238,7 +238,12 @@ void TriSurfaces::loadMesh()
       geom[index]->data[lucIndexData] = &geom[index]->indices;
       FloatValues* oldvalues = geom[index]->colourData();
       if (oldvalues)
-        geom[index]->values[geom[index]->draw->colourIdx] = new FloatValues();
+      {
+        //Empty until re-written, so colourData() would return NULL here
+        FloatValues* newvalues = new FloatValues();
+        newvalues->setArena(geom[index]->arena);
+        geom[index]->values[geom[index]->draw->colourIdx] = newvalues;
+      }
       bool optimise = geom[index]->draw->properties["optimise"];
       for (unsigned int v=0; v<verts.size(); v++)
       {
@@ -252,9 +257,11 @@ void TriSurfaces::loadMesh()
           //Average final colour
           if (vertColour && oldvalues)
           {
-            read(geom[index]->draw, 1, &oldvalues->value[verts[v].id], "Default");
+            float value;
+            oldvalues->decode(verts[v].id, 1, &value); //(decoded if compact)
+            read(geom[index]->draw, 1, &value, "Default");
             if (verts[v].vcount > 1)
-              geom[index]->colourData()->value[geom[index]->count] /= verts[v].vcount;
+              geom[index]->colourData()->at(geom[index]->count) /= verts[v].vcount;
           }
 
           //Save an index lookup entry (Grid indices loaded in previous step)
@@ -329,6 +336,7 @@ void TriSurfaces::loadList()
     //Calibrate colour maps on range for this surface
     //(also required for filtering by map)
     //geom[index]->colourCalibrate();
+    if (!internal) geom[index]->filterMask();
 
     for (unsigned int t = 0; t < geom[index]->indices.size(); t+=3, offset++)
     {
@@ -375,6 +383,9 @@ void TriSurfaces::loadBuffers()
   unsigned char *p, *ptr;
   ptr = p = NULL;
   unsigned int datasize = sizeof(float) * 8 + sizeof(Colour);   //Vertex(3), normal(3), texCoord(2) and 32-bit colour
+  bool values = loadColourSlots();
+  if (values)
+    datasize += sizeof(float) * 2;   //Raw colour value and slot for mapping in shader
   unsigned int vcount = 0;
   for (unsigned int index = 0; index < geom.size(); index++)
     vcount += geom[index]->count;
@@ -415,17 +426,20 @@ void TriSurfaces::loadBuffers()
     float shift = vshift * 0.0001 * index * view->model_size;
     if (geom[index]->draw->name().length() == 0) shift = 0.0; //Skip built in objects
     std::array<float,3> shiftvert;
+    //Have colour values but not enough for per-vertex, spread over range (eg: per triangle)
+    //Colours are mapped here unless the shader can map the raw values
+    int slot = colourSlot(index);
+    unsigned int ccount = geom[index]->count ? (geom[index]->count - 1) / colrange + 1 : 0;
+    std::vector<Colour> colours(slot < 0 ? ccount : 0);
+    std::vector<float> cvalues(slot < 0 ? 0 : ccount);
+    if (slot < 0)
+      geom[index]->fillColours(colours.data(), 0, ccount);
+    else
+      geom[index]->fillValues(cvalues.data(), 0, ccount);
+    colour.value = 0;
     for (unsigned int v=0; v < geom[index]->count; v++)
     {
-      if (colrange <= 1)
-        geom[index]->getColour(colour, v);
-      else
-      {
-        //Have colour values but not enough for per-vertex, spread over range (eg: per triangle)
-        unsigned int cidx = v / colrange;
-        if (cidx * colrange == v)
-          geom[index]->getColour(colour, cidx);
-      }
+      if (slot < 0) colour = colours[v / colrange];
 
       float* vert = geom[index]->vertices[v];
       if (shift > 0)
@@ -454,6 +468,12 @@ void TriSurfaces::loadBuffers()
       //Copies colour bytes
       memcpy(ptr, &colour, sizeof(Colour));
       ptr += sizeof(Colour);
+      if (values)
+      {
+        float cv[2] = {slot < 0 ? 0.0f : cvalues[v / colrange], (float)slot};
+        memcpy(ptr, cv, sizeof(float) * 2);
+        ptr += sizeof(float) * 2;
+      }
     }
     t2 = clock();
     debug_print("  %.4lf seconds to reload %d vertices\n", (t2-t1)/(double)CLOCKS_PER_SEC, geom[index]->count);
@@ -552,7 +572,7 @@ void TriSurfaces::calcTriangleNormals(int index, std::vector<Vertex> &verts, std
 
         //Colour value, add to matched
         if (vertColour && geom[index]->colourData())
-          geom[index]->colourData()->value[verts[match].id] += geom[index]->colourData()->value[verts[v].id];
+          geom[index]->colourData()->at(verts[match].id) += (*geom[index]->colourData())[verts[v].id];
 
         verts[match].vcount++;
         verts[v].vcount = 0;
@@ -564,6 +584,9 @@ void TriSurfaces::calcTriangleNormals(int index, std::vector<Vertex> &verts, std
       match = v;
     }
   }
+  //Colour values summed in place, one revision change for all of them
+  if (vertColour && geom[index]->colourData())
+    geom[index]->colourData()->modified();
   t2 = clock();
   debug_print("  %.4lf seconds to replace duplicates (%d/%d) \n", (t2-t1)/(double)CLOCKS_PER_SEC, dupcount, verts.size());
   t1 = clock();
@@ -810,6 +833,8 @@ void TriSurfaces::draw()
   clock_t t1 = clock();
   double time;
   int stride = 8 * sizeof(float) + sizeof(Colour);   //3+3+2 vertices, normals, texCoord + 32-bit colour
+  if (colourslots.size())
+    stride += 2 * sizeof(float);   //+ raw colour value and slot
   glBindBuffer(GL_ARRAY_BUFFER, vbo);
   glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexvbo);
   if (geom.size() > 0 && elements > 0 && glIsBuffer(vbo) && glIsBuffer(indexvbo))
@@ -822,6 +847,7 @@ void TriSurfaces::draw()
     glEnableClientState(GL_NORMAL_ARRAY);
     glEnableClientState(GL_TEXTURE_COORD_ARRAY);
     glEnableClientState(GL_COLOR_ARRAY);
+    GLint aColourValue = useColourMaps(drawstate.prog[lucTriangleType], stride, 8*sizeof(float) + sizeof(Colour));
 
     unsigned int start = 0;
     //Reverse order of objects to match index array layout (opaque objects last)
@@ -868,6 +894,7 @@ void TriSurfaces::draw()
     time = ((clock()-t1)/(double)CLOCKS_PER_SEC);
     if (time > 0.005) debug_print("  %.4lf seconds to draw %d transparent triangles\n", time, (elements-start)/3);
 
+    releaseColourMaps(aColourValue);
     glDisableClientState(GL_VERTEX_ARRAY);
     glDisableClientState(GL_NORMAL_ARRAY);
     glDisableClientState(GL_TEXTURE_COORD_ARRAY);
@@ -40,8 +40,194 @@
 
 FILE* infostream = NULL;
 
-long membytes__ = 0;
-long mempeak__ = 0;
+std::atomic<long> DataArena::used(0);
+std::atomic<long> DataArena::peak(0);
+std::atomic<long> DataArena::reserved(0);
+std::atomic<unsigned int> DataContainer::revisions(0);
+
+static inline size_t arenaAlign(size_t bytes)
+{
+  return (bytes + 15) & ~(size_t)15;
+}
+
+DataArena::~DataArena()
+{
+  //Any remaining slabs freed together
+  for (auto& slab : slabs)
+  {
+    free(slab.data);
+    reserved -= ARENA_SLAB_SIZE;
+  }
+}
+
+void DataArena::reset()
+{
+  std::lock_guard<std::mutex> guard(mutex);
+  for (unsigned int i=1; i<slabs.size(); i++)
+  {
+    free(slabs[i].data);
+    reserved -= ARENA_SLAB_SIZE;
+    held -= ARENA_SLAB_SIZE;
+  }
+  if (slabs.size() > 1)
+    slabs.resize(1);
+  if (slabs.size())
+    slabs[0].top = 0;
+}
+
+void* DataArena::allocate(DataArena* arena, size_t bytes)
+{
+  //Large allocations and those without an arena use their own block
+  void* p;
+  if (arena && bytes < ARENA_BLOCK_MIN)
+    p = arena->alloc(bytes);
+  else
+  {
+    p = malloc(bytes);
+    reserved += bytes;
+    if (arena) arena->held += bytes;
+  }
+  if (!p) throw std::bad_alloc();
+  used += bytes;
+  if (used > peak) peak = used.load();
+  return p;
+}
+
+void DataArena::deallocate(DataArena* arena, void* p, size_t bytes)
+{
+  used -= bytes;
+  if (arena && bytes < ARENA_BLOCK_MIN)
+    arena->release(p, bytes);
+  else
+  {
+    free(p);
+    reserved -= bytes;
+    if (arena) arena->held -= bytes;
+  }
+}
+
+void* DataArena::alloc(size_t bytes)
+{
+  std::lock_guard<std::mutex> guard(mutex);
+  bytes = arenaAlign(bytes);
+  if (slabs.size() == 0 || slabs.back().top + bytes > ARENA_SLAB_SIZE)
+  {
+    Slab slab = {(char*)malloc(ARENA_SLAB_SIZE), 0};
+    if (!slab.data) return NULL;
+    reserved += ARENA_SLAB_SIZE;
+    held += ARENA_SLAB_SIZE;
+    slabs.push_back(slab);
+  }
+  Slab& slab = slabs.back();
+  void* p = slab.data + slab.top;
+  slab.top += bytes;
+  return p;
+}
+
+void DataArena::release(void* p, size_t bytes)
+{
+  //Space is only reclaimed when the whole step is reset/freed,
+  //except the most recent allocation (eg: store growing) which is re-used
+  std::lock_guard<std::mutex> guard(mutex);
+  bytes = arenaAlign(bytes);
+  if (slabs.size() == 0) return;
+  Slab& slab = slabs.back();
+  if ((char*)p + bytes == slab.data + slab.top)
+    slab.top -= bytes;
+}
+
+bool FloatValues::compact(int mode)
+{
+  //Replace the float data with a 16-bit encoding scaled to the range of each component,
+  //data shared with other stores is left as is (already stored only once)
+  if (packed || next == 0 || datasize > 3 || shared()) return false;
+  float min[3] = {HUGE_VALF, HUGE_VALF, HUGE_VALF};
+  float max[3] = {-HUGE_VALF, -HUGE_VALF, -HUGE_VALF};
+  for (unsigned int i=0; i<next; i++)
+  {
+    float v = (*store)[i];
+    if (!std::isfinite(v)) continue;
+    unsigned int c = i % datasize;
+    if (v < min[c]) min[c] = v;
+    if (v > max[c]) max[c] = v;
+  }
+
+  for (unsigned int c=0; c<datasize; c++)
+  {
+    if (min[c] > max[c]) min[c] = max[c] = 0;
+    float range = max[c] - min[c];
+    packoffset[c] = min[c];
+    if (mode == COMPACT_QUANTISE)
+      packscale[c] = range / 65535.0f;
+    else
+      packscale[c] = range > 0 ? range : 1.0f; //(zero range: keeps inf/nan values)
+  }
+
+  packed = std::make_shared<DataStore<unsigned short> >(ArenaAllocator<unsigned short>(arena));
+  packed->resize(next);
+  for (unsigned int i=0; i<next; i++)
+  {
+    unsigned int c = i % datasize;
+    float v = (*store)[i];
+    if (mode == COMPACT_QUANTISE)
+    {
+      float q = packscale[c] > 0 ? (v - packoffset[c]) / packscale[c] + 0.5f : 0.0f;
+      if (!(q > 0)) q = 0; //(also nan)
+      if (q > 65535) q = 65535;
+      (*packed)[i] = (unsigned short)q;
+    }
+    else
+      (*packed)[i] = floatToHalf((v - packoffset[c]) / packscale[c]);
+  }
+
+  packmode = mode;
+  store = create();
+  //(values now at reduced precision)
+  modified();
+  return true;
+}
+
+void FloatValues::expand()
+{
+  //Restore float data from compact storage, at the reduced precision
+  if (!packed) return;
+  std::shared_ptr<DataStore<float> > full = create();
+  full->resize(next);
+  for (unsigned int i=0; i<next; i++)
+    (*full)[i] = unpack(i);
+  store = full;
+  packed = NULL;
+  packmode = 0;
+}
+
+bool FloatValues::share(DataContainer* other)
+{
+  FloatValues* src = dynamic_cast<FloatValues*>(other);
+  if (!src || !src->packed)
+  {
+    expand();
+    return DataValues::share(other);
+  }
+
+  if (next == 0)
+  {
+    //Share the compact data
+    DataValues::share(other);
+    packed = src->packed;
+    packmode = src->packmode;
+    memcpy(packoffset, src->packoffset, sizeof(packoffset));
+    memcpy(packscale, src->packscale, sizeof(packscale));
+  }
+  else
+  {
+    //Append decoded copy
+    std::vector<float> data(src->next);
+    src->decode(0, src->next, &data[0]);
+    expand();
+    DataValues::read(src->next, &data[0]);
+  }
+  return true;
+}
 
 void abort_program(const char * s, ...)
 {
@@ -106,6 +292,56 @@ std::string GetBinaryPath(const char* argv0, const char* progname)
   return bpath;
 }
 
+std::atomic<unsigned int> Properties::version(1);
+std::atomic<unsigned int> Properties::globalversion(1);
+
+std::unordered_map<std::string, unsigned int>& PropertyKeys::ids()
+{
+  //Function statics, safe to intern from static initialisers in any unit
+  static std::unordered_map<std::string, unsigned int> table;
+  return table;
+}
+
+std::vector<std::string>& PropertyKeys::names()
+{
+  static std::vector<std::string> list;
+  return list;
+}
+
+unsigned int PropertyKeys::id(const std::string& key)
+{
+  std::unordered_map<std::string, unsigned int>& table = ids();
+  auto it = table.find(key);
+  if (it != table.end()) return it->second;
+  unsigned int id = names().size();
+  names().push_back(key);
+  table[key] = id;
+  return id;
+}
+
+const json* PropertyCache::get(unsigned int id, unsigned int current)
+{
+  if (version != current)
+  {
+    std::fill(valid.begin(), valid.end(), false);
+    version = current;
+  }
+  if (id < valid.size() && valid[id]) return &values[id];
+  return NULL;
+}
+
+const json& PropertyCache::set(unsigned int id, const json& value)
+{
+  if (id >= values.size())
+  {
+    values.resize(PropertyKeys::count());
+    valid.resize(PropertyKeys::count(), false);
+  }
+  values[id] = value;
+  valid[id] = true;
+  return values[id];
+}
+
 void Properties::toFloatArray(const json& val, float* array, unsigned int size)
 {
   //Convert to a float array
@@ -132,6 +368,14 @@ json& Properties::operator[](const std::string& key)
   return defaults[key];
 }
 
+const json& Properties::operator[](unsigned int id)
+{
+  //Resolve through the layers once, then serve from the flat cache
+  const json* value = cache.get(id, current());
+  if (value) return *value;
+  return cache.set(id, (*this)[PropertyKeys::name(id)]);
+}
+
 //Functions to get values with provided defaults
 Colour Properties::getColour(const std::string& key, unsigned char red, unsigned char green, unsigned char blue, unsigned char alpha)
 {
@@ -190,6 +434,10 @@ void Properties::parse(const std::string& property, bool global)
   value = property.substr(pos+1);
   if (value.length() > 0)
   {
+    if (global)
+      changed();
+    else
+      modified();
     //Ignore case
     std::transform(key.begin(), key.end(), key.begin(), ::tolower);
     //std::cerr << "Key " << key << " == " << value << std::endl;
@@ -236,9 +484,23 @@ void Properties::parse(const std::string& property, bool global)
   }
 }
 
+void Properties::set(const std::string& key, const json& value)
+{
+  //Only a new value invalidates snapshots, safe to call every frame
+  if (data.count(key) && data[key] == value) return;
+  data[key] = value;
+  modified();
+}
+
+void Properties::erase(const std::string& key)
+{
+  if (data.erase(key)) modified();
+}
+
 void Properties::merge(json& other)
 {
   //Merge: keep existing values, replace any imported
+  modified();
   for (json::iterator it = other.begin() ; it != other.end(); ++it)
   {
     if (!it.value().is_null())
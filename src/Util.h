@@ -112,8 +112,69 @@ public:
 std::string GetBinaryPath(const char* argv0, const char* progname);
 
 //General purpose geometry data store types...
-extern long membytes__;
-extern long mempeak__;
+
+//Slab allocator for the data stores of a set of geometry (one timestep),
+//small stores are carved from contiguous slabs, large ones get their own block,
+//slab space is not freed per allocation, the slabs are reset together once the
+//step is done with (stores keep their arena alive, so data shared with other
+//steps stays valid until the last of them is freed)
+#define ARENA_SLAB_SIZE (1 << 20)
+#define ARENA_BLOCK_MIN (ARENA_SLAB_SIZE / 4)
+class DataArena
+{
+  struct Slab
+  {
+    char* data;
+    size_t top;   //Next free byte
+  };
+  std::vector<Slab> slabs; //Last is current
+  std::mutex mutex;
+
+  void* alloc(size_t bytes);
+  void release(void* p, size_t bytes);
+
+public:
+  std::atomic<long> held; //Bytes held for stores of this arena, slabs and large blocks
+
+  DataArena() : held(0) {}
+  ~DataArena();
+
+  //Free the whole step at once, keeps the first slab for re-use
+  //(only valid once no store allocated from the arena remains)
+  void reset();
+
+  //Allocate / free from an arena, or the heap if NULL
+  static void* allocate(DataArena* arena, size_t bytes);
+  static void deallocate(DataArena* arena, void* p, size_t bytes);
+
+  //Memory usage of all data stores
+  //(counters are atomic as stores may be loaded on the prefetch thread)
+  static std::atomic<long> used;     //Bytes allocated to stores
+  static std::atomic<long> peak;     //Maximum bytes allocated
+  static std::atomic<long> reserved; //Bytes held in slabs and blocks, includes unused slab space
+  static float fragmentation()
+  {
+    //Fraction of reserved memory not in use
+    long r = reserved;
+    return r > 0 ? 1.0 - used / (double)r : 0.0;
+  }
+};
+
+template <class dtype> class ArenaAllocator
+{
+public:
+  typedef dtype value_type;
+  std::shared_ptr<DataArena> arena;
+
+  ArenaAllocator(const std::shared_ptr<DataArena>& arena=NULL) : arena(arena) {}
+  template <class other> ArenaAllocator(const ArenaAllocator<other>& a) : arena(a.arena) {}
+
+  dtype* allocate(size_t n) {return (dtype*)DataArena::allocate(arena.get(), n * sizeof(dtype));}
+  void deallocate(dtype* p, size_t n) {DataArena::deallocate(arena.get(), p, n * sizeof(dtype));}
+
+  template <class other> bool operator==(const ArenaAllocator<other>& a) const {return arena == a.arena;}
+  template <class other> bool operator!=(const ArenaAllocator<other>& a) const {return arena != a.arena;}
+};
 
 class DataContainer
 {
@@ -126,17 +187,28 @@ public:
   float minimum;
   float maximum;
   std::string label;
+  //Stamp changed whenever the data may have been modified, unique across all stores
+  //so results derived from a store can be keyed on it (eg: filter masks)
+  unsigned int revision;
+  static std::atomic<unsigned int> revisions;
+
+  DataContainer() : next(0), datasize(1), offset(0), generated(false), minimum(0), maximum(1), label("Default"), revision(++revisions) {}
 
-  DataContainer() : next(0), datasize(1), offset(0), generated(false), minimum(0), maximum(1), label("Default") {}
+  void modified() {revision = ++revisions;}
 
   //Pure virtual methods
   virtual unsigned int bytes() = 0;
   virtual void read(unsigned int n, const void* data) = 0;
+  virtual void* append(unsigned int n) = 0;
   virtual void resize(unsigned long size) = 0;
   virtual void clear() = 0;
   virtual void setOffset() = 0;
   virtual void erase(unsigned int start, unsigned int end) = 0;
   virtual void* ref(unsigned i=0) = 0;
+  virtual bool fits(unsigned int n) = 0;
+  virtual bool share(DataContainer* other) = 0;
+  virtual bool shared() = 0;
+  virtual void setArena(const std::shared_ptr<DataArena>& a) = 0;
 
   void setup(float min, float max)
   {
@@ -165,85 +237,325 @@ public:
   }
 };
 
+template <class dtype> using DataStore = std::vector<dtype, ArenaAllocator<dtype> >;
+
 template <class dtype> class DataValues : public DataContainer
 {
+protected:
+  std::shared_ptr<DataArena> arena; //Allocator for new data, heap if NULL (declared first, used by create())
+  //Data, may be shared read-only with other stores holding identical data
+  //(eg: same record in other timesteps), copied before any modification
+  std::shared_ptr<DataStore<dtype> > store;
+
+  std::shared_ptr<DataStore<dtype> > create()
+  {
+    return std::make_shared<DataStore<dtype> >(ArenaAllocator<dtype>(arena));
+  }
+
 public:
-  std::vector<dtype> value;
+  DataValues() : store(create()) {}
+  //Copies share data until either is modified
+  DataValues(const DataValues& other) : DataContainer(other), arena(other.arena), store(other.store) {}
 
-  DataValues() {}
-  virtual ~DataValues() {};
+  virtual ~DataValues() {}
+
+  DataValues& operator=(const DataValues& other)
+  {
+    //(new data still allocated from own arena)
+    DataContainer::operator=(other);
+    store = other.store;
+    return *this;
+  }
 
   unsigned int bytes() {return sizeof(dtype)*size();}
 
   virtual void read(unsigned int n, const void* data)
   {
     unsigned int size = next + n;
-    unsigned int oldsize = value.size();
+    unsigned int oldsize = store->size();
     if (oldsize < size)
     {
       //Always at least double size for efficiency
       if (size < oldsize*2) size = oldsize*2;
       resize(size);
     }
-    memcpy(&value[next], data, n * sizeof(dtype));
+    unshare();
+    modified();
+    memcpy(&(*store)[next], data, n * sizeof(dtype));
+    next += n;
+  }
+
+  void* append(unsigned int n)
+  {
+    //Extend by exactly n data units (no doubling) and return the
+    //uninitialised destination so caller can load data in place
+    if (n == 0) return NULL;
+    n *= datasize;
+    resize(next + n);
+    unshare();
+    modified();
+    void* dest = &(*store)[next];
     next += n;
+    return dest;
   }
 
   inline dtype operator[] (unsigned i)
   {
-    //if (i >= value.size())
-    //   abort_program("Out of bounds %d -- %d (max idx %d)\n", i, i, value.size()-1);
-    return value[i];
+    //if (i >= store->size())
+    //   abort_program("Out of bounds %d -- %d (max idx %d)\n", i, i, store->size()-1);
+    return (*store)[i];
+  }
+
+  dtype& at(unsigned i)
+  {
+    //Writable element (revision not changed per element, call modified() once
+    // after writing to data not just appended, as for ref())
+    unshare();
+    return (*store)[i];
   }
 
   void* ref (unsigned i=0)
   {
-    return (void*)&value[i];
+    //(NOTE: no copy of shared data, only write to space just appended or after unshare(),
+    // revision not changed as used for reads, call modified() after writing other data)
+    return (void*)&(*store)[i];
+  }
+
+  bool fits(unsigned int n)
+  {
+    //True if n data units can be appended without moving the existing data
+    return !shared() && store->capacity() >= next + n * datasize;
   }
 
   void resize(unsigned long size)
   {
-    unsigned int oldsize = value.size();
+    unsigned int oldsize = store->size();
     if (oldsize < size)
     {
-      value.resize(size);
-      membytes__ += sizeof(dtype)*(size-oldsize);
-      if (membytes__ > mempeak__) mempeak__ = membytes__;
-      //printf("============== MEMORY total %.3f mb, added %d ==============\n", membytes__/1000000.0f, (size-oldsize));
+      unshare();
+      store->resize(size);
+      //printf("============== MEMORY total %.3f mb, added %d ==============\n", DataArena::used/1000000.0f, (size-oldsize));
     }
   }
 
   void clear()
   {
-    unsigned int count = value.size();
+    unsigned int count = store->size();
     if (count == 0) return;
-    value.clear();
+    //Release data (shared data left intact for other stores)
+    store = create();
+    modified();
     offset = 0;
-    membytes__ -= sizeof(dtype)*count;
     next = 0;
-    //printf("============== MEMORY total %.3f mb, removed %d ==============\n", membytes__/1000000.0f, count);
+    //printf("============== MEMORY total %.3f mb, removed %d ==============\n", DataArena::used/1000000.0f, count);
   }
 
   //Update saved position
   void setOffset()
   {
-    offset = value.size();
+    offset = store->size();
   }
 
   void erase(unsigned int start, unsigned int end)
   {
     //erase elements:
-    value.erase(value.begin()+start, value.begin()+end);
+    unshare();
+    modified();
+    store->erase(store->begin()+start, store->begin()+end);
     if (offset > 0) offset -= start;
-    membytes__ -= sizeof(dtype)*(end - start);
-    //printf("============== MEMORY total %.3f mb, erased %d ==============\n", membytes__/1000000.0f, (end - start));
+    //printf("============== MEMORY total %.3f mb, erased %d ==============\n", DataArena::used/1000000.0f, (end - start));
+  }
+
+  bool share(DataContainer* other)
+  {
+    //Use data of another store of the same type, without copying if this store is empty,
+    //otherwise appended as a copy
+    DataValues* src = dynamic_cast<DataValues*>(other);
+    if (!src) return false;
+    if (next == 0)
+    {
+      store = src->store;
+      next = src->next;
+      modified();
+    }
+    else if (src->next > 0)
+      DataValues::read(src->next, &(*src->store)[0]);
+    return true;
+  }
+
+  bool shared()
+  {
+    return store.use_count() > 1;
+  }
+
+  void unshare()
+  {
+    //Copy shared data before modifying
+    if (shared())
+    {
+      std::shared_ptr<DataStore<dtype> > copy = create();
+      copy->assign(store->begin(), store->end());
+      store = copy;
+    }
+  }
+
+  void setArena(const std::shared_ptr<DataArena>& a)
+  {
+    //Allocate new data from given arena
+    arena = a;
+    if (store->capacity() == 0 && !shared())
+      store = create();
   }
 };
 
+//IEEE 754 half precision conversion (round to nearest, inf/nan preserved)
+inline unsigned short floatToHalf(float f)
+{
+  uint32_t x;
+  memcpy(&x, &f, sizeof(float));
+  unsigned short sign = (x >> 16) & 0x8000;
+  x &= 0x7fffffff;
+  if (x >= 0x7f800000) return sign | 0x7c00 | (x > 0x7f800000 ? 0x200 : 0); //Inf/NaN
+  if (x >= 0x477ff000) return sign | 0x7c00; //Overflow, >= 65520
+  if (x >= 0x38800000) return sign | ((x - 0x38000000 + 0x1000) >> 13); //Normal
+  if (x < 0x33000000) return sign; //Underflow, < 2^-25
+  //Subnormal
+  unsigned int shift = 126 - (x >> 23);
+  unsigned int m = (x & 0x7fffff) | 0x800000;
+  return sign | ((m + (1 << (shift-1))) >> shift);
+}
+
+inline float halfToFloat(unsigned short h)
+{
+  uint32_t x = (uint32_t)(h & 0x8000) << 16;
+  uint32_t e = (h >> 10) & 0x1f;
+  uint32_t m = h & 0x3ff;
+  if (e == 0x1f)
+    x |= 0x7f800000 | (m << 13); //Inf/NaN
+  else if (e)
+    x |= ((e + 112) << 23) | (m << 13); //Normal
+  else if (m)
+  {
+    //Subnormal, normalise
+    e = 113;
+    while (!(m & 0x400))
+    {
+      m <<= 1;
+      e--;
+    }
+    x |= (e << 23) | ((m & 0x3ff) << 13);
+  }
+  float f;
+  memcpy(&f, &x, sizeof(float));
+  return f;
+}
+
+//Compact storage modes
+#define COMPACT_QUANTISE 1 //16-bit integers spanning the range of each component (error <= range/131070)
+#define COMPACT_HALF 2     //Half floats of values normalised to their range (error <= range/4096)
+
 class FloatValues : public DataValues<float>
 {
- public:
-  FloatValues() {}
+protected:
+  //Compact 16-bit encoding of the data with a scale and offset per component,
+  //replaces the float store when present, read-only so may be shared by copies
+  std::shared_ptr<DataStore<unsigned short> > packed;
+  int packmode;
+  float packoffset[3];
+  float packscale[3];
+
+  inline float unpack(unsigned i) const
+  {
+    unsigned int c = i % datasize;
+    float p = packmode == COMPACT_HALF ? halfToFloat((*packed)[i]) : (float)(*packed)[i];
+    return packoffset[c] + p * packscale[c];
+  }
+
+public:
+  FloatValues() : packmode(0) {}
+
+  inline float operator[] (unsigned i)
+  {
+    if (packed) return unpack(i);
+    return (*store)[i];
+  }
+
+  //Copy n elements from index i, decoded if compact (without restoring the float store),
+  //the read path for data that may be compact, safe to call concurrently
+  void decode(unsigned i, unsigned n, float* dest) const
+  {
+    if (!packed)
+      memcpy(dest, &(*store)[i], n * sizeof(float));
+    else
+      for (unsigned int j=0; j<n; j++)
+        dest[j] = unpack(i + j);
+  }
+
+  bool compact(int mode);
+  void expand();
+
+  bool compacted()
+  {
+    return packed != nullptr;
+  }
+
+  //Writes restore the float store from compact storage first,
+  //pointer access with ref() is to the float store only (use decode() if compact)
+  float& at(unsigned i)
+  {
+    //Writable element (no readers, use operator[] or decode())
+    expand();
+    return DataValues::at(i);
+  }
+
+  virtual void read(unsigned int n, const void* data)
+  {
+    expand();
+    DataValues::read(n, data);
+  }
+
+  void* append(unsigned int n)
+  {
+    expand();
+    return DataValues::append(n);
+  }
+
+  bool fits(unsigned int n)
+  {
+    return !packed && DataValues::fits(n);
+  }
+
+  void resize(unsigned long size)
+  {
+    expand();
+    DataValues::resize(size);
+  }
+
+  void clear()
+  {
+    packed = NULL;
+    packmode = 0;
+    DataValues::clear();
+  }
+
+  void setOffset()
+  {
+    expand();
+    DataValues::setOffset();
+  }
+
+  void erase(unsigned int start, unsigned int end)
+  {
+    expand();
+    DataValues::erase(start, end);
+  }
+
+  bool share(DataContainer* other);
+
+  bool shared()
+  {
+    return DataValues::shared() || packed.use_count() > 1;
+  }
 };
 
 class UIntValues : public DataValues<unsigned int>
@@ -273,9 +585,18 @@ public:
 
   inline float* operator[] (unsigned i)
   {
-    //if (i*3 >= value.size())
-    //   abort_program("Out of bounds %d -- %d (max idx %d)\n", i, i*3, value.size()-1);
-    return &value[i * 3];
+    //if (i*3 >= store->size())
+    //   abort_program("Out of bounds %d -- %d (max idx %d)\n", i, i*3, store->size()-1);
+    //Writable pointer into the float store, restored first if compact as at() does
+    //(readers use get(), which leaves compact data as it is)
+    expand();
+    return &(*store)[i * 3];
+  }
+
+  //Copy of a vertex, decoded if compact
+  void get(unsigned i, float* dest) const
+  {
+    decode(i * 3, 3, dest);
   }
 };
 
@@ -294,21 +615,60 @@ public:
 
   inline float* operator[] (unsigned i)
   {
-    //if (i*2 >= value.size())
-    //   abort_program("Out of bounds %d -- %d (max idx %d)\n", i, i*2, value.size()-1);
-    return &value[i * 2];
+    //if (i*2 >= store->size())
+    //   abort_program("Out of bounds %d -- %d (max idx %d)\n", i, i*2, store->size()-1);
+    //Float store restored first if compact, as at() does
+    expand();
+    return &(*store)[i * 2];
   }
 };
 
 //JSON Property set wrapper class
+//Interned property keys, integer ids index the flat resolved-value caches
+class PropertyKeys
+{
+  static std::unordered_map<std::string, unsigned int>& ids();
+  static std::vector<std::string>& names();
+
+public:
+  static unsigned int id(const std::string& key);
+  static const std::string& name(unsigned int id) {return names()[id];}
+  static unsigned int count() {return names().size();}
+};
+
+//Resolved property values by key id, all entries invalid once the version passed in changes
+//(not synchronised, main thread only: the prefetch, inflate and export workers read no properties)
+class PropertyCache
+{
+  std::deque<json> values; //Deque: growing keeps returned references valid
+  std::vector<bool> valid;
+  unsigned int version;
+
+public:
+  PropertyCache() : version(0) {}
+
+  const json* get(unsigned int id, unsigned int current);
+  const json& set(unsigned int id, const json& value);
+};
+
 class Properties
 {
+  PropertyCache cache;
+
 public:
   json& globals;
   json& defaults;
   json data;
+  //Incremented on any property change (atomic, may be read from worker threads)
+  //Writes through set()/erase()/parse()/merge() bump it, direct writes to the json
+  //must call modified() (or changed() for globals/defaults) afterwards
+  static std::atomic<unsigned int> version;
+  //Version of the last change to the globals or defaults, seen by every object
+  static std::atomic<unsigned int> globalversion;
+  //Version of the last change to this object's own data
+  unsigned int revision;
 
-  Properties(json& globals, json& defaults) : globals(globals), defaults(defaults)
+  Properties(json& globals, json& defaults) : globals(globals), defaults(defaults), revision(0)
   {
     data = json::object();
   }
@@ -317,6 +677,7 @@ public:
 
   bool has(const std::string& key);
   json& operator[](const std::string& key);
+  const json& operator[](unsigned int id);
   Colour getColour(const std::string& key, unsigned char red=0, unsigned char green=0, unsigned char blue=0, unsigned char alpha=255);
   float getFloat(const std::string& key, float def);
   int getInt(const std::string& key, int def);
@@ -324,6 +685,16 @@ public:
   void parseSet(const std::string& properties);
   void parse(const std::string& property, bool global=false);
   void merge(json& other);
+  void set(const std::string& key, const json& value);
+  void erase(const std::string& key);
+  void modified() {revision = ++version;}
+  static void changed() {globalversion = ++version;}
+  //Last change to any value resolved through this object, cached snapshots compare against this
+  unsigned int current()
+  {
+    unsigned int global = globalversion;
+    return revision > global ? revision : global;
+  }
 
 };
 
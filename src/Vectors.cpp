@@ -35,6 +35,14 @@
 
 #include "Geometry.h"
 
+//Interned ids of properties read in update()
+static const unsigned int gpucacheKey = PropertyKeys::id("gpucache");
+static const unsigned int arrowheadKey = PropertyKeys::id("arrowhead");
+static const unsigned int autoscaleKey = PropertyKeys::id("autoscale");
+static const unsigned int glyphsKey = PropertyKeys::id("glyphs");
+static const unsigned int radiusKey = PropertyKeys::id("radius");
+static const unsigned int flatKey = PropertyKeys::id("flat");
+
 Vectors::Vectors(DrawState& drawstate) : Geometry(drawstate)
 {
   type = lucVectorType;
@@ -58,7 +66,7 @@ void Vectors::close()
 
 void Vectors::update()
 {
-  if (!reload && drawstate.global("gpucache")) return;
+  if (!reload && drawstate.global(gpucacheKey)) return;
   //Convert vectors to triangles
   clock_t t1,tt;
   tt=clock();
@@ -83,12 +91,13 @@ void Vectors::update()
 
     tot += geom[i]->count;
 
-    float arrowHead = props["arrowhead"];
+    float arrowHead = props[arrowheadKey];
 
     //Dynamic range?
-    float scaling = (float)props["scaling"] * (float)props["scalevectors"];
+    const ObjectSnapshot& snap = geom[i]->draw->snapshot();
+    float scaling = snap.scaling * snap.scalevectors;
 
-    if (props["autoscale"] && geom[i]->vectors.maximum > 0)
+    if (props[autoscaleKey] && geom[i]->vectors.maximum > 0)
     {
       debug_print("[Adjusted vector scaling from %.2e by %.2e to %.2e ]\n",
                   scaling, 1/geom[i]->vectors.maximum, scaling/geom[i]->vectors.maximum);
@@ -96,24 +105,29 @@ void Vectors::update()
     }
 
     //Load scaling factors from properties
-    int quality = 4 * (int)props["glyphs"];
+    int quality = 4 * (int)props[glyphsKey];
     //debug_print("Scaling %f arrowhead %f quality %d %d\n", scaling, arrowHead, glyphs);
 
     //Default (0) = automatically calculated radius
-    float radius = props["radius"];
+    float radius = props[radiusKey];
     radius *= scaling;
 
     if (scaling <= 0) scaling = 1.0;
 
     geom[i]->colourCalibrate();
-    bool flat = props["flat"] || quality < 1;
+    bool flat = props[flatKey] || quality < 1;
+    std::vector<Colour> colours(geom[i]->count);
+    geom[i]->fillColours(colours.data(), 0, geom[i]->count);
 
+    geom[i]->filterMask();
     for (unsigned int v=0; v < geom[i]->count; v++)
     {
       if (!drawable(i) || geom[i]->filter(v)) continue;
-      Vec3d pos(geom[i]->vertices[v]);
+      float vert[3];
+      geom[i]->vertices.get(v, vert);
+      Vec3d pos(vert);
       Vec3d vec(geom[i]->vectors[v]);
-      geom[i]->getColour(colour, v);
+      colour = colours[v];
 
       //Always draw the lines so when zoomed out shaft visible (prevents visible boundary between 2d/3d renders)
       lines->drawVector(geom[i]->draw, pos.ref(), vec.ref(), scaling, radius, radius, arrowHead, 0);
@@ -44,6 +44,10 @@ View::View(DrawState& drawstate, float xf, float yf, float nearc, float farc) :
   focal_length = focal_length_adj = 0.0; //Stereo zero parallex distance adjustment
   scene_shift = 0.0;      //Stereo projection shift
   rotated = rotating = sort = false;
+  snap.version = 0;
+  //No view applied yet
+  memset(projectionMatrix, 0, sizeof(projectionMatrix));
+  memset(viewMatrix, 0, sizeof(viewMatrix));
 
   model_size = 0.0;       //Scalar magnitude of model dimensions
   width = 0;              //Viewport width
@@ -85,11 +89,11 @@ View::View(DrawState& drawstate, float xf, float yf, float nearc, float farc) :
                              "axis", "axislength", "timestep", "antialias", "shift"};
   //Gets current value (either global or default)
   for (auto key : viewprops)
-    properties.data[key] = drawstate.global(key);
+    properties.set(key, drawstate.global(key));
 
   //Clip planes
-  properties.data["near"] = nearc;
-  properties.data["far"] = farc;
+  properties.set("near", nearc);
+  properties.set("far", farc);
 }
 
 View::~View()
@@ -200,9 +204,9 @@ void View::checkClip(float& near_clip, float& far_clip)
 
   if (near_clip < model_size * 0.001) near_clip = model_size * 0.001; //Bounds check
 
-  //Update properties
-  properties.data["near"] = near_clip;
-  properties.data["far"] = far_clip;
+  //Update properties (called every frame, snapshots only invalidated on change)
+  properties.set("near", near_clip);
+  properties.set("far", far_clip);
 }
 
 void View::getMinMaxDistance(float* mindist, float* maxdist)
@@ -455,8 +459,8 @@ void View::projection(int eye)
   float eye_separation, frustum_shift;
 
   //Ensure clip planes valid
-  float near_clip = properties["near"];
-  float far_clip = properties["far"];
+  float near_clip = snapshot().near_clip;
+  float far_clip = snap.far_clip;
   checkClip(near_clip, far_clip);
 
   //This is zero parallax distance, objects closer than this will appear in front of the screen,
@@ -491,21 +495,72 @@ void View::projection(int eye)
   //debug_print(" Ratio %f Left %f Right %f Top %f Bottom %f Near %f Far %f\n",
   //         aspectRatio, left, right, bottom, top, near_clip, far_clip);
 
-  // Set up our projection transform
+  // Set up our projection transform (glFrustum matrix, saved for use outside rendering)
+  left -= frustum_shift;
+  right -= frustum_shift;
+  memset(projectionMatrix, 0, sizeof(projectionMatrix));
+  projectionMatrix[0] = 2.0f * near_clip / (right - left);
+  projectionMatrix[5] = 2.0f * near_clip / (top - bottom);
+  projectionMatrix[8] = (right + left) / (right - left);
+  projectionMatrix[9] = (top + bottom) / (top - bottom);
+  projectionMatrix[10] = -(far_clip + near_clip) / (far_clip - near_clip);
+  projectionMatrix[11] = -1.0f;
+  projectionMatrix[14] = -2.0f * far_clip * near_clip / (far_clip - near_clip);
   glMatrixMode(GL_PROJECTION);
-  glLoadIdentity();
-  glFrustum(left - frustum_shift, right - frustum_shift, bottom, top, near_clip, far_clip);
+  glLoadMatrixf(projectionMatrix);
 
   // Return to model view
   glMatrixMode(GL_MODELVIEW);
   GL_Error_Check;
 }
 
+bool View::frustumBounds(float* fmin, float* fmax)
+{
+  //Get bounding box of view frustum in model coords, from last applied projection & modelview
+  //(no graphics calls, usable outside rendering)
+  float* mv = viewMatrix;
+  float* proj = projectionMatrix;
+  float mvp[16], inv[16];
+  for (int i=0; i<4; i++)
+  {
+    for (int j=0; j<4; j++)
+    {
+      mvp[j*4+i] = 0;
+      for (int k=0; k<4; k++)
+        mvp[j*4+i] += proj[k*4+i] * mv[j*4+k];
+    }
+  }
+  if (!gluInvertMatrixf(mvp, inv)) return false;
+
+  //Transform corners of clip space cube
+  for (int c=0; c<3; c++)
+  {
+    fmin[c] = HUGE_VAL;
+    fmax[c] = -HUGE_VAL;
+  }
+  for (int n=0; n<8; n++)
+  {
+    float ndc[4] = {n & 1 ? 1.0f : -1.0f, n & 2 ? 1.0f : -1.0f, n & 4 ? 1.0f : -1.0f, 1.0f};
+    float pos[4] = {0, 0, 0, 0};
+    for (int i=0; i<4; i++)
+      for (int k=0; k<4; k++)
+        pos[i] += inv[k*4+i] * ndc[k];
+    if (pos[3] == 0) return false;
+    for (int c=0; c<3; c++)
+    {
+      float v = pos[c] / pos[3];
+      if (v < fmin[c]) fmin[c] = v;
+      if (v > fmax[c]) fmax[c] = v;
+    }
+  }
+  return true;
+}
+
 void View::apply(bool use_fp)
 {
   // Right-handed (GL default) or Left-handed
-  int orientation = properties["coordsystem"];
-  if (properties["globalcam"])
+  int orientation = snapshot().coordsystem;
+  if (snap.globalcam)
   {
     if (!drawstate.globalcam) 
       drawstate.globalcam = new Camera(localcam);
@@ -580,6 +635,9 @@ void View::apply(bool use_fp)
   else
     glFrontFace(GL_CW);
   GL_Error_Check;
+
+  // Save full view transform
+  if (use_fp) glGetFloatv(GL_MODELVIEW_MATRIX, viewMatrix);
 }
 
 bool View::scaleSwitch()
@@ -611,12 +669,21 @@ int View::direction()
   return model_trans[2] > 0 ? -1 : 1;
 }
 
+void View::takeSnapshot()
+{
+  snap.coordsystem = properties["coordsystem"];
+  snap.globalcam = properties["globalcam"];
+  snap.near_clip = properties["near"];
+  snap.far_clip = properties["far"];
+  snap.version = properties.current();
+}
+
 int View::switchCoordSystem()
 {
   if ((int)properties["coordsystem"] == LEFT_HANDED)
-    properties.data["coordsystem"] = RIGHT_HANDED;
+    properties.set("coordsystem", RIGHT_HANDED);
   else
-    properties.data["coordsystem"] = LEFT_HANDED;
+    properties.set("coordsystem", LEFT_HANDED);
   rotated = true;   //Flag rotation
   return properties["coordsystem"];
 }
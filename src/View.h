@@ -74,6 +74,16 @@ public:
   }
 };
 
+//Typed copy of properties read every frame, valid while version matches properties.current()
+struct ViewSnapshot
+{
+  unsigned int version;
+  int coordsystem;
+  bool globalcam;
+  float near_clip;
+  float far_clip;
+};
+
 class View
 {
 public:
@@ -123,6 +133,7 @@ private:
   float scene_shift;         // Stereo projection shift (calculated from eye sep)
   bool  auto_stereo;         // Auto-adjust focal-len & eye-separation?
   float focal_length_adj;    // User adjust to focal length
+  ViewSnapshot snap;
 
 public:
   std::vector<DrawingObject*> objects;     // Contains these objects
@@ -131,6 +142,8 @@ public:
   float eye_shift;           // Stereo eye shift factor
   float eye_sep_ratio;       // Eye separation ratio to focal length
   float modelView[16];
+  float projectionMatrix[16]; // Projection and model view of last applied view (column major)
+  float viewMatrix[16];
   float scale2d;
 
   View(DrawState& drawstate, float xf = 0, float yf = 0, float nearc = 0.0f, float farc = 0.0f);
@@ -168,8 +181,15 @@ public:
   bool hasPixel(int x, int y);
 
   void projection(int eye);
+  bool frustumBounds(float* fmin, float* fmax);
   void apply(bool use_fp=true);
   int switchCoordSystem();
+  const ViewSnapshot& snapshot()
+  {
+    if (snap.version != properties.current()) takeSnapshot();
+    return snap;
+  }
+  void takeSnapshot();
   void zoomToFit(int margin=-1);
   bool scaleSwitch();
   int direction();
@@ -57,13 +57,7 @@ void Volumes::close()
   //requries enough GPU ram to store all volumes
   if (drawstate.global("cachevolumes")) return;
   for (unsigned int i=0; i<geom.size(); i++)
-  {
-    if (geom[i]->texture)
-    {
-      delete geom[i]->texture;
-      geom[i]->texture = NULL;
-    }
-  }
+    geom[i]->texture = NULL;
 }
 
 void Volumes::draw()
@@ -164,7 +158,7 @@ void Volumes::update()
       if (!geom[i]->texture || !geom[i]->texture->texture || geom[i]->texture->texture->width == 0) //Width set to 0 to flag reload
       {
         //Determine type of data then load the texture
-        if (!geom[i]->texture) geom[i]->texture = new ImageLoader(); //Add a new texture container
+        if (!geom[i]->texture) geom[i]->texture = std::make_shared<ImageLoader>(); //Add a new texture container
         unsigned int bpv = 4;
         if (geom[i]->colours.size() > 0)
         {
@@ -180,8 +174,16 @@ void Volumes::update()
         }
         else if (geom[i]->colourData())
         {
-          assert(geom[i]->colourData()->size() == geom[i]->width * geom[i]->height * geom[i]->depth);
-          geom[i]->texture->load3D(geom[i]->width, geom[i]->height, geom[i]->depth, geom[i]->colourData()->ref(), VOLUME_FLOAT);
+          FloatValues* vals = geom[i]->colourData();
+          assert(vals->size() == geom[i]->width * geom[i]->height * geom[i]->depth);
+          //Compact values decoded to a copy for the texture
+          std::vector<float> decoded;
+          if (vals->compacted())
+          {
+            decoded.resize(vals->size());
+            vals->decode(0, decoded.size(), decoded.data());
+          }
+          geom[i]->texture->load3D(geom[i]->width, geom[i]->height, geom[i]->depth, decoded.size() ? decoded.data() : vals->ref(), VOLUME_FLOAT);
         }
         debug_print("volume %d width %d height %d depth %d (bpv %d)\n", i, geom[i]->width, geom[i]->height, geom[i]->depth, bpv);
       }
@@ -227,7 +229,7 @@ void Volumes::update()
         printf("Cropping volume %d x %d ==> %d x %d @ %d,%d\n", geom[i]->width, geom[i]->height, dims[0], dims[1], (int)texoffset[0], (int)texoffset[1]);
 
       //Init/allocate/bind texture
-      if (!geom[i]->texture) geom[i]->texture = new ImageLoader(); //Add a new texture container
+      if (!geom[i]->texture) geom[i]->texture = std::make_shared<ImageLoader>(); //Add a new texture container
       unsigned int bpv = 4;
       int type = 0;
       GL_Error_Check;
@@ -350,7 +352,7 @@ void Volumes::render(int i)
   Properties& props = geom[i]->draw->properties;
   float viewport[4];
   glGetFloatv(GL_VIEWPORT, viewport);
-  TextureData* voltexture = geom[i]->draw->useTexture(geom[i]->texture);
+  TextureData* voltexture = geom[i]->draw->useTexture(geom[i]->texture.get());
   if (!voltexture) 
   {
     fprintf(stderr, "No volume texture loaded for %d!\n", i);
@@ -485,6 +487,8 @@ void Volumes::render(int i)
 
   //Draw two triangles to fill screen
   int stride = 8 * sizeof(float) + sizeof(Colour);   //3+3+2 vertices, normals, texCoord + 32-bit colour
+  if (tris->colourslots.size())
+    stride += 2 * sizeof(float);   //+ raw colour value and slot
   glBindBuffer(GL_ARRAY_BUFFER, tris->vbo);
   glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, tris->indexvbo);
   glVertexPointer(3, GL_FLOAT, stride, (GLvoid*)0); // Load vertex x,y,z only
@@ -0,0 +1,28 @@
+//Colour mapping in the vertex shaders, included by the point, line and triangle shaders
+//(MAX_COLOURMAP_SLOTS defined by the shader loader)
+uniform sampler2D uColourMap;   // colourmap lookup tables, one row per slot
+uniform float uColourMapTexel;  // width of one table entry in texture coordinates
+uniform vec4 uColourRange[MAX_COLOURMAP_SLOTS];  // per slot: table min, scale, bias and last entry
+uniform vec4 uColourFlags[MAX_COLOURMAP_SLOTS];  // per slot: log scale, interpolate, opacity and row coordinate
+attribute vec2 aColourValue;    // raw value and slot, slot -1 uses the vertex colour
+
+vec4 mapColour()
+{
+   //Colour already mapped on CPU
+   if (aColourValue.y < 0.0) return gl_Color;
+   int slot = int(aColourValue.y + 0.5);
+   float value = aColourValue.x;
+   //No data (HUGE_VAL) is transparent
+   if (value > 3.0e38) return vec4(0.0);
+   vec4 range = uColourRange[slot];
+   vec4 flags = uColourFlags[slot];
+   //Table is sampled over log10 of value for log scales
+   if (flags.x > 0.0) value = log2(max(value, 1.175494e-38)) * 0.30102999566;
+   float f = clamp((value - range.x) * range.y + range.z, 0.0, range.w);
+   float c = floor(f);
+   vec4 colour = texture2DLod(uColourMap, vec2((c + 0.5) * uColourMapTexel, flags.w), 0.0);
+   if (flags.y > 0.0 && c < range.w)
+      colour = mix(colour, texture2DLod(uColourMap, vec2((c + 1.5) * uColourMapTexel, flags.w), 0.0), f - c);
+   colour.a *= flags.z;
+   return colour;
+}
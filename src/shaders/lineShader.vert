@@ -1,11 +1,13 @@
 varying vec4 vColour;
 varying vec3 vVertex;
 
+#include "colourMap.vert"
+
 void main(void)
 {
   vec4 mvPosition = gl_ModelViewMatrix * gl_Vertex;
   gl_Position = gl_ProjectionMatrix * mvPosition;
-  vColour = gl_Color;
+  vColour = mapColour();
   vVertex = gl_Vertex.xyz;
 }
 
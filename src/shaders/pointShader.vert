@@ -10,6 +10,35 @@ varying vec3 vPosEye;
 varying float vPointSize;
 varying vec3 vVertex;
 
+#include "colourMap.vert"
+
+uniform vec4 uFilterMin[MAX_FILTER_SLOTS];  // per slot: lower limit of each filter
+uniform vec4 uFilterMax[MAX_FILTER_SLOTS];  // per slot: upper limit of each filter
+uniform vec4 uFilterMode[MAX_FILTER_SLOTS]; // per slot: 0 none, 1 outside range, 3 inside range filtered (+1 inclusive of limits)
+attribute vec4 aFilterValue;    // values compared by up to three filters and slot, slot -1 not filtered
+
+bool filterHit(float value, float lower, float upper, float mode)
+{
+   if (mode < 0.5) return false;
+   if (mode < 1.5) return value < lower || value > upper;
+   if (mode < 2.5) return value <= lower || value >= upper;
+   if (mode < 3.5) return value > lower && value < upper;
+   return value >= lower && value <= upper;
+}
+
+bool filtered()
+{
+   //Filters applied on CPU
+   if (aFilterValue.w < 0.0) return false;
+   int slot = int(aFilterValue.w + 0.5);
+   vec4 lower = uFilterMin[slot];
+   vec4 upper = uFilterMax[slot];
+   vec4 mode = uFilterMode[slot];
+   return filterHit(aFilterValue.x, lower.x, upper.x, mode.x) ||
+          filterHit(aFilterValue.y, lower.y, upper.y, mode.y) ||
+          filterHit(aFilterValue.z, lower.z, upper.z, mode.z);
+}
+
 void main(void)
 {
    float pSize = abs(aSize);
@@ -23,10 +52,17 @@ void main(void)
    //gl_PointSize = max(1.0, min(40.0, uPointScale * pSize / dist));
    gl_PointSize = uPointScale * pSize / dist;
    gl_Position = gl_ModelViewProjectionMatrix * gl_Vertex;
-   gl_FrontColor = gl_Color;
+   gl_FrontColor = mapColour();
    vPosEye = posEye;
    vPointType = aPointType;
    vPointSize = gl_PointSize;
    vVertex = gl_Vertex.xyz;
+
+   //Filtered points are placed outside the clip volume
+   if (filtered())
+   {
+      gl_Position = vec4(0.0, 0.0, 2.0, 1.0);
+      gl_PointSize = 0.0;
+   }
 }
 
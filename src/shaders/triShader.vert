@@ -6,6 +6,7 @@ varying vec3 vNormal;
 varying vec3 vPosEye;
 varying vec3 vVertex;
 uniform bool uCalcNormal;
+#include "colourMap.vert"
 
 void main(void)
 {
@@ -19,7 +20,7 @@ void main(void)
     vNormal = normalize(mat3(gl_NormalMatrix) * gl_Normal);
  
    gl_TexCoord[0] = gl_MultiTexCoord0;
-   vColour = gl_Color;
+   vColour = mapColour();
    vVertex = gl_Vertex.xyz;
 }
 